@@ -0,0 +1,499 @@
+#include <cerrno>
+
+#include "aio.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define AIO_HAVE_IO_URING 1
+#endif
+#endif
+
+
+/* ---------------------------------------------------------------------------------------
+ PageBatch
+ --------------------------------------------------------------------------------------- */
+
+PageRequest requestOf(const int & fd, const PageNum & pageNum, void * data, const bool & write, const unsigned & pageSize)
+{
+    PageRequest request;
+    request.fd = fd;
+    request.pageNum = pageNum;
+    request.data = data;
+    request.write = write;
+    request.done = false;
+    request.rc = -1;
+    request.batch = nullptr;
+    request.iov.iov_base = data;
+    request.iov.iov_len = pageSize;
+    return request;
+}
+
+RC PageBatch::addRead(const int & fd, const PageNum & pageNum, void * data, const unsigned & pageSize)
+{
+    if (pending > 0) {
+        return -1;
+    }
+    requests.push_back(requestOf(fd, pageNum, data, false, pageSize));
+    return 0;
+}
+
+RC PageBatch::addWrite(const int & fd, const PageNum & pageNum, const void * data, const unsigned & pageSize)
+{
+    if (pending > 0) {
+        return -1;
+    }
+    requests.push_back(requestOf(fd, pageNum, (void*)data, true, pageSize));
+    return 0;
+}
+
+RC PageBatch::addCompleted(const PageNum & pageNum, void * data)
+{
+    if (pending > 0) {
+        return -1;
+    }
+    PageRequest request = requestOf(FD_NOT_OPEN, pageNum, data, false, 0);
+    request.done = true;
+    request.rc = 0;
+    requests.push_back(request);
+    return 0;
+}
+
+RC PageBatch::clear()
+{
+    if (pending > 0) {
+        return -1;
+    }
+    requests.clear();
+    started = 0;
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ AsyncIOManager
+ --------------------------------------------------------------------------------------- */
+
+AsyncIOManager* AsyncIOManager::_aio_manager = nullptr;
+
+AsyncIOManager* AsyncIOManager::instance()
+{
+    if(!_aio_manager)
+        _aio_manager = new AsyncIOManager();
+
+    return _aio_manager;
+}
+
+AsyncIOManager::AsyncIOManager()
+{
+    // the thread pool is only started if the ring can't be set up
+    if (_setupRing() != 0) {
+        _startWorkers();
+    }
+}
+
+AsyncIOManager::~AsyncIOManager()
+{
+    _teardownRing();
+    _stopWorkers();
+}
+
+// caller holds _latch
+void AsyncIOManager::_complete(PageRequest & request, const RC & rc)
+{
+    request.rc = rc;
+    request.done = true;
+    request.batch->pending--;
+}
+
+// caller holds _latch
+void AsyncIOManager::_failUnstarted(PageBatch & batch)
+{
+    for (unsigned i = batch.started; i < batch.requests.size(); i++) {
+        if (!batch.requests[i].done) {
+            _complete(batch.requests[i], -1);
+        }
+    }
+    batch.started = (unsigned) batch.requests.size();
+    _completed.notify_all();
+}
+
+RC AsyncIOManager::submit(PageBatch & batch)
+{
+    lock_guard<mutex> submitting(_submitLatch);
+    unique_lock<mutex> lock(_latch);
+    if (batch.started == batch.requests.size()) {
+        return 0;
+    }
+    for (unsigned i = batch.started; i < batch.requests.size(); i++) {
+        PageRequest & request = batch.requests[i];
+        request.batch = &batch;
+        if (!request.done) {
+            batch.pending++;
+        }
+    }
+    if (_ringFd >= 0) {
+        return _ringSubmit(batch, lock);
+    }
+    for (unsigned i = batch.started; i < batch.requests.size(); i++) {
+        if (!batch.requests[i].done) {
+            _queue.push_back(&batch.requests[i]);
+        }
+    }
+    batch.started = (unsigned) batch.requests.size();
+    _queued.notify_all();
+    return 0;
+}
+
+// requests that were started before a submit failed are still waited for
+RC AsyncIOManager::wait(PageBatch & batch)
+{
+    RC rc = 0;
+    if (batch.started < batch.requests.size()) {
+        rc = submit(batch);
+    }
+    unique_lock<mutex> lock(_latch);
+    while (batch.pending > 0) {
+        if (_ringFd >= 0) {
+            if (_ringAwait(lock) != 0) {
+                return -1;
+            }
+        }
+        else {
+            _completed.wait(lock);
+        }
+    }
+    if (rc != 0) {
+        return -1;
+    }
+    for (unsigned i = 0; i < batch.requests.size(); i++) {
+        if (batch.requests[i].rc != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+bool AsyncIOManager::poll(PageBatch & batch)
+{
+    unique_lock<mutex> lock(_latch);
+    if (_ringFd >= 0 && batch.pending > 0) {
+        _ringReap();
+    }
+    return batch.pending == 0 && batch.started == batch.requests.size();
+}
+
+RC AsyncIOManager::useThreadPool()
+{
+    lock_guard<mutex> submitting(_submitLatch);
+    unique_lock<mutex> lock(_latch);
+    if (_inFlight > 0 || !_queue.empty()) {
+        return -1;
+    }
+    _teardownRing();
+    if (_workers.empty()) {
+        lock.unlock();
+        _startWorkers();
+    }
+    return 0;
+}
+
+bool AsyncIOManager::usingIoUring()
+{
+    lock_guard<mutex> lock(_latch);
+    return _ringFd >= 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ io_uring engine, callers hold _latch
+ --------------------------------------------------------------------------------------- */
+
+#ifdef AIO_HAVE_IO_URING
+
+/*
+ io_uring_setup(unsigned entries, struct io_uring_params * p) creates the rings and returns their fd.
+ The submission ring, the completion ring and the array of submission entries are then mmap()ed;
+ requests are published by advancing the SQ tail and handed over with io_uring_enter().
+ */
+RC AsyncIOManager::_setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ringFd = (int) syscall(__NR_io_uring_setup, AIO_QUEUE_DEPTH, &params);
+    if (ringFd < 0) {
+        return -1;
+    }
+    _ringFd = ringFd;
+    _ringEntries = params.sq_entries;
+    _sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    _sqesBytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap && _cqRingBytes > _sqRingBytes) {
+        _sqRingBytes = _cqRingBytes;
+    }
+
+    _sqRing = mmap(nullptr, _sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (_sqRing == MAP_FAILED) {
+        _sqRing = nullptr;
+        _teardownRing();
+        return -1;
+    }
+    if (singleMmap) {
+        _cqRing = _sqRing;
+    }
+    else {
+        _cqRing = mmap(nullptr, _cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (_cqRing == MAP_FAILED) {
+            _cqRing = nullptr;
+            _teardownRing();
+            return -1;
+        }
+    }
+    _sqes = mmap(nullptr, _sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (_sqes == MAP_FAILED) {
+        _sqes = nullptr;
+        _teardownRing();
+        return -1;
+    }
+
+    _sqTail = (unsigned*)((char*)_sqRing + params.sq_off.tail);
+    _sqMask = (unsigned*)((char*)_sqRing + params.sq_off.ring_mask);
+    _sqArray = (unsigned*)((char*)_sqRing + params.sq_off.array);
+    _cqHead = (unsigned*)((char*)_cqRing + params.cq_off.head);
+    _cqTail = (unsigned*)((char*)_cqRing + params.cq_off.tail);
+    _cqMask = (unsigned*)((char*)_cqRing + params.cq_off.ring_mask);
+    _cqes = (char*)_cqRing + params.cq_off.cqes;
+    return 0;
+}
+
+void AsyncIOManager::_teardownRing()
+{
+    if (_sqes != nullptr) {
+        munmap(_sqes, _sqesBytes);
+    }
+    if (_cqRing != nullptr && _cqRing != _sqRing) {
+        munmap(_cqRing, _cqRingBytes);
+    }
+    if (_sqRing != nullptr) {
+        munmap(_sqRing, _sqRingBytes);
+    }
+    _sqes = nullptr;
+    _cqRing = nullptr;
+    _sqRing = nullptr;
+    if (_ringFd >= 0) {
+        close(_ringFd);
+    }
+    _ringFd = -1;
+}
+
+/*
+ readv/writev of one page, supported since the first io_uring kernels.
+ The caller holds _submitLatch as well, so nobody else puts entries on the ring while the latch is let go
+ to wait for room. The kernel takes entries in order: the ones it refuses are taken back off the ring
+ and fail, together with the rest of the batch.
+ */
+RC AsyncIOManager::_ringSubmit(PageBatch & batch, unique_lock<mutex> & lock)
+{
+    vector<PageRequest*> entries;
+    while (batch.started < batch.requests.size()) {
+        // never have more requests in flight than the completion ring can hold
+        while (_inFlight >= _ringEntries) {
+            if (_ringAwait(lock) != 0) {
+                _failUnstarted(batch);
+                return -1;
+            }
+        }
+        unsigned tail = *_sqTail;
+        entries.clear();
+        while (batch.started < batch.requests.size() && _inFlight + entries.size() < _ringEntries) {
+            PageRequest & request = batch.requests[batch.started++];
+            if (request.done) {
+                continue;
+            }
+            unsigned idx = (tail + (unsigned) entries.size()) & *_sqMask;
+            struct io_uring_sqe * sqe = (struct io_uring_sqe *)_sqes + idx;
+            memset(sqe, 0, sizeof(struct io_uring_sqe));
+            sqe->opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = request.fd;
+            sqe->addr = (unsigned long long) &request.iov;
+            sqe->len = 1;
+            sqe->off = (unsigned long long) request.iov.iov_len * request.pageNum;
+            sqe->user_data = (unsigned long long) &request;
+            _sqArray[idx] = idx;
+            entries.push_back(&request);
+        }
+        unsigned toSubmit = (unsigned) entries.size();
+        if (toSubmit == 0) {
+            continue;
+        }
+        // the kernel must see the entries before it sees the new tail
+        __atomic_store_n(_sqTail, tail + toSubmit, __ATOMIC_RELEASE);
+        unsigned done = 0;
+        while (done < toSubmit) {
+            int ret = (int) syscall(__NR_io_uring_enter, _ringFd, toSubmit - done, 0, 0, nullptr, 0);
+            if (ret > 0) {
+                done += (unsigned) ret;
+                _inFlight += (unsigned) ret;
+                continue;
+            }
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            // out of resources: wait for what is in flight to make room, if anything is
+            if (ret < 0 && (errno == EAGAIN || errno == EBUSY) && _inFlight > 0 && _ringAwait(lock) == 0) {
+                continue;
+            }
+            break;
+        }
+        if (done < toSubmit) {
+            __atomic_store_n(_sqTail, tail + done, __ATOMIC_RELEASE);
+            for (unsigned i = done; i < toSubmit; i++) {
+                _complete(*entries[i], -1);
+            }
+            _failUnstarted(batch);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ The latch is let go while in the kernel. Only one thread waits there at a time and takes the completions
+ off the ring for everyone, the others wait for it to wake them; nobody else reaps meanwhile,
+ so what it waits for can't be taken from under it.
+ */
+RC AsyncIOManager::_ringAwait(unique_lock<mutex> & lock)
+{
+    if (_reaping) {
+        _completed.wait(lock);
+        return 0;
+    }
+    if (_ringReap() > 0) {
+        _completed.notify_all();
+        return 0;
+    }
+    if (_inFlight == 0) {
+        return -1;
+    }
+    _reaping = true;
+    int ringFd = _ringFd;
+    lock.unlock();
+    int ret = (int) syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    int error = errno;
+    lock.lock();
+    _reaping = false;
+    _ringReap();
+    _completed.notify_all();
+    if (ret < 0 && error != EINTR) {
+        return -1;
+    }
+    return 0;
+}
+
+unsigned AsyncIOManager::_ringReap()
+{
+    if (_reaping) {
+        return 0;
+    }
+    unsigned head = *_cqHead;
+    unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    unsigned reaped = 0;
+    while (head != tail) {
+        struct io_uring_cqe * cqe = (struct io_uring_cqe *)_cqes + (head & *_cqMask);
+        PageRequest * request = (PageRequest *) cqe->user_data;
+        // a short transfer is a failure, pages are never split
+        _complete(*request, cqe->res == (int) request->iov.iov_len ? 0 : -1);
+        _inFlight--;
+        head++;
+        reaped++;
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+#else
+
+RC AsyncIOManager::_setupRing()
+{
+    return -1;
+}
+
+void AsyncIOManager::_teardownRing()
+{
+}
+
+RC AsyncIOManager::_ringSubmit(PageBatch & batch, unique_lock<mutex> & lock)
+{
+    return -1;
+}
+
+RC AsyncIOManager::_ringAwait(unique_lock<mutex> & lock)
+{
+    return -1;
+}
+
+unsigned AsyncIOManager::_ringReap()
+{
+    return 0;
+}
+
+#endif
+
+
+/* ---------------------------------------------------------------------------------------
+ thread pool engine
+ --------------------------------------------------------------------------------------- */
+
+void AsyncIOManager::_startWorkers()
+{
+    _stopping = false;
+    for (unsigned i = 0; i < AIO_WORKER_THREADS; i++) {
+        _workers.push_back(thread(&AsyncIOManager::_workerLoop, this));
+    }
+}
+
+void AsyncIOManager::_stopWorkers()
+{
+    {
+        lock_guard<mutex> lock(_latch);
+        _stopping = true;
+    }
+    _queued.notify_all();
+    for (unsigned i = 0; i < _workers.size(); i++) {
+        _workers[i].join();
+    }
+    _workers.clear();
+}
+
+void AsyncIOManager::_workerLoop()
+{
+    unique_lock<mutex> lock(_latch);
+    while (true) {
+        while (_queue.empty() && !_stopping) {
+            _queued.wait(lock);
+        }
+        if (_queue.empty()) {
+            return;
+        }
+        PageRequest * request = _queue.front();
+        _queue.pop_front();
+
+        // the transfer itself runs without the latch, so the workers overlap
+        lock.unlock();
+        ssize_t bytes;
+        if (request->write) {
+            bytes = pwrite(request->fd, request->data, request->iov.iov_len, (off_t) request->iov.iov_len * request->pageNum);
+        }
+        else {
+            bytes = pread(request->fd, request->data, request->iov.iov_len, (off_t) request->iov.iov_len * request->pageNum);
+        }
+        lock.lock();
+
+        _complete(*request, bytes == (ssize_t) request->iov.iov_len ? 0 : -1);
+        _completed.notify_all();
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef _aio_h_
+#define _aio_h_
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <sys/uio.h>
+
+#include "../Utils/utils.h"
+
+using namespace std;
+
+class PageBatch;
+
+// One page transfer handed to the AsyncIOManager.
+// pageNum is the physical page in the file, iov.iov_len the page size of that file;
+// rc is filled in once the request completed.
+typedef struct
+{
+    int fd;
+    PageNum pageNum;
+    void * data;
+    bool write;
+    bool done;
+    RC rc;
+    PageBatch * batch;
+    struct iovec iov;
+} PageRequest;
+
+// Page requests that are submitted together and waited for together.
+// Requests can be added until the batch is submitted, not while it is in flight.
+class PageBatch
+{
+public:
+    vector<PageRequest> requests;
+    unsigned started = 0;       // requests[0 .. started) have been handed to the manager
+    unsigned pending = 0;       // submitted but not completed yet, guarded by the manager
+
+    RC addRead(const int & fd, const PageNum & pageNum, void * data, const unsigned & pageSize = PAGE_SIZE);
+    RC addWrite(const int & fd, const PageNum & pageNum, const void * data, const unsigned & pageSize = PAGE_SIZE);
+    RC addCompleted(const PageNum & pageNum, void * data);      // served without any I/O (e.g. from the buffer pool)
+
+    RC clear();                                                 // reuse the batch once it completed
+};
+
+// Keeps many page reads/writes outstanding at once.
+// On Linux it drives an io_uring directly through its system calls;
+// where that isn't available (other systems, old kernels, sandboxes) a small pool of
+// threads issues the pread()/pwrite() calls instead. The interface is the same either way:
+//  PageBatch batch;
+//  fileHandle.queueRead(batch, pageNum, buffer);   // as many as needed
+//  aio->submit(batch);                             // returns right away
+//  ... other work ...
+//  aio->wait(batch);                               // 0 if every request succeeded
+// If the kernel refuses requests, submit() returns -1 and they fail along with the rest of the batch;
+// the ones it took are still in flight, so wait() must be called before the pages go away.
+// Only one thread waits in the kernel for completions at a time, and never while holding the latch.
+class AsyncIOManager
+{
+public:
+    static AsyncIOManager* instance();                                   // Access to the _aio_manager instance
+
+    RC submit(PageBatch & batch);                                        // start every request not started yet, see below
+    RC wait(PageBatch & batch);                                          // block until the batch completed, -1 if a request failed
+    bool poll(PageBatch & batch);                                        // collect what finished, true once the batch completed
+
+    RC useThreadPool();                                                  // switch to the fallback engine, only while idle
+    bool usingIoUring();
+
+protected:
+    AsyncIOManager();
+    ~AsyncIOManager();
+
+private:
+    static AsyncIOManager * _aio_manager;
+
+    mutex _latch;
+    mutex _submitLatch;                 // taken before _latch, one submitter fills the ring at a time
+    condition_variable _completed;
+
+    // io_uring: the rings are shared with the kernel through mmap()
+    int _ringFd = -1;
+    unsigned _ringEntries = 0;
+    unsigned _inFlight = 0;
+    bool _reaping = false;              // a thread waits in the kernel, it takes completions off the ring for everyone
+    void * _sqRing = nullptr;
+    void * _cqRing = nullptr;
+    void * _sqes = nullptr;
+    size_t _sqRingBytes = 0;
+    size_t _cqRingBytes = 0;
+    size_t _sqesBytes = 0;
+    unsigned * _sqTail = nullptr;
+    unsigned * _sqMask = nullptr;
+    unsigned * _sqArray = nullptr;
+    unsigned * _cqHead = nullptr;
+    unsigned * _cqTail = nullptr;
+    unsigned * _cqMask = nullptr;
+    void * _cqes = nullptr;
+
+    RC _setupRing();
+    void _teardownRing();
+    RC _ringSubmit(PageBatch & batch, unique_lock<mutex> & lock);
+    RC _ringAwait(unique_lock<mutex> & lock);                           // at least one completion, lets go of the latch meanwhile
+    unsigned _ringReap();                                                // what completed already, without waiting
+
+    // thread pool fallback
+    vector<thread> _workers;
+    deque<PageRequest*> _queue;
+    condition_variable _queued;
+    bool _stopping = false;
+
+    void _startWorkers();
+    void _stopWorkers();
+    void _workerLoop();
+
+    void _complete(PageRequest & request, const RC & rc);               // caller holds _latch
+    void _failUnstarted(PageBatch & batch);                              // caller holds _latch
+};
+
+#endif /* aio_h */
@@ -0,0 +1,482 @@
+#include "bpm.h"
+#include "pfm.h"
+
+
+BufferPoolManager* BufferPoolManager::_bp_manager = nullptr;
+
+BufferPoolManager* BufferPoolManager::instance()
+{
+    if(!_bp_manager)
+        _bp_manager = new BufferPoolManager();
+
+    return _bp_manager;
+}
+
+BufferPoolManager::BufferPoolManager()
+{
+    _frameCount = BUFFER_POOL_FRAMES;
+}
+
+BufferPoolManager::~BufferPoolManager()
+{
+    _release();
+}
+
+unsigned long long pageKeyOf(const unsigned & fileId, const PageNum & pageNum)
+{
+    return ((unsigned long long) fileId << 32) | pageNum;
+}
+
+/* ---------------------------------------------------------------------------------------
+ frame management, callers hold _latch
+ --------------------------------------------------------------------------------------- */
+
+RC BufferPoolManager::_allocate()
+{
+    if (!_frames.empty()) {
+        return 0;
+    }
+    Frame empty;
+    empty.fileId = 0;
+    empty.pageNum = 0;
+    empty.data = nullptr;
+    empty.pageSize = 0;
+    empty.store = nullptr;
+    empty.pinCount = 0;
+    empty.dirty = false;
+    empty.referenced = false;
+    empty.occupied = false;
+    _frames.assign(_frameCount, empty);
+    _pageTable.clear();
+    _clockHand = 0;
+    return 0;
+}
+
+void BufferPoolManager::_release()
+{
+    for (unsigned i = 0; i < _frames.size(); i++) {
+        free(_frames[i].data);
+    }
+    _frames.clear();
+    _pageTable.clear();
+}
+
+void * BufferPoolManager::_frameData(const unsigned & frameIdx)
+{
+    return _frames[frameIdx].data;
+}
+
+// frames take the page size of whatever file they hold, the memory is only swapped when it differs
+RC BufferPoolManager::_fitFrame(const unsigned & frameIdx, const unsigned & pageSize)
+{
+    Frame & frame = _frames[frameIdx];
+    if (frame.data != nullptr && frame.pageSize == pageSize) {
+        return 0;
+    }
+    free(frame.data);
+    frame.data = malloc(pageSize);
+    frame.pageSize = frame.data == nullptr ? 0 : pageSize;
+    return frame.data == nullptr ? -1 : 0;
+}
+
+RC BufferPoolManager::_writeBack(Frame & frame, const unsigned & frameIdx)
+{
+    if (!frame.dirty) {
+        return 0;
+    }
+    if (frame.store == nullptr || frame.store->writePage(frame.pageNum, _frameData(frameIdx)) != 0) {
+        return -1;
+    }
+    frame.dirty = false;
+    frame.store = nullptr;
+    return 0;
+}
+
+// CLOCK: sweep at most twice around the pool, clearing reference bits on the way.
+// Pinned frames are never chosen; -1 means every frame is pinned.
+RC BufferPoolManager::_findVictim(unsigned & frameIdx)
+{
+    for (unsigned step = 0; step < 2 * _frameCount; step++) {
+        Frame & frame = _frames[_clockHand];
+        unsigned curt = _clockHand;
+        _clockHand = (_clockHand + 1) % _frameCount;
+
+        if (!frame.occupied) {
+            frameIdx = curt;
+            return 0;
+        }
+        if (frame.pinCount > 0) {
+            continue;
+        }
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        if (_writeBack(frame, curt) != 0) {
+            continue;
+        }
+        _pageTable.erase(pageKeyOf(frame.fileId, frame.pageNum));
+        frame.occupied = false;
+        frameIdx = curt;
+        return 0;
+    }
+    return -1;
+}
+
+// Look up (or bring in) the frame for a page and pin it.
+// loadFromDisk == false is used when the caller is about to overwrite the whole page anyway.
+RC BufferPoolManager::_fetch(FileHandle & fileHandle,
+                             const PageNum & pageNum,
+                             const bool & loadFromDisk,
+                             unsigned & frameIdx)
+{
+    if (_allocate() != 0) {
+        return -1;
+    }
+    unsigned long long key = pageKeyOf(fileHandle.fileId, pageNum);
+    auto it = _pageTable.find(key);
+    if (it != _pageTable.end()) {
+        frameIdx = it->second;
+        _frames[frameIdx].pinCount++;
+        _frames[frameIdx].referenced = true;
+        return 0;
+    }
+
+    if (_findVictim(frameIdx) != 0 || _fitFrame(frameIdx, fileHandle.getPageSize()) != 0) {
+        return -1;
+    }
+    if (loadFromDisk && fileHandle.store->readPage(pageNum, _frameData(frameIdx)) != 0) {
+        return -1;
+    }
+    Frame & frame = _frames[frameIdx];
+    frame.fileId = fileHandle.fileId;
+    frame.pageNum = pageNum;
+    frame.store = nullptr;
+    frame.pinCount = 1;
+    frame.dirty = false;
+    frame.referenced = true;
+    frame.occupied = true;
+    _pageTable[key] = frameIdx;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------------------
+ public interface
+ --------------------------------------------------------------------------------------- */
+
+RC BufferPoolManager::setFrameCount(const unsigned & frameCount)
+{
+    lock_guard<mutex> lock(_latch);
+    if (frameCount == 0) {
+        return -1;
+    }
+    for (unsigned i = 0; i < _frames.size(); i++) {
+        if (_frames[i].occupied && _frames[i].pinCount > 0) {
+            return -1;
+        }
+    }
+    for (unsigned i = 0; i < _frames.size(); i++) {
+        if (_frames[i].occupied && _writeBack(_frames[i], i) != 0) {
+            return -1;
+        }
+    }
+    _release();
+    _frameCount = frameCount;
+    return 0;
+}
+
+unsigned BufferPoolManager::getFrameCount()
+{
+    lock_guard<mutex> lock(_latch);
+    return _frameCount;
+}
+
+unsigned BufferPoolManager::fileIdOf(const string & fileName)
+{
+    lock_guard<mutex> lock(_latch);
+    auto it = _fileIds.find(fileName);
+    if (it != _fileIds.end()) {
+        return it->second;
+    }
+    unsigned fileId = (unsigned) _fileIds.size() + 1;
+    _fileIds[fileName] = fileId;
+    return fileId;
+}
+
+RC BufferPoolManager::pinPage(FileHandle & fileHandle,
+                              const PageNum & pageNum,
+                              void* & frameData)
+{
+    lock_guard<mutex> lock(_latch);
+    unsigned frameIdx;
+    if (_fetch(fileHandle, pageNum, true, frameIdx) != 0) {
+        return -1;
+    }
+    frameData = _frameData(frameIdx);
+    return 0;
+}
+
+RC BufferPoolManager::unpinPage(FileHandle & fileHandle,
+                                const PageNum & pageNum,
+                                const bool & dirty)
+{
+    lock_guard<mutex> lock(_latch);
+    auto it = _pageTable.find(pageKeyOf(fileHandle.fileId, pageNum));
+    if (it == _pageTable.end()) {
+        return -1;
+    }
+    Frame & frame = _frames[it->second];
+    if (frame.pinCount == 0) {
+        return -1;
+    }
+    frame.pinCount--;
+    if (dirty) {
+        frame.dirty = true;
+        frame.store = fileHandle.store;
+    }
+    return 0;
+}
+
+RC BufferPoolManager::readPage(FileHandle & fileHandle,
+                               const PageNum & pageNum,
+                               void * data)
+{
+    lock_guard<mutex> lock(_latch);
+    unsigned frameIdx;
+    if (_fetch(fileHandle, pageNum, true, frameIdx) != 0) {
+        // every frame is pinned, go to the disk directly
+        return fileHandle.store->readPage(pageNum, data);
+    }
+    memcpy(data, _frameData(frameIdx), fileHandle.getPageSize());
+    _frames[frameIdx].pinCount--;
+    return 0;
+}
+
+RC BufferPoolManager::writePage(FileHandle & fileHandle,
+                                const PageNum & pageNum,
+                                const void * data)
+{
+    lock_guard<mutex> lock(_latch);
+    unsigned frameIdx;
+    if (_fetch(fileHandle, pageNum, false, frameIdx) != 0) {
+        return fileHandle.store->writePage(pageNum, data);
+    }
+    memcpy(_frameData(frameIdx), data, fileHandle.getPageSize());
+    Frame & frame = _frames[frameIdx];
+    frame.pinCount--;
+    frame.dirty = true;
+    frame.store = fileHandle.store;
+    return 0;
+}
+
+RC BufferPoolManager::readCachedPage(FileHandle & fileHandle,
+                                     const PageNum & pageNum,
+                                     void * data)
+{
+    lock_guard<mutex> lock(_latch);
+    auto it = _pageTable.find(pageKeyOf(fileHandle.fileId, pageNum));
+    if (it == _pageTable.end()) {
+        return -1;
+    }
+    memcpy(data, _frameData(it->second), fileHandle.getPageSize());
+    _frames[it->second].referenced = true;
+    return 0;
+}
+
+RC BufferPoolManager::installPage(FileHandle & fileHandle,
+                                  const PageNum & pageNum,
+                                  const void * data)
+{
+    lock_guard<mutex> lock(_latch);
+    unsigned frameIdx;
+    if (_fetch(fileHandle, pageNum, false, frameIdx) != 0) {
+        // not caching it is fine, the page is on disk already
+        return 0;
+    }
+    memcpy(_frameData(frameIdx), data, fileHandle.getPageSize());
+    _frames[frameIdx].pinCount--;
+    return 0;
+}
+
+// The run [pageNum, pageNum + count) must be contiguous in the file.
+// Pages already in the pool are left alone, they may be newer than the disk.
+// Prefetched frames start without their reference bit, so a scan that never
+// comes back to them doesn't push the rest of the pool out.
+RC BufferPoolManager::prefetch(FileHandle & fileHandle,
+                               const PageNum & pageNum,
+                               const unsigned & count)
+{
+    lock_guard<mutex> lock(_latch);
+    if (_allocate() != 0) {
+        return -1;
+    }
+    // trim pages that are cached already off both ends of the run
+    PageNum first = pageNum;
+    PageNum last = pageNum + count;
+    while (first < last && _pageTable.count(pageKeyOf(fileHandle.fileId, first)) > 0) {
+        first++;
+    }
+    while (last > first && _pageTable.count(pageKeyOf(fileHandle.fileId, last - 1)) > 0) {
+        last--;
+    }
+    if (first == last) {
+        return 0;
+    }
+    unsigned pageSize = fileHandle.getPageSize();
+    size_t bytes = (size_t) pageSize * (last - first);
+    void * run = malloc(bytes);
+    if (fileHandle.store->readPages(first, last - first, run) != 0) {
+        free(run);
+        return -1;
+    }
+    
+    for (PageNum page = first; page < last; page++) {
+        unsigned long long key = pageKeyOf(fileHandle.fileId, page);
+        if (_pageTable.count(key) > 0) {
+            continue;
+        }
+        unsigned frameIdx;
+        if (_findVictim(frameIdx) != 0 || _fitFrame(frameIdx, pageSize) != 0) {
+            break;
+        }
+        memcpy(_frameData(frameIdx), (char*)run + (size_t) pageSize * (page - first), pageSize);
+        Frame & frame = _frames[frameIdx];
+        frame.fileId = fileHandle.fileId;
+        frame.pageNum = page;
+        frame.store = nullptr;
+        frame.pinCount = 0;
+        frame.dirty = false;
+        frame.referenced = false;
+        frame.occupied = true;
+        _pageTable[key] = frameIdx;
+    }
+    free(run);
+    return 0;
+}
+
+RC BufferPoolManager::flushFile(FileHandle & fileHandle)
+{
+    lock_guard<mutex> lock(_latch);
+    RC rc = 0;
+    for (unsigned i = 0; i < _frames.size(); i++) {
+        Frame & frame = _frames[i];
+        if (!frame.occupied || frame.fileId != fileHandle.fileId || frame.store != fileHandle.store) {
+            continue;
+        }
+        if (_writeBack(frame, i) != 0) {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+RC BufferPoolManager::writeBackFile(const unsigned & fileId)
+{
+    lock_guard<mutex> lock(_latch);
+    RC rc = 0;
+    for (unsigned i = 0; i < _frames.size(); i++) {
+        Frame & frame = _frames[i];
+        if (!frame.occupied || frame.fileId != fileId) {
+            continue;
+        }
+        if (_writeBack(frame, i) != 0) {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+RC BufferPoolManager::discardFile(const string & fileName)
+{
+    lock_guard<mutex> lock(_latch);
+    auto it = _fileIds.find(fileName);
+    if (it == _fileIds.end()) {
+        return 0;
+    }
+    for (unsigned i = 0; i < _frames.size(); i++) {
+        Frame & frame = _frames[i];
+        if (!frame.occupied || frame.fileId != it->second) {
+            continue;
+        }
+        _pageTable.erase(pageKeyOf(frame.fileId, frame.pageNum));
+        frame.occupied = false;
+        frame.dirty = false;
+        frame.pinCount = 0;
+        frame.store = nullptr;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------------------
+ PageGuard
+ --------------------------------------------------------------------------------------- */
+
+PageGuard::PageGuard(FileHandle & fileHandle, const PageNum & pageNum)
+: _fileHandle(fileHandle), _pageNum(fileHandle.physicalPageNum(pageNum))
+{
+    if (pageNum >= fileHandle.getNumberOfPages()) {
+        return;
+    }
+    if (fileHandle.store->direct()) {
+        // work on the page inside the store, mappedPage() counts the read
+        _data = (void*) fileHandle.mappedPage(pageNum);
+        _direct = true;
+        _valid = _data != nullptr;
+        return;
+    }
+    if (BufferPoolManager::instance()->pinPage(fileHandle, _pageNum, _data) == 0) {
+        _pinned = true;
+    }
+    else {
+        // pool exhausted, work on a private copy instead
+        _data = malloc(fileHandle.getPageSize());
+        if (fileHandle.store->readPage(_pageNum, _data) != 0) {
+            free(_data);
+            _data = nullptr;
+            return;
+        }
+    }
+    fileHandle.countRead();
+    _valid = true;
+}
+
+PageGuard::~PageGuard()
+{
+    if (!_valid) {
+        return;
+    }
+    if (_direct) {
+        // changed in place already
+        if (_dirty) {
+            _fileHandle.countWrite();
+        }
+        return;
+    }
+    if (_pinned) {
+        BufferPoolManager::instance()->unpinPage(_fileHandle, _pageNum, _dirty);
+    }
+    else {
+        if (_dirty) {
+            _fileHandle.store->writePage(_pageNum, _data);
+        }
+        free(_data);
+    }
+    if (_dirty) {
+        _fileHandle.countWrite();
+    }
+}
+
+bool PageGuard::valid() const
+{
+    return _valid;
+}
+
+char * PageGuard::data()
+{
+    return (char*)_data;
+}
+
+void PageGuard::markDirty()
+{
+    _dirty = true;
+}
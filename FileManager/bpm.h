@@ -0,0 +1,113 @@
+#ifndef _bpm_h_
+#define _bpm_h_
+
+#include <memory>
+#include <mutex>
+
+#include "../Utils/utils.h"
+
+using namespace std;
+
+class FileHandle;
+class PageStore;
+
+// One slot of the buffer pool. A frame is identified by (fileId, pageNum);
+// store is the file a dirty frame has to be written back to. It is shared with
+// the FileHandles so it stays valid after they are closed, and dropped once the frame is clean.
+typedef struct
+{
+    unsigned fileId;
+    PageNum pageNum;
+    void * data;        // pageSize bytes, kept when the frame is reused for a page of the same size
+    unsigned pageSize;
+    shared_ptr<PageStore> store;
+    unsigned pinCount;
+    bool dirty;
+    bool referenced;    // second-chance bit for the CLOCK replacement policy
+    bool occupied;
+} Frame;
+
+// Process-wide page cache shared by every FileHandle.
+// FileHandle::readPage()/writePage() go through it, so pages that are touched
+// over and over (slot directories, B+tree roots, catalog pages) stay in memory.
+// Dirty frames are written back on eviction and when their file gets closed.
+// The pool addresses pages by their physical position in the file;
+// FileHandle and PageGuard map logical page numbers onto it.
+// Files whose store is direct (mapped, in memory) never get a frame.
+// A frame holds one page of whatever size its file uses, so the pool is sized in pages, not bytes.
+class BufferPoolManager
+{
+public:
+    static BufferPoolManager* instance();                                // Access to the _bp_manager instance
+
+    RC setFrameCount(const unsigned & frameCount);                       // Resize the pool, fails if any frame is pinned
+    unsigned getFrameCount();
+
+    unsigned fileIdOf(const string & fileName);                          // Stable id of a file name inside the pool
+
+    RC pinPage(FileHandle & fileHandle, const PageNum & pageNum, void* & frameData);
+    RC unpinPage(FileHandle & fileHandle, const PageNum & pageNum, const bool & dirty);
+
+    RC readPage(FileHandle & fileHandle, const PageNum & pageNum, void * data);           // copy a page out of the pool
+    RC writePage(FileHandle & fileHandle, const PageNum & pageNum, const void * data);    // copy a page into the pool, marked dirty
+    RC installPage(FileHandle & fileHandle, const PageNum & pageNum, const void * data);  // cache a page that is already on disk
+    RC readCachedPage(FileHandle & fileHandle, const PageNum & pageNum, void * data);     // copy a page out only if it is cached
+    RC prefetch(FileHandle & fileHandle, const PageNum & pageNum, const unsigned & count); // bring a run of pages in with one read
+
+    RC flushFile(FileHandle & fileHandle);                               // write back dirty frames owned by this handle
+    RC writeBackFile(const unsigned & fileId);                           // write back dirty frames of a file, whoever dirtied them
+    RC discardFile(const string & fileName);                             // drop every frame of a file without writing it
+
+protected:
+    BufferPoolManager();
+    ~BufferPoolManager();
+
+private:
+    static BufferPoolManager * _bp_manager;
+
+    unsigned _frameCount;
+    vector<Frame> _frames;
+    unordered_map<unsigned long long, unsigned> _pageTable;              // (fileId, pageNum) -> frame index
+    unordered_map<string, unsigned> _fileIds;
+    unsigned _clockHand = 0;
+    mutex _latch;
+
+    RC _allocate();
+    void _release();
+    RC _fitFrame(const unsigned & frameIdx, const unsigned & pageSize);
+    RC _findVictim(unsigned & frameIdx);
+    RC _writeBack(Frame & frame, const unsigned & frameIdx);
+    RC _fetch(FileHandle & fileHandle, const PageNum & pageNum, const bool & loadFromDisk, unsigned & frameIdx);
+    void * _frameData(const unsigned & frameIdx);
+};
+
+// PageGuard pins a page for as long as the guard lives.
+// The page can be read and modified in place through data();
+// call markDirty() after modifying it. The pin is released by the destructor.
+// If every frame is pinned, the guard falls back to a private copy of the page.
+// On a direct store data() points at the page inside the store;
+// on a MmapReadOnly handle it must not be modified.
+class PageGuard
+{
+public:
+    PageGuard(FileHandle & fileHandle, const PageNum & pageNum);
+    ~PageGuard();
+
+    bool valid() const;
+    char * data();
+    void markDirty();
+
+private:
+    FileHandle & _fileHandle;
+    PageNum _pageNum;   // physical
+    void * _data = nullptr;
+    bool _pinned = false;
+    bool _dirty = false;
+    bool _valid = false;
+    bool _direct = false;   // _data points into the store itself
+
+    PageGuard(const PageGuard &);
+    PageGuard & operator = (const PageGuard &);
+};
+
+#endif /* bpm_h */
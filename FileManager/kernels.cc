@@ -0,0 +1,336 @@
+#include "kernels.h"
+
+// the SIMD versions are compiled for their instruction set function by function (target attributes),
+// so the rest of the build doesn't need -mavx2 and the CPU is asked at run time
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define KERNELS_HAVE_X86 1
+#endif
+
+
+/* ---------------------------------------------------------------------------------------
+ Dispatch
+ --------------------------------------------------------------------------------------- */
+
+KernelLevel detectedKernelLevel()
+{
+#ifdef KERNELS_HAVE_X86
+    __builtin_cpu_init();
+    // also false where the OS doesn't save the AVX registers
+    if (__builtin_cpu_supports("avx2")) {
+        return Avx2Kernels;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SseKernels;
+    }
+#endif
+    return ScalarKernels;
+}
+
+const KernelLevel SUPPORTED_KERNEL_LEVEL = detectedKernelLevel();
+KernelLevel _kernelLevel = SUPPORTED_KERNEL_LEVEL;
+
+KernelLevel kernelLevel()
+{
+    return _kernelLevel;
+}
+
+// meant to be called while no scan runs, e.g. to compare levels in a benchmark
+RC useKernelLevel(const KernelLevel & level)
+{
+    if (level > SUPPORTED_KERNEL_LEVEL) {
+        return -1;
+    }
+    _kernelLevel = level;
+    return 0;
+}
+
+// a movemask has value 0 in its lowest bit, the selection masks have it in the highest
+struct BitReversal
+{
+    unsigned char table[256];
+    BitReversal() {
+        for (unsigned bits = 0; bits < 256; bits++) {
+            unsigned char reversed = 0;
+            for (unsigned b = 0; b < BITES_PER_BYTE; b++) {
+                if (bits & (1 << b)) {
+                    reversed |= (unsigned char) (0x80 >> b);
+                }
+            }
+            table[bits] = reversed;
+        }
+    }
+};
+
+const BitReversal BIT_REVERSAL;
+
+
+/* ---------------------------------------------------------------------------------------
+ Scalar
+ --------------------------------------------------------------------------------------- */
+
+template<CompOp op, typename T>
+inline bool satisfies(const T & attr, const T & value)
+{
+    switch (op) {
+        case EQ_OP:
+            return attr == value;
+        case LT_OP:
+            return attr < value;
+        case LE_OP:
+            return attr <= value;
+        case GT_OP:
+            return attr > value;
+        case GE_OP:
+            return attr >= value;
+        case NE_OP:
+            return attr != value;
+        default:
+            return true;
+    }
+}
+
+// values [from, count), from is a multiple of 8
+template<CompOp op, typename T>
+void scalarSelect(const T * values, const unsigned & from, const unsigned & count, const T & value, unsigned char * mask)
+{
+    for (unsigned i = from; i < count; i++) {
+        if (satisfies<op>(values[i], value)) {
+            mask[i / BITES_PER_BYTE] |= (unsigned char) (0x80 >> (i % BITES_PER_BYTE));
+        }
+    }
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ SSE2 / AVX2
+ Each returns how many values it did, always a multiple of 8; the scalar loop does the rest.
+ Ints only have == and >, the other comparisons swap the operands or flip the outcome.
+ --------------------------------------------------------------------------------------- */
+
+#ifdef KERNELS_HAVE_X86
+
+template<CompOp op>
+inline bool flipped()
+{
+    return op == NE_OP || op == LE_OP || op == GE_OP;
+}
+
+template<CompOp op>
+__attribute__((target("sse2")))
+unsigned sseSelectInts(const int * values, const unsigned & count, const int & value, unsigned char * mask)
+{
+    __m128i constant = _mm_set1_epi32(value);
+    unsigned i = 0;
+    for (; i + BITES_PER_BYTE <= count; i += BITES_PER_BYTE) {
+        int bits = 0;
+        for (unsigned half = 0; half < 2; half++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(values + i + 4 * half));
+            __m128i hit;
+            if (op == EQ_OP || op == NE_OP) {
+                hit = _mm_cmpeq_epi32(v, constant);
+            }
+            else if (op == GT_OP || op == LE_OP) {
+                hit = _mm_cmpgt_epi32(v, constant);
+            }
+            else {
+                hit = _mm_cmpgt_epi32(constant, v);
+            }
+            bits |= _mm_movemask_ps(_mm_castsi128_ps(hit)) << (4 * half);
+        }
+        if (flipped<op>()) {
+            bits ^= 0xFF;
+        }
+        mask[i / BITES_PER_BYTE] = BIT_REVERSAL.table[bits];
+    }
+    return i;
+}
+
+template<CompOp op>
+__attribute__((target("avx2")))
+unsigned avx2SelectInts(const int * values, const unsigned & count, const int & value, unsigned char * mask)
+{
+    __m256i constant = _mm256_set1_epi32(value);
+    unsigned i = 0;
+    for (; i + BITES_PER_BYTE <= count; i += BITES_PER_BYTE) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i hit;
+        if (op == EQ_OP || op == NE_OP) {
+            hit = _mm256_cmpeq_epi32(v, constant);
+        }
+        else if (op == GT_OP || op == LE_OP) {
+            hit = _mm256_cmpgt_epi32(v, constant);
+        }
+        else {
+            hit = _mm256_cmpgt_epi32(constant, v);
+        }
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (flipped<op>()) {
+            bits ^= 0xFF;
+        }
+        mask[i / BITES_PER_BYTE] = BIT_REVERSAL.table[bits];
+    }
+    return i;
+}
+
+// floats have every comparison; != is unordered, true for NaN like the scalar !=
+template<CompOp op>
+__attribute__((target("sse2")))
+inline __m128 sseCompare(const __m128 & v, const __m128 & constant)
+{
+    switch (op) {
+        case EQ_OP:
+            return _mm_cmpeq_ps(v, constant);
+        case LT_OP:
+            return _mm_cmplt_ps(v, constant);
+        case LE_OP:
+            return _mm_cmple_ps(v, constant);
+        case GT_OP:
+            return _mm_cmpgt_ps(v, constant);
+        case GE_OP:
+            return _mm_cmpge_ps(v, constant);
+        default:
+            return _mm_cmpneq_ps(v, constant);
+    }
+}
+
+template<CompOp op>
+__attribute__((target("sse2")))
+unsigned sseSelectReals(const float * values, const unsigned & count, const float & value, unsigned char * mask)
+{
+    __m128 constant = _mm_set1_ps(value);
+    unsigned i = 0;
+    for (; i + BITES_PER_BYTE <= count; i += BITES_PER_BYTE) {
+        int low = _mm_movemask_ps(sseCompare<op>(_mm_loadu_ps(values + i), constant));
+        int high = _mm_movemask_ps(sseCompare<op>(_mm_loadu_ps(values + i + 4), constant));
+        mask[i / BITES_PER_BYTE] = BIT_REVERSAL.table[low | (high << 4)];
+    }
+    return i;
+}
+
+template<CompOp op>
+__attribute__((target("avx2")))
+inline __m256 avxCompare(const __m256 & v, const __m256 & constant)
+{
+    switch (op) {
+        case EQ_OP:
+            return _mm256_cmp_ps(v, constant, _CMP_EQ_OQ);
+        case LT_OP:
+            return _mm256_cmp_ps(v, constant, _CMP_LT_OQ);
+        case LE_OP:
+            return _mm256_cmp_ps(v, constant, _CMP_LE_OQ);
+        case GT_OP:
+            return _mm256_cmp_ps(v, constant, _CMP_GT_OQ);
+        case GE_OP:
+            return _mm256_cmp_ps(v, constant, _CMP_GE_OQ);
+        default:
+            return _mm256_cmp_ps(v, constant, _CMP_NEQ_UQ);
+    }
+}
+
+template<CompOp op>
+__attribute__((target("avx2")))
+unsigned avx2SelectReals(const float * values, const unsigned & count, const float & value, unsigned char * mask)
+{
+    __m256 constant = _mm256_set1_ps(value);
+    unsigned i = 0;
+    for (; i + BITES_PER_BYTE <= count; i += BITES_PER_BYTE) {
+        int bits = _mm256_movemask_ps(avxCompare<op>(_mm256_loadu_ps(values + i), constant));
+        mask[i / BITES_PER_BYTE] = BIT_REVERSAL.table[bits];
+    }
+    return i;
+}
+
+#endif
+
+
+/* ---------------------------------------------------------------------------------------
+ Entry points
+ --------------------------------------------------------------------------------------- */
+
+template<CompOp op>
+RC selectIntsBy(const int * values, const unsigned & count, const int & value, unsigned char * mask)
+{
+    unsigned done = 0;
+#ifdef KERNELS_HAVE_X86
+    if (_kernelLevel == Avx2Kernels) {
+        done = avx2SelectInts<op>(values, count, value, mask);
+    }
+    else if (_kernelLevel == SseKernels) {
+        done = sseSelectInts<op>(values, count, value, mask);
+    }
+#endif
+    scalarSelect<op>(values, done, count, value, mask);
+    return 0;
+}
+
+template<CompOp op>
+RC selectRealsBy(const float * values, const unsigned & count, const float & value, unsigned char * mask)
+{
+    unsigned done = 0;
+#ifdef KERNELS_HAVE_X86
+    if (_kernelLevel == Avx2Kernels) {
+        done = avx2SelectReals<op>(values, count, value, mask);
+    }
+    else if (_kernelLevel == SseKernels) {
+        done = sseSelectReals<op>(values, count, value, mask);
+    }
+#endif
+    scalarSelect<op>(values, done, count, value, mask);
+    return 0;
+}
+
+RC selectAll(const unsigned & count, unsigned char * mask)
+{
+    memset(mask, 0xFF, count / BITES_PER_BYTE);
+    if (count % BITES_PER_BYTE != 0) {
+        mask[count / BITES_PER_BYTE] = (unsigned char) (0xFF << (BITES_PER_BYTE - count % BITES_PER_BYTE));
+    }
+    return 0;
+}
+
+RC selectInts(const int * values, const unsigned & count, const CompOp & compOp, const int & value, unsigned char * mask)
+{
+    memset(mask, 0, (count + BITES_PER_BYTE - 1) / BITES_PER_BYTE);
+    switch (compOp) {
+        case EQ_OP:
+            return selectIntsBy<EQ_OP>(values, count, value, mask);
+        case LT_OP:
+            return selectIntsBy<LT_OP>(values, count, value, mask);
+        case LE_OP:
+            return selectIntsBy<LE_OP>(values, count, value, mask);
+        case GT_OP:
+            return selectIntsBy<GT_OP>(values, count, value, mask);
+        case GE_OP:
+            return selectIntsBy<GE_OP>(values, count, value, mask);
+        case NE_OP:
+            return selectIntsBy<NE_OP>(values, count, value, mask);
+        case NO_OP:
+            return selectAll(count, mask);
+        default:
+            return -1;
+    }
+}
+
+RC selectReals(const float * values, const unsigned & count, const CompOp & compOp, const float & value, unsigned char * mask)
+{
+    memset(mask, 0, (count + BITES_PER_BYTE - 1) / BITES_PER_BYTE);
+    switch (compOp) {
+        case EQ_OP:
+            return selectRealsBy<EQ_OP>(values, count, value, mask);
+        case LT_OP:
+            return selectRealsBy<LT_OP>(values, count, value, mask);
+        case LE_OP:
+            return selectRealsBy<LE_OP>(values, count, value, mask);
+        case GT_OP:
+            return selectRealsBy<GT_OP>(values, count, value, mask);
+        case GE_OP:
+            return selectRealsBy<GE_OP>(values, count, value, mask);
+        case NE_OP:
+            return selectRealsBy<NE_OP>(values, count, value, mask);
+        case NO_OP:
+            return selectAll(count, mask);
+        default:
+            return -1;
+    }
+}
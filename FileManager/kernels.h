@@ -0,0 +1,27 @@
+#ifndef _kernels_h_
+#define _kernels_h_
+
+#include "../Utils/utils.h"
+
+using namespace std;
+
+// How wide the comparison kernels run, picked once from what the CPU supports
+typedef enum {
+    ScalarKernels = 0,  // plain loops, everywhere
+    SseKernels,         // 4 values at a time (SSE2)
+    Avx2Kernels         // 8 values at a time (AVX2)
+} KernelLevel;
+
+// Comparison kernels over a column of values, e.g. a RecordBatch column:
+// every value is compared with one constant and the outcome goes into a selection mask,
+// a bit per value in the order of the null bitmaps (0x80 >> (i % 8) of byte i / 8).
+// The mask takes (count + 7) / 8 bytes, bits past count are cleared; NO_OP selects everything.
+//  vector<unsigned char> mask((count + 7) / 8);
+//  selectInts(values, count, GE_OP, 1000, mask.data());
+RC selectInts(const int * values, const unsigned & count, const CompOp & compOp, const int & value, unsigned char * mask);
+RC selectReals(const float * values, const unsigned & count, const CompOp & compOp, const float & value, unsigned char * mask);
+
+KernelLevel kernelLevel();                          // the level selectInts() / selectReals() use
+RC useKernelLevel(const KernelLevel & level);       // run at a lower level instead, -1 if the CPU can't do it
+
+#endif /* kernels_h */
@@ -0,0 +1,421 @@
+#include "pagestore.h"
+
+
+/* ---------------------------------------------------------------------------------------
+ PageStore defaults
+ --------------------------------------------------------------------------------------- */
+
+RC PageStore::readPages(const PageNum & pageNum, const unsigned & count, void * data)
+{
+    for (unsigned i = 0; i < count; i++) {
+        if (readPage(pageNum + i, (char*)data + (size_t) _pageSize * i) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+RC PageStore::writePages(const PageNum & pageNum, const unsigned & count, const void * data)
+{
+    for (unsigned i = 0; i < count; i++) {
+        if (writePage(pageNum + i, (const char*)data + (size_t) _pageSize * i) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+bool PageStore::direct()
+{
+    return false;
+}
+
+char * PageStore::pagePointer(const PageNum & pageNum)
+{
+    return nullptr;
+}
+
+RC PageStore::refresh()
+{
+    return 0;
+}
+
+RC PageStore::advise(const PageNum & pageNum, const unsigned & count, const bool & sequential)
+{
+    return 0;
+}
+
+int PageStore::getFd()
+{
+    return FD_NOT_OPEN;
+}
+
+bool PageStore::readOnly()
+{
+    return false;
+}
+
+RC PageStore::setPageSize(const unsigned & pageSize)
+{
+    _pageSize = pageSize;
+    return 0;
+}
+
+unsigned PageStore::getPageSize()
+{
+    return _pageSize;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ PosixPageStore
+ --------------------------------------------------------------------------------------- */
+
+PosixPageStore::PosixPageStore(const int & fd, const bool & readOnly)
+: _fd(fd), _readOnly(readOnly)
+{
+}
+
+PosixPageStore::~PosixPageStore()
+{
+    if (_fd != FD_NOT_OPEN) {
+        close(_fd);
+    }
+}
+
+/*
+ int open(const char * path, int oflag, ...);
+ if not success, -1 is returned.
+ */
+PosixPageStore * PosixPageStore::create(const string & fileName)
+{
+    int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return new PosixPageStore(fd, false);
+}
+
+PosixPageStore * PosixPageStore::open(const string & fileName, const bool & readOnly)
+{
+    int fd = ::open(fileName.c_str(), readOnly ? O_RDONLY : O_RDWR);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return new PosixPageStore(fd, readOnly);
+}
+
+/*
+ pread(int fd, void * buf, size_t nbyte, off_t offset) / pwrite(...)
+ read or write at an absolute offset without moving any shared file position,
+ so concurrent readers of one descriptor don't step on each other.
+ They return the number of bytes transferred.
+ */
+RC PosixPageStore::readPage(const PageNum & pageNum, void * data)
+{
+    if (pread(_fd, data, _pageSize, (off_t) _pageSize * pageNum) != (ssize_t) _pageSize) {
+        return -1;
+    }
+    return 0;
+}
+
+RC PosixPageStore::writePage(const PageNum & pageNum, const void * data)
+{
+    if (_readOnly || pwrite(_fd, data, _pageSize, (off_t) _pageSize * pageNum) != (ssize_t) _pageSize) {
+        return -1;
+    }
+    return 0;
+}
+
+RC PosixPageStore::readPages(const PageNum & pageNum, const unsigned & count, void * data)
+{
+    size_t bytes = (size_t) _pageSize * count;
+    if (pread(_fd, data, bytes, (off_t) _pageSize * pageNum) != (ssize_t) bytes) {
+        return -1;
+    }
+    return 0;
+}
+
+RC PosixPageStore::writePages(const PageNum & pageNum, const unsigned & count, const void * data)
+{
+    size_t bytes = (size_t) _pageSize * count;
+    if (_readOnly || pwrite(_fd, data, bytes, (off_t) _pageSize * pageNum) != (ssize_t) bytes) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ int fallocate(int fd, int mode, off_t offset, off_t len) allocates the blocks and extends the file in one call,
+ so a run of appends doesn't update the file's metadata and allocation page by page.
+ */
+RC PosixPageStore::extend(const unsigned & pageCount)
+{
+    if (_readOnly) {
+        return -1;
+    }
+    unsigned size = getSize();
+    if (pageCount <= size) {
+        return 0;
+    }
+    off_t from = (off_t) _pageSize * size;
+    off_t length = (off_t) _pageSize * (pageCount - size);
+#ifdef __linux__
+    if (fallocate(_fd, 0, from, length) == 0) {
+        return 0;
+    }
+#endif
+    // filesystems without fallocate() still get a file of the right size
+    if (ftruncate(_fd, from + length) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ fstat(int fd, struct stat * buf) fills st_size with the current size of the file
+ */
+unsigned PosixPageStore::getSize()
+{
+    struct stat file_stat;
+    if (fstat(_fd, &file_stat) != 0) {
+        return 0;
+    }
+    return (unsigned) (file_stat.st_size / _pageSize);
+}
+
+RC PosixPageStore::sync()
+{
+    if (_readOnly) {
+        return 0;
+    }
+    if (fdatasync(_fd) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// posix_fadvise() is a hint; where it doesn't exist nothing is lost
+RC PosixPageStore::advise(const PageNum & pageNum, const unsigned & count, const bool & sequential)
+{
+#ifdef POSIX_FADV_WILLNEED
+    if (posix_fadvise(_fd,
+                      (off_t) _pageSize * pageNum,
+                      (off_t) _pageSize * count,
+                      sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_WILLNEED) != 0) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+int PosixPageStore::getFd()
+{
+    return _fd;
+}
+
+bool PosixPageStore::readOnly()
+{
+    return _readOnly;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ MmapPageStore
+ --------------------------------------------------------------------------------------- */
+
+MmapPageStore::MmapPageStore(const int & fd)
+: PosixPageStore(fd, true)
+{
+}
+
+MmapPageStore::~MmapPageStore()
+{
+    if (_base != nullptr) {
+        munmap(_base, _bytes);
+    }
+}
+
+MmapPageStore * MmapPageStore::open(const string & fileName)
+{
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    MmapPageStore * store = new MmapPageStore(fd);
+    if (store->refresh() != 0) {
+        delete store;
+        return nullptr;
+    }
+    return store;
+}
+
+/*
+ mmap(void * addr, size_t len, int prot, int flags, int fd, off_t offset)
+ MAP_SHARED keeps the mapping in sync with the page cache, so pages written back later show up in it.
+ */
+RC MmapPageStore::refresh()
+{
+    struct stat file_stat;
+    if (fstat(_fd, &file_stat) != 0) {
+        return -1;
+    }
+    if ((size_t) file_stat.st_size == _bytes) {
+        return 0;
+    }
+    if (_base != nullptr) {
+        munmap(_base, _bytes);
+        _base = nullptr;
+        _bytes = 0;
+    }
+    void * addr = mmap(nullptr, (size_t) file_stat.st_size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (addr == MAP_FAILED) {
+        return -1;
+    }
+    _base = (char*)addr;
+    _bytes = (size_t) file_stat.st_size;
+    return 0;
+}
+
+bool MmapPageStore::direct()
+{
+    return true;
+}
+
+char * MmapPageStore::pagePointer(const PageNum & pageNum)
+{
+    if ((size_t) _pageSize * (pageNum + 1) > _bytes) {
+        return nullptr;
+    }
+    return _base + (size_t) _pageSize * pageNum;
+}
+
+RC MmapPageStore::readPage(const PageNum & pageNum, void * data)
+{
+    char * page = pagePointer(pageNum);
+    if (page == nullptr) {
+        return -1;
+    }
+    memcpy(data, page, _pageSize);
+    return 0;
+}
+
+RC MmapPageStore::writePage(const PageNum & pageNum, const void * data)
+{
+    return -1;
+}
+
+RC MmapPageStore::readPages(const PageNum & pageNum, const unsigned & count, void * data)
+{
+    if ((size_t) _pageSize * (pageNum + count) > _bytes) {
+        return -1;
+    }
+    memcpy(data, _base + (size_t) _pageSize * pageNum, (size_t) _pageSize * count);
+    return 0;
+}
+
+RC MmapPageStore::writePages(const PageNum & pageNum, const unsigned & count, const void * data)
+{
+    return -1;
+}
+
+RC MmapPageStore::extend(const unsigned & pageCount)
+{
+    return -1;
+}
+
+RC MmapPageStore::advise(const PageNum & pageNum, const unsigned & count, const bool & sequential)
+{
+    if (_base == nullptr || (size_t) _pageSize * pageNum >= _bytes) {
+        return -1;
+    }
+    size_t bytes = (size_t) _pageSize * count;
+    if ((size_t) _pageSize * pageNum + bytes > _bytes) {
+        bytes = _bytes - (size_t) _pageSize * pageNum;
+    }
+    if (madvise(_base + (size_t) _pageSize * pageNum, bytes, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ MemoryPageStore
+ --------------------------------------------------------------------------------------- */
+
+MemoryPageStore::~MemoryPageStore()
+{
+    for (unsigned i = 0; i < _pages.size(); i++) {
+        free(_pages[i]);
+    }
+}
+
+bool MemoryPageStore::direct()
+{
+    return true;
+}
+
+// every page is its own allocation, so pointers handed out stay valid while the store grows
+char * MemoryPageStore::pagePointer(const PageNum & pageNum)
+{
+    lock_guard<mutex> lock(_latch);
+    if (pageNum >= _pages.size()) {
+        return nullptr;
+    }
+    return _pages[pageNum];
+}
+
+RC MemoryPageStore::readPage(const PageNum & pageNum, void * data)
+{
+    char * page = pagePointer(pageNum);
+    if (page == nullptr) {
+        return -1;
+    }
+    memcpy(data, page, _pageSize);
+    return 0;
+}
+
+RC MemoryPageStore::writePage(const PageNum & pageNum, const void * data)
+{
+    if (extend(pageNum + 1) != 0) {
+        return -1;
+    }
+    memcpy(pagePointer(pageNum), data, _pageSize);
+    return 0;
+}
+
+RC MemoryPageStore::extend(const unsigned & pageCount)
+{
+    lock_guard<mutex> lock(_latch);
+    while (_pages.size() < pageCount) {
+        char * page = (char*) malloc(_pageSize);
+        if (page == nullptr) {
+            return -1;
+        }
+        memset(page, 0, _pageSize);
+        _pages.push_back(page);
+    }
+    return 0;
+}
+
+unsigned MemoryPageStore::getSize()
+{
+    lock_guard<mutex> lock(_latch);
+    return (unsigned) _pages.size();
+}
+
+RC MemoryPageStore::setPageSize(const unsigned & pageSize)
+{
+    lock_guard<mutex> lock(_latch);
+    if (!_pages.empty() && pageSize != _pageSize) {
+        return -1;
+    }
+    _pageSize = pageSize;
+    return 0;
+}
+
+RC MemoryPageStore::sync()
+{
+    return 0;
+}
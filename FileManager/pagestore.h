@@ -0,0 +1,120 @@
+#ifndef _pagestore_h_
+#define _pagestore_h_
+
+#include <mutex>
+#include <sys/mman.h>
+
+#include "../Utils/utils.h"
+
+using namespace std;
+
+// Where the pages of a file are kept, chosen when the file is created
+typedef enum {
+    PosixStorage = 0,   // a file on disk
+    MemoryStorage       // pages in process memory, gone when the file is destroyed or the process exits
+} StorageBackend;
+
+// The pages of one open file. Page numbers are physical here (header and free-space map pages included);
+// FileHandle does the logical to physical mapping and decides what goes through the buffer pool.
+// Pages are PAGE_SIZE until the header of the file says otherwise (setPageSize()).
+// Stores that hand out pointers to their pages (direct()) are accessed in place
+// and never cached in the pool.
+class PageStore
+{
+public:
+    virtual ~PageStore() {};
+
+    virtual RC readPage(const PageNum & pageNum, void * data) = 0;
+    virtual RC writePage(const PageNum & pageNum, const void * data) = 0;
+    virtual RC readPages(const PageNum & pageNum, const unsigned & count, void * data);     // a contiguous run
+    virtual RC writePages(const PageNum & pageNum, const unsigned & count, const void * data);
+
+    virtual RC extend(const unsigned & pageCount) = 0;         // make room for at least pageCount pages
+    virtual unsigned getSize() = 0;                            // pages the store has room for
+    virtual RC sync() = 0;                                     // force written pages to stable storage
+
+    virtual bool direct();                                     // pages are reached through pagePointer()
+    virtual char * pagePointer(const PageNum & pageNum);       // the page itself, nullptr if the store can't
+    virtual RC refresh();                                      // pick up pages another handle added
+    virtual RC advise(const PageNum & pageNum, const unsigned & count, const bool & sequential);
+    virtual int getFd();                                       // for the AsyncIOManager, FD_NOT_OPEN if there is none
+    virtual bool readOnly();
+
+    virtual RC setPageSize(const unsigned & pageSize);
+    unsigned getPageSize();
+
+protected:
+    unsigned _pageSize = PAGE_SIZE;
+};
+
+// pread()/pwrite() at PAGE_SIZE * pageNum on a file descriptor
+class PosixPageStore : public PageStore
+{
+public:
+    static PosixPageStore * create(const string & fileName);   // fails if the file exists
+    static PosixPageStore * open(const string & fileName, const bool & readOnly);
+    ~PosixPageStore();
+
+    RC readPage(const PageNum & pageNum, void * data);
+    RC writePage(const PageNum & pageNum, const void * data);
+    RC readPages(const PageNum & pageNum, const unsigned & count, void * data);
+    RC writePages(const PageNum & pageNum, const unsigned & count, const void * data);
+    RC extend(const unsigned & pageCount);
+    unsigned getSize();
+    RC sync();
+    RC advise(const PageNum & pageNum, const unsigned & count, const bool & sequential);
+    int getFd();
+    bool readOnly();
+
+protected:
+    PosixPageStore(const int & fd, const bool & readOnly);
+    int _fd;
+    bool _readOnly;
+};
+
+// A read-only mapping of the whole file; pages are read straight out of it.
+class MmapPageStore : public PosixPageStore
+{
+public:
+    static MmapPageStore * open(const string & fileName);
+    ~MmapPageStore();
+
+    RC readPage(const PageNum & pageNum, void * data);
+    RC writePage(const PageNum & pageNum, const void * data);
+    RC readPages(const PageNum & pageNum, const unsigned & count, void * data);
+    RC writePages(const PageNum & pageNum, const unsigned & count, const void * data);
+    RC extend(const unsigned & pageCount);
+
+    bool direct();
+    char * pagePointer(const PageNum & pageNum);
+    RC refresh();                                              // map the current length of the file again
+    RC advise(const PageNum & pageNum, const unsigned & count, const bool & sequential);
+
+protected:
+    MmapPageStore(const int & fd);
+    char * _base = nullptr;
+    size_t _bytes = 0;
+};
+
+// Pages in memory, shared by every handle of the file
+class MemoryPageStore : public PageStore
+{
+public:
+    ~MemoryPageStore();
+
+    RC readPage(const PageNum & pageNum, void * data);
+    RC writePage(const PageNum & pageNum, const void * data);
+    RC extend(const unsigned & pageCount);
+    unsigned getSize();
+    RC sync();
+
+    bool direct();
+    char * pagePointer(const PageNum & pageNum);
+    RC setPageSize(const unsigned & pageSize);                 // can't change once there are pages
+
+private:
+    vector<char*> _pages;
+    mutex _latch;
+};
+
+#endif /* pagestore_h */
@@ -14,6 +14,7 @@ PagedFileManager* PagedFileManager::instance()
 
 PagedFileManager::PagedFileManager()
 {
+    _bpm = BufferPoolManager::instance();
 }
 
 // ~myfunc() : does the opposite as the myfunc() does
@@ -23,104 +24,300 @@ PagedFileManager::~PagedFileManager()
     delete _pf_manager;
 }
 
+/*
+ The header is the only page that bypasses the buffer pool,
+ it is read once by openFile() and written back by closeFile()/sync().
+ */
+bool validPageSize(const unsigned & pageSize)
+{
+    // a power of two, so pages stay aligned to the blocks of the file system
+    return pageSize >= PAGE_SIZE && pageSize <= MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+// the store reads PAGE_SIZE bytes until it knows better, the header always fits in them
+RC readHeaderFrom(PageStore & store, FileHeader & header)
+{
+    void * buffer = malloc(store.getPageSize());
+    if (store.readPage(0, buffer) != 0) {
+        free(buffer);
+        return -1;
+    }
+    memcpy(&header, buffer, sizeof(FileHeader));
+    free(buffer);
+    if (header.magic != FILE_MAGIC || header.version != FILE_FORMAT_VERSION || !validPageSize(header.pageSize)) {
+        return -1;
+    }
+    return 0;
+}
+
+RC writeHeaderTo(PageStore & store, const FileHeader & header)
+{
+    void * buffer = malloc(store.getPageSize());
+    memset(buffer, 0, store.getPageSize());
+    memcpy(buffer, &header, sizeof(FileHeader));
+    RC rc = store.writePage(0, buffer);
+    free(buffer);
+    return rc;
+}
+
 RC PagedFileManager::createFile(const string &fileName)
 {
+    return createFile(fileName, _defaultStorage, _defaultPageSize);
+}
+
+
+RC PagedFileManager::createFile(const string &fileName, const StorageBackend backend, const unsigned pageSize)
+{
+    unsigned bytes = pageSize == 0 ? _defaultPageSize : pageSize;
+    if (!validPageSize(bytes)) {
+        return -1;
+    }
     
-    if (_utils->fileExists(fileName) || _utils->fileExists(_utils->statFileNameOf(fileName))) {
+    if (fileExists(fileName)) {
         cout << "PagedFileManager::createFile(const string &fileName) -> the file already exists." << endl;
         return -1;
     }
-    ofstream file; // <fstream>
-    file.open(fileName.c_str());
-    file.close();
+    // a file of the same name may have been destroyed earlier, don't let its pages come back
+    _bpm->discardFile(fileName);
     
-    ofstream fileStat;
-    fileStat.open(_utils->statFileNameOf(fileName).c_str());
-    fileStat.close();
+    shared_ptr<PageStore> store;
+    if (backend == MemoryStorage) {
+        store = make_shared<MemoryPageStore>();
+    }
+    else {
+        store = shared_ptr<PageStore>(PosixPageStore::create(fileName));
+    }
+    if (store == nullptr || store->setPageSize(bytes) != 0) {
+        return -1;
+    }
     
-    // make readPageCounter/writePageCounter/appendPageCounter persistent -> create a ".fileName.stat" for each "fileName".
-    FILE * fptr = fopen(_utils->statFileNameOf(fileName).c_str(), "rb+");
-    void * buffer = malloc(sizeof(unsigned) * STAT_NUM);
-    unsigned counter = 0;
-    memcpy((char*)buffer + READ_PAGE_COUNTER_OFFSET, & counter, sizeof(unsigned));
-    memcpy((char*)buffer + WRITE_PAGE_COUNTER_OFFSET, & counter, sizeof(unsigned));
-    memcpy((char*)buffer + APPEND_PAGE_COUNTER_OFFSET, & counter, sizeof(unsigned));
+    // page 0 keeps the page count and the read/write/append counters, no sidecar file is needed
+    FileHeader header;
+    header.magic = FILE_MAGIC;
+    header.version = FILE_FORMAT_VERSION;
+    header.pageSize = bytes;
+    header.pageCount = 0;
+    header.readPageCounter = 0;
+    header.writePageCounter = 0;
+    header.appendPageCounter = 0;
+    header.freeSpaceRoot = NULL_PAGE;
+    header.indexRoot = NULL_PAGE;
+    memset(header.groupMaxBucket, 0, FSM_MAX_GROUPS);
     
-    fwrite((char*)buffer, sizeof(char), sizeof(unsigned) * STAT_NUM, fptr);
-    fflush(fptr);
-    free(buffer);
-    fclose(fptr);
+    if (writeHeaderTo(*store, header) != 0) {
+        return -1;
+    }
+    // an in-memory file lives as long as its entry here, not as long as its handles
+    if (backend == MemoryStorage) {
+        _memoryFiles[fileName] = store;
+    }
     return 0;
 }
 
 
 RC PagedFileManager::destroyFile(const string &fileName)
 {
-    if (!_utils->fileExists(fileName) || !_utils->fileExists(_utils->statFileNameOf(fileName))) {
+    if (_memoryFiles.erase(fileName) > 0) {
+        // handles still open on it keep the pages until they are closed
+    }
+    else if (!_utils->fileExists(fileName)) {
         return -1;
     }
-    if (remove(fileName.c_str()) != 0 || remove(_utils->statFileNameOf(fileName).c_str()) != 0) {
+    else if (remove(fileName.c_str()) != 0) {
         return -1;
     }
+    _bpm->discardFile(fileName);
+    // handles still holding the old header keep it alive, a new file of this name starts over
+    _openFiles.erase(fileName);
     return 0;
 }
 
 
-/*
- FILE * fopen ( const char * filename, const char * mode );
- if not success, a null pointer is returned.
- */
-RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+RC PagedFileManager::renameFile(const string &fileName, const string &newName)
 {
-    if (!_utils->fileExists(fileName)) {
+    // handles find their header and their frames in the pool by the file name
+    if (!fileExists(fileName) || _openFiles.count(fileName) > 0 || _openFiles.count(newName) > 0) {
         return -1;
     }
-    if (fileHandle.pFile != nullptr) {
-        return -1;
+    auto memoryFile = _memoryFiles.find(fileName);
+    if (memoryFile != _memoryFiles.end()) {
+        if (_utils->fileExists(newName) && remove(newName.c_str()) != 0) {
+            return -1;
+        }
+        _memoryFiles[newName] = memoryFile->second;
+        _memoryFiles.erase(fileName);
     }
-    // read binary and update
-    fileHandle.pFile = fopen(fileName.c_str(), "rb+");
-    fileHandle.fileName = fileName;
+    else {
+        // rename() swaps the directory entry at once, whoever opens newName sees the old or the new file whole
+        if (rename(fileName.c_str(), newName.c_str()) != 0) {
+            return -1;
+        }
+        _memoryFiles.erase(newName);
+    }
+    // frames of either name hold pages of files that are gone
+    _bpm->discardFile(fileName);
+    _bpm->discardFile(newName);
+    return 0;
+}
+
+
+bool PagedFileManager::fileExists(const string &fileName)
+{
+    return _memoryFiles.count(fileName) > 0 || _utils->fileExists(fileName);
+}
+
 
-    if (fileHandle.pFile == nullptr) {
+RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle, const FileAccessMode accessMode)
+{
+    if (!fileExists(fileName)) {
+        return -1;
+    }
+    if (fileHandle.store != nullptr) {
+        return -1;
+    }
+    unsigned fileId = _bpm->fileIdOf(fileName);
+    
+    // every handle of an in-memory file shares its pages, a file on disk gets a descriptor per handle
+    shared_ptr<PageStore> store;
+    auto memoryFile = _memoryFiles.find(fileName);
+    if (memoryFile != _memoryFiles.end()) {
+        store = memoryFile->second;
+    }
+    else if (accessMode == MmapReadOnly) {
+        // the mapping sees the file, not the pool, so pages still dirty in the pool go out first
+        _bpm->writeBackFile(fileId);
+        store = shared_ptr<PageStore>(MmapPageStore::open(fileName));
+    }
+    else {
+        store = shared_ptr<PageStore>(PosixPageStore::open(fileName, false));
+    }
+    if (store == nullptr) {
         return -1;
     }
     
-    // read persistent counters from disk
-    _utils->readFileStatsFrom(fileName,
-                              fileHandle.readPageCounter,
-                              fileHandle.writePageCounter,
-                              fileHandle.appendPageCounter);
+    // the header is read from the store once, later handles of the same file share it
+    auto it = _openFiles.find(fileName);
+    if (it == _openFiles.end()) {
+        shared_ptr<OpenFileState> state = make_shared<OpenFileState>();
+        if (readHeaderFrom(*store, state->header) != 0) {
+            return -1;
+        }
+        if (store->setPageSize(state->header.pageSize) != 0) {
+            return -1;
+        }
+        state->openCount = 0;
+        // space reserved by earlier extents is whatever lies beyond the last page in use
+        state->reservedPages = store->getSize();
+        it = _openFiles.insert(make_pair(fileName, state)).first;
+    }
+    // every page after the header has the size the file was created with
+    if (store->setPageSize(it->second->header.pageSize) != 0) {
+        if (it->second->openCount == 0) {
+            _openFiles.erase(it);
+        }
+        return -1;
+    }
+    fileHandle.store = store;
+    fileHandle.fileName = fileName;
+    fileHandle.fileId = fileId;
+    fileHandle.accessMode = accessMode;
+    fileHandle.state = it->second;
+    fileHandle.state->openCount++;
     return 0;
 }
 
 
 RC PagedFileManager::closeFile(FileHandle &fileHandle)
 {
-    if (fileHandle.pFile == NULL) {
+    if (fileHandle.store == nullptr) {
         // file wasn't opened.
         return -1;
     }
-    _utils->writeFileStatsTo(fileHandle.fileName,
-                             fileHandle.readPageCounter,
-                             fileHandle.writePageCounter,
-                             fileHandle.appendPageCounter);
+    // dirty frames written through this handle must reach the file before it goes away
+    _bpm->flushFile(fileHandle);
+    writeHeader(fileHandle);
+    
+    fileHandle.state->openCount--;
+    auto it = _openFiles.find(fileHandle.fileName);
+    if (fileHandle.state->openCount == 0 && it != _openFiles.end() && it->second == fileHandle.state) {
+        _openFiles.erase(it);
+    }
+    fileHandle.state = nullptr;
+    // the descriptor or mapping goes away with the last handle using it
+    fileHandle.store = nullptr;
+    return 0;
+}
+
 
-    fclose(fileHandle.pFile);
+RC PagedFileManager::writeHeader(FileHandle &fileHandle)
+{
+    if (fileHandle.store == nullptr || fileHandle.state == nullptr) {
+        return -1;
+    }
+    if (fileHandle.accessMode == MmapReadOnly) {
+        // a read-only handle has nothing to persist
+        return 0;
+    }
+    // every handle counts into the shared header, whichever writes it carries everybody's counts
+    return writeHeaderTo(*fileHandle.store, fileHandle.state->header);
+}
+
+
+RC PagedFileManager::setBufferPoolSize(const unsigned &frameCount)
+{
+    return _bpm->setFrameCount(frameCount);
+}
+
+
+RC PagedFileManager::setDefaultStorage(const StorageBackend backend)
+{
+    _defaultStorage = backend;
+    return 0;
+}
+
+
+RC PagedFileManager::setDefaultPageSize(const unsigned &pageSize)
+{
+    if (!validPageSize(pageSize)) {
+        return -1;
+    }
+    _defaultPageSize = pageSize;
     return 0;
 }
 
 
+unsigned PagedFileManager::getDefaultPageSize()
+{
+    return _defaultPageSize;
+}
+
+
+RC PagedFileManager::setExtentSize(const unsigned &pages)
+{
+    if (pages == 0) {
+        return -1;
+    }
+    _extentPages = pages;
+    return 0;
+}
+
+
+unsigned PagedFileManager::getExtentSize()
+{
+    return _extentPages;
+}
+
+
 
 
 // constructor
 FileHandle::FileHandle()
 {
-    readPageCounter = 0;
-    writePageCounter = 0;
-    appendPageCounter = 0;
     fileName = "";
-    pFile = NULL;
+    store = nullptr;
+    fileId = 0;
+    state = nullptr;
+    accessMode = ReadWrite;
 }
 
 // deconstructor
@@ -129,32 +326,25 @@ FileHandle::~FileHandle()
 }
 
 
-/*
- fseek(FILE * fp, long offset, int position) where position can be commons such as: SEEK_SET/SEEK_CUR/SEEK_END
- fread(void * [ptr to a chunk of memory],
- size_t [size in bytes of each element to be read],
- int [number of elements to be read],
- FILE * fp)
- */
 RC FileHandle::readPage(PageNum pageNum, void *data)
 {
     // check eligibility
     if (pageNum >= getNumberOfPages()) {
         return -1;
     }
-    // place pFile at the beginning of the corresponding page
-    if (fseek(pFile, PAGE_SIZE * pageNum, SEEK_SET) != 0) {
-        return -1;
+    if (store->direct()) {
+        const void * page = mappedPage(pageNum);
+        if (page == nullptr) {
+            return -1;
+        }
+        memcpy(data, page, getPageSize());
+        return 0;
     }
-    
-    // read 4096 bytes into *data
-    // fread() returns the number of bytes read.
-    if (fread(data, sizeof(char), PAGE_SIZE, pFile) == 0) {
+    // served from the buffer pool, which only goes to disk on a miss
+    if (BufferPoolManager::instance()->readPage(*this, physicalPageNum(pageNum), data) != 0) {
         return -1;
     }
-    
-    fflush(pFile);
-    readPageCounter++;
+    countRead();
     return 0;
 }
 
@@ -162,64 +352,503 @@ RC FileHandle::readPage(PageNum pageNum, void *data)
 RC FileHandle::writePage(PageNum pageNum, const void *data)
 {
     // check eligibility
-    if (pageNum >= getNumberOfPages()) {
+    if (pageNum >= getNumberOfPages() || accessMode == MmapReadOnly) {
         return -1;
     }
-    // find end
-    if (fseek(pFile, PAGE_SIZE * pageNum, SEEK_SET) != 0) {
-        return -1;
+    if (store->direct()) {
+        char * page = _directPage(physicalPageNum(pageNum));
+        if (page == nullptr) {
+            return -1;
+        }
+        memcpy(page, data, getPageSize());
+        countWrite();
+        return 0;
     }
-    // fwrite() returns the number of bytes written.
-    if (fwrite((char*)data, sizeof(char), PAGE_SIZE, pFile) == 0) {
+    // the frame is marked dirty, it gets written back on eviction or closeFile()
+    if (BufferPoolManager::instance()->writePage(*this, physicalPageNum(pageNum), data) != 0) {
         return -1;
     }
-    fflush(pFile);
-    writePageCounter++;
+    countWrite();
     return 0;
 }
 
 
 RC FileHandle::appendPage(const void *data)
 {
-    if (fseek(pFile, 0, SEEK_END) != 0) {
+    if (state == nullptr || accessMode == MmapReadOnly) {
+        return -1;
+    }
+    PageNum pageNum = getNumberOfPages();
+    PageNum physical = physicalPageNum(pageNum);
+    
+    // most appends land in space an earlier extent reserved, the file size stays put
+    if (physical + 1 > state->reservedPages && _reserve(physical + 1) != 0) {
         return -1;
     }
     
-    // fwrite() returns the number of bytes written successfully.
-    if (fwrite((char*)data, sizeof(char), PAGE_SIZE, pFile) == 0) {
+    if (_beginGroup(pageNum) != 0 || store->writePage(physical, data) != 0) {
+        return -1;
+    }
+    state->header.pageCount++;
+    // a freshly appended page is usually read back right away (new record page, split sibling)
+    if (!store->direct()) {
+        BufferPoolManager::instance()->installPage(*this, physical, data);
+    }
+    countAppend();
+    return 0;
+}
+
+RC FileHandle::appendPages(const void *data, const unsigned &count)
+{
+    if (state == nullptr || accessMode == MmapReadOnly) {
+        return -1;
+    }
+    unsigned appended = 0;
+    while (appended < count) {
+        PageNum pageNum = getNumberOfPages();
+        PageNum physical = physicalPageNum(pageNum);
+        // a run ends with its group, the next group starts behind its own map page
+        unsigned run = FSM_GROUP_PAGES - pageNum % FSM_GROUP_PAGES;
+        if (run > count - appended) {
+            run = count - appended;
+        }
+        if (physical + run > state->reservedPages && _reserve(physical + run) != 0) {
+            return -1;
+        }
+        if (_beginGroup(pageNum) != 0
+            || store->writePages(physical, run, (const char*)data + (size_t) getPageSize() * appended) != 0) {
+            return -1;
+        }
+        state->header.pageCount += run;
+        countAppend(run);
+        appended += run;
+    }
+    return 0;
+}
+
+// the first page of a group brings the map page in front of it, every bucket starts out empty
+RC FileHandle::_beginGroup(const PageNum &pageNum)
+{
+    if (pageNum % FSM_GROUP_PAGES != 0) {
+        return 0;
+    }
+    PageNum fsmPage = _fsmPageNum(pageNum / FSM_GROUP_PAGES);
+    void * buckets = malloc(getPageSize());
+    memset(buckets, 0, getPageSize());
+    RC rc = store->writePage(fsmPage, buckets);
+    free(buckets);
+    if (rc != 0) {
         return -1;
     }
-    fflush(pFile);
-    appendPageCounter++;
+    if (state->header.freeSpaceRoot == NULL_PAGE) {
+        state->header.freeSpaceRoot = fsmPage;
+    }
     return 0;
 }
 
 /*
- 
- ftell(FILE * fp) returns the position of file pointer in the file with respect to starting of the file
+ The store grows a whole extent at once (fallocate() for a file on disk),
+ so a run of appends doesn't update the file's metadata and allocation page by page.
+ Small files grow by doubling, so a table of a few pages doesn't take a whole extent.
  */
-unsigned FileHandle::getNumberOfPages()
+RC FileHandle::_reserve(const PageNum &physicalEnd)
 {
-    fseek(pFile, 0, SEEK_END);
-    long pos = ftell(pFile);
-    
-    if (pos < 0)
-    {
-        cout << "getNumberOfPages() failed." << endl;
+    unsigned extent = PagedFileManager::instance()->getExtentSize();
+    unsigned step = state->reservedPages < extent ? state->reservedPages : extent;
+    if (step == 0) {
+        step = 1;
+    }
+    unsigned reserved = state->reservedPages + step;
+    if (reserved < physicalEnd) {
+        reserved = physicalEnd;
+    }
+    if (store->extend(reserved) != 0) {
+        return -1;
+    }
+    state->reservedPages = reserved;
+    return 0;
+}
+
+/*
+ No fflush()/fsync() happens per page any more,
+ sync() is the one place where durability is paid for.
+ */
+RC FileHandle::sync()
+{
+    if (store == nullptr) {
+        return -1;
+    }
+    if (accessMode == MmapReadOnly) {
+        return 0;
+    }
+    if (BufferPoolManager::instance()->flushFile(*this) != 0) {
+        return -1;
+    }
+    if (PagedFileManager::instance()->writeHeader(*this) != 0) {
+        return -1;
+    }
+    return store->sync();
+}
+
+/*
+ The batch only carries physical page numbers and file descriptors,
+ so submitting and waiting is left to the caller: AsyncIOManager::submit()/wait().
+ Pages of a direct store are copied right away, there is no I/O to wait for.
+ */
+RC FileHandle::queueRead(PageBatch &batch, const PageNum &pageNum, void *data)
+{
+    if (pageNum >= getNumberOfPages()) {
+        return -1;
+    }
+    RC rc;
+    if (store->direct()) {
+        const void * page = mappedPage(pageNum);
+        if (page == nullptr) {
+            return -1;
+        }
+        memcpy(data, page, getPageSize());
+        // mappedPage() counted the read
+        return batch.addCompleted(physicalPageNum(pageNum), data);
+    }
+    if (BufferPoolManager::instance()->readCachedPage(*this, physicalPageNum(pageNum), data) == 0) {
+        rc = batch.addCompleted(physicalPageNum(pageNum), data);
+    }
+    else {
+        rc = batch.addRead(store->getFd(), physicalPageNum(pageNum), data, getPageSize());
+    }
+    if (rc == 0) {
+        countRead();
+    }
+    return rc;
+}
+
+
+RC FileHandle::queueWrite(PageBatch &batch, const PageNum &pageNum, const void *data)
+{
+    if (pageNum >= getNumberOfPages() || accessMode == MmapReadOnly) {
+        return -1;
+    }
+    if (store->direct()) {
+        char * page = _directPage(physicalPageNum(pageNum));
+        if (page == nullptr || batch.addCompleted(physicalPageNum(pageNum), page) != 0) {
+            return -1;
+        }
+        memcpy(page, data, getPageSize());
+        countWrite();
+        return 0;
+    }
+    // a dirty frame written back later carries the same bytes as this write
+    BufferPoolManager::instance()->installPage(*this, physicalPageNum(pageNum), data);
+    if (batch.addWrite(store->getFd(), physicalPageNum(pageNum), data, getPageSize()) != 0) {
+        return -1;
+    }
+    countWrite();
+    return 0;
+}
+
+
+/*
+ Pages are physically contiguous inside one free-space group, so a run is read group by group
+ with one read each. Advising the store of the run that follows (posix_fadvise(WILLNEED) on disk)
+ starts the kernel reading it in the background while the caller works through the pages just brought in.
+ */
+RC FileHandle::readAhead(const PageNum &pageNum, const unsigned &count)
+{
+    unsigned totalPages = getNumberOfPages();
+    if (state == nullptr || pageNum >= totalPages || count == 0) {
         return -1;
     }
+    PageNum last = pageNum + count > totalPages ? totalPages : pageNum + count;
     
-    // if no page has ever been initialized, return 0;
-    // if 1 page has been initialized, pos should equal to PAGE_SIZE, and it returns 1.
-    return (unsigned) (pos / PAGE_SIZE);
+    if (store->direct()) {
+        // nothing to copy, just have a mapping fault the run in
+        return store->advise(physicalPageNum(pageNum),
+                             physicalPageNum(last - 1) + 1 - physicalPageNum(pageNum),
+                             false);
+    }
     
+    PageNum first = pageNum;
+    while (first < last) {
+        PageNum groupEnd = (first / FSM_GROUP_PAGES + 1) * FSM_GROUP_PAGES;
+        PageNum runEnd = groupEnd < last ? groupEnd : last;
+        if (BufferPoolManager::instance()->prefetch(*this, physicalPageNum(first), runEnd - first) != 0) {
+            return -1;
+        }
+        first = runEnd;
+    }
+    if (last < totalPages) {
+        PageNum nextLast = last + count > totalPages ? totalPages : last + count;
+        store->advise(physicalPageNum(last),
+                      physicalPageNum(nextLast - 1) + 1 - physicalPageNum(last),
+                      false);
+    }
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ direct stores: a read-only mapping or an in-memory file
+ --------------------------------------------------------------------------------------- */
+
+// a mapping only covers the file as long as it was when it was made
+char * FileHandle::_directPage(const PageNum &physical)
+{
+    char * page = store->pagePointer(physical);
+    if (page != nullptr || fixedMapping) {
+        return page;
+    }
+    // another handle appended since, its pages may still be in the pool
+    BufferPoolManager::instance()->writeBackFile(fileId);
+    if (store->refresh() != 0) {
+        return nullptr;
+    }
+    return store->pagePointer(physical);
+}
+
+
+const void * FileHandle::mappedPage(PageNum pageNum)
+{
+    if (store == nullptr || !store->direct() || pageNum >= getNumberOfPages()) {
+        return nullptr;
+    }
+    const void * page = _directPage(physicalPageNum(pageNum));
+    if (page == nullptr) {
+        return nullptr;
+    }
+    countRead();
+    return page;
+}
+
+
+RC FileHandle::beginSequentialRead()
+{
+    if (store == nullptr) {
+        return -1;
+    }
+    if (store->direct()) {
+        // writers keep their pages in the buffer pool, a mapping only sees what was written back
+        BufferPoolManager::instance()->writeBackFile(fileId);
+        if (store->refresh() != 0) {
+            return -1;
+        }
+    }
+    return store->advise(0, store->getSize(), true);
+}
+
+
+unsigned FileHandle::getPageSize()
+{
+    if (state == nullptr) {
+        return PAGE_SIZE;
+    }
+    return state->header.pageSize;
+}
+
+
+// served from the header cached at openFile(), the file is never stat'ed
+unsigned FileHandle::getNumberOfPages()
+{
+    if (state == nullptr) {
+        return 0;
+    }
+    return state->header.pageCount;
+}
+
+
+PageNum FileHandle::physicalPageNum(const PageNum &pageNum)
+{
+    unsigned group = pageNum / FSM_GROUP_PAGES;
+    return _fsmPageNum(group) + 1 + pageNum % FSM_GROUP_PAGES;
+}
+
+
+PageNum FileHandle::_fsmPageNum(const unsigned &group)
+{
+    return HEADER_PAGES + group * (FSM_GROUP_PAGES + 1);
+}
+
+
+PageNum FileHandle::getIndexRoot()
+{
+    if (state == nullptr) {
+        return NULL_PAGE;
+    }
+    return state->header.indexRoot;
+}
+
+
+RC FileHandle::setIndexRoot(const PageNum &pageNum)
+{
+    if (state == nullptr) {
+        return -1;
+    }
+    state->header.indexRoot = pageNum;
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ free-space map
+ --------------------------------------------------------------------------------------- */
+
+// buckets scale with the page, a bucket is 1/256 of it (16 bytes of a 4KB page)
+unsigned char bucketOf(const unsigned & freeBytes, const unsigned & pageSize)
+{
+    unsigned bucket = (unsigned) ((unsigned long long) freeBytes * (FSM_MAX_BUCKET + 1) / pageSize);
+    return (unsigned char) (bucket > FSM_MAX_BUCKET ? FSM_MAX_BUCKET : bucket);
+}
+
+// map pages go through the buffer pool like data pages, by their physical page number
+RC FileHandle::_pinFsmPage(const unsigned &group, void* &buckets, bool &pinned)
+{
+    if (store->direct()) {
+        // updated in place, nothing to release afterwards
+        buckets = _directPage(_fsmPageNum(group));
+        pinned = true;
+        return buckets == nullptr ? -1 : 0;
+    }
+    pinned = BufferPoolManager::instance()->pinPage(*this, _fsmPageNum(group), buckets) == 0;
+    if (pinned) {
+        return 0;
+    }
+    buckets = malloc(getPageSize());
+    if (store->readPage(_fsmPageNum(group), buckets) != 0) {
+        free(buckets);
+        return -1;
+    }
+    return 0;
+}
+
+RC FileHandle::_unpinFsmPage(const unsigned &group, void * buckets, const bool &pinned, const bool &dirty)
+{
+    if (pinned) {
+        if (store->direct()) {
+            return 0;
+        }
+        return BufferPoolManager::instance()->unpinPage(*this, _fsmPageNum(group), dirty);
+    }
+    RC rc = 0;
+    if (dirty && store->writePage(_fsmPageNum(group), buckets) != 0) {
+        rc = -1;
+    }
+    free(buckets);
+    return rc;
+}
+
+
+RC FileHandle::setFreeSpace(const PageNum &pageNum, const unsigned &freeBytes)
+{
+    if (state == nullptr || pageNum >= getNumberOfPages()) {
+        return -1;
+    }
+    unsigned group = pageNum / FSM_GROUP_PAGES;
+    if (group >= FSM_MAX_GROUPS) {
+        // beyond what the header can summarize, the page is just never offered for inserts
+        return 0;
+    }
+    void * buckets;
+    bool pinned;
+    if (_pinFsmPage(group, buckets, pinned) != 0) {
+        return -1;
+    }
+    unsigned char * bucket = (unsigned char*)buckets;
+    unsigned slot = pageNum % FSM_GROUP_PAGES;
+    unsigned char oldBucket = bucket[slot];
+    unsigned char newBucket = bucketOf(freeBytes, getPageSize());
+    bucket[slot] = newBucket;
+    
+    // keep the group summary exact, a shrinking maximum needs one pass over the map page
+    unsigned char & groupMax = state->header.groupMaxBucket[group];
+    if (newBucket >= groupMax) {
+        groupMax = newBucket;
+    }
+    else if (oldBucket == groupMax) {
+        groupMax = 0;
+        for (unsigned i = 0; i < FSM_GROUP_PAGES; i++) {
+            if (bucket[i] > groupMax) {
+                groupMax = bucket[i];
+            }
+        }
+    }
+    return _unpinFsmPage(group, buckets, pinned, oldBucket != newBucket);
+}
+
+
+RC FileHandle::findPageWithSpace(const unsigned &freeBytes, PageNum &pageNum)
+{
+    if (state == nullptr) {
+        return -1;
+    }
+    // round up, a page in bucket b is only known to have b / 256 of the page free
+    unsigned wanted = (unsigned) (((unsigned long long) freeBytes * (FSM_MAX_BUCKET + 1) + getPageSize() - 1) / getPageSize());
+    if (wanted > FSM_MAX_BUCKET) {
+        return -1;
+    }
+    unsigned totalPages = getNumberOfPages();
+    unsigned groups = (totalPages + FSM_GROUP_PAGES - 1) / FSM_GROUP_PAGES;
+    for (unsigned group = 0; group < groups && group < FSM_MAX_GROUPS; group++) {
+        // groups without such a page are skipped by the summary in the header
+        if (state->header.groupMaxBucket[group] < wanted) {
+            continue;
+        }
+        void * buckets;
+        bool pinned;
+        if (_pinFsmPage(group, buckets, pinned) != 0) {
+            return -1;
+        }
+        unsigned char * bucket = (unsigned char*)buckets;
+        PageNum first = group * FSM_GROUP_PAGES;
+        RC rc = -1;
+        for (unsigned i = 0; i < FSM_GROUP_PAGES && first + i < totalPages; i++) {
+            if (bucket[i] >= wanted) {
+                pageNum = first + i;
+                rc = 0;
+                break;
+            }
+        }
+        _unpinFsmPage(group, buckets, pinned, false);
+        if (rc == 0) {
+            return 0;
+        }
+    }
+    return -1;
 }
 
 
 RC FileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
 {
-    readPageCount = readPageCounter;
-    writePageCount = writePageCounter;
-    appendPageCount = appendPageCounter;
+    if (state == nullptr) {
+        return -1;
+    }
+    readPageCount = state->header.readPageCounter;
+    writePageCount = state->header.writePageCounter;
+    appendPageCount = state->header.appendPageCounter;
     return 0;
 }
+
+
+void FileHandle::countRead(const unsigned &pages)
+{
+    if (readTally != nullptr) {
+        *readTally += pages;
+    }
+    else if (state != nullptr) {
+        state->header.readPageCounter += pages;
+    }
+}
+
+
+void FileHandle::countWrite(const unsigned &pages)
+{
+    if (state != nullptr) {
+        state->header.writePageCounter += pages;
+    }
+}
+
+
+void FileHandle::countAppend(const unsigned &pages)
+{
+    if (state != nullptr) {
+        state->header.appendPageCounter += pages;
+    }
+}
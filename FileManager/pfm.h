@@ -2,21 +2,75 @@
 #define _pfm_h_
 
 
+#include <memory>
+
 #include "../Utils/utils.h"
+#include "bpm.h"
+#include "aio.h"
+#include "pagestore.h"
 
 using namespace std;
 
 class FileHandle;
 
+// Physical page 0 of every paged file.
+// Logical pages (the page numbers every caller sees) follow it in groups of FSM_GROUP_PAGES,
+// each group preceded by the free-space map page that covers it:
+//  [header] [fsm 0] [data 0 .. 4095] [fsm 1] [data 4096 .. 8191] ...
+// Every page, this one included, is pageSize bytes; the header itself fits in the first PAGE_SIZE.
+typedef struct
+{
+    unsigned magic;
+    unsigned version;
+    unsigned pageSize;          // bytes in every page of the file, chosen at createFile()
+    unsigned pageCount;         // number of logical pages, getNumberOfPages() never touches the disk
+    unsigned readPageCounter;
+    unsigned writePageCounter;
+    unsigned appendPageCounter;
+    PageNum freeSpaceRoot;      // first page of the free-space map, NULL_PAGE if there is none
+    PageNum indexRoot;          // B+tree root of an index file, NULL_PAGE if the tree is empty
+    unsigned char groupMaxBucket[FSM_MAX_GROUPS];   // largest free-space bucket inside each group
+} FileHeader;
+
+// How a handle accesses its file, chosen at openFile()
+typedef enum {
+    ReadWrite = 0,      // pages are copied in and out through the buffer pool
+    MmapReadOnly        // pages are read straight out of a read-only mapping of the file
+} FileAccessMode;
+
+// In-memory copy of the header, shared by every handle (and every copy of a handle) of one file.
+// The page count and the counters are only ever changed here.
+typedef struct
+{
+    FileHeader header;
+    unsigned openCount;         // openFile() calls not matched by a closeFile() yet
+    unsigned reservedPages;     // physical pages the file has room for, at least as many as are in use
+} OpenFileState;
+
 class PagedFileManager
 {
 public:
     static PagedFileManager* instance();                                  // Access to the _pf_manager instance
     
-    RC createFile    (const string &fileName);                            // Create a new file
+    RC createFile    (const string &fileName);                            // Create a new file on the default backend
+    RC createFile    (const string &fileName, const StorageBackend backend,
+                      const unsigned pageSize = 0);                       // 0 picks the default page size
     RC destroyFile   (const string &fileName);                            // Destroy a file
-    RC openFile      (const string &fileName, FileHandle &fileHandle);    // Open a file
+    RC renameFile    (const string &fileName, const string &newName);     // Replace newName by fileName in one step,
+                                                                          // neither may be open
+    RC openFile      (const string &fileName, FileHandle &fileHandle,
+                      const FileAccessMode accessMode = ReadWrite);       // Open a file
     RC closeFile     (FileHandle &fileHandle);                            // Close a file
+    bool fileExists  (const string &fileName);                            // On disk or in memory
+    
+    RC setDefaultStorage(const StorageBackend backend);                   // Backend of files created from now on
+    RC setDefaultPageSize(const unsigned &pageSize);                      // Page size of files created from now on,
+    unsigned getDefaultPageSize();                                        // a power of two in [PAGE_SIZE, MAX_PAGE_SIZE]
+    RC setBufferPoolSize(const unsigned &frameCount);                     // Number of frames shared by all open files
+    RC setExtentSize(const unsigned &pages);                              // Largest step a file grows by
+    unsigned getExtentSize();
+    
+    RC writeHeader   (FileHandle &fileHandle);                            // Persist the header (page count, counters, roots)
     
 protected:
     PagedFileManager();                                                   // Constructor
@@ -25,6 +79,12 @@ protected:
 private:
     static PagedFileManager *_pf_manager;
     UtilsManager * _utils;
+    BufferPoolManager * _bpm;
+    unsigned _extentPages = FILE_EXTENT_PAGES;
+    StorageBackend _defaultStorage = PosixStorage;
+    unsigned _defaultPageSize = PAGE_SIZE;
+    unordered_map<string, shared_ptr<OpenFileState> > _openFiles;        // fileName -> header of a file that is open
+    unordered_map<string, shared_ptr<PageStore> > _memoryFiles;          // fileName -> pages of a MemoryStorage file
     
 };
 
@@ -32,12 +92,17 @@ private:
 class FileHandle
 {
 public:
-    // variables to keep the counter for each operation
-    unsigned readPageCounter;
-    unsigned writePageCounter;
-    unsigned appendPageCounter;
+    // the read/write/append counters are kept per file in state->header,
+    // so every handle of a file counts into them and the header is never written back stale
     string fileName;
-    FILE * pFile = nullptr;
+    shared_ptr<PageStore> store;        // where the pages are, nullptr while closed
+    unsigned fileId = 0;    // identifies the file inside the buffer pool
+    shared_ptr<OpenFileState> state;    // header cached by openFile(), nullptr while closed
+    FileAccessMode accessMode = ReadWrite;
+    // set on the copy a thread reads through next to others (a worker of a parallel scan):
+    // its page reads are tallied here instead of in the shared header, and a mapping is never remade under the others
+    unsigned * readTally = nullptr;
+    bool fixedMapping = false;
     
     FileHandle();                                                         // Default constructor
     ~FileHandle();                                                        // Destructor
@@ -48,10 +113,50 @@ public:
     // Write a specific page
     RC appendPage(const void *data);
     // Append a specific page
+    RC appendPages(const void *data, const unsigned &count);
+    // Append count pages laid out back to back in data, each run between two map pages is one write.
+    // The pages don't go through the buffer pool.
+    RC sync();
+    // Write back dirty pages of this handle and force them to stable storage
+    const void * mappedPage(PageNum pageNum);
+    // MmapReadOnly and MemoryStorage only: pointer to the page inside the store, no copy is made.
+    // A mapping grows when the file did, which invalidates pointers returned before.
+    RC queueRead(PageBatch &batch, const PageNum &pageNum, void *data);
+    // Add a page read to a batch for the AsyncIOManager. A page held by the buffer pool is copied right away.
+    RC queueWrite(PageBatch &batch, const PageNum &pageNum, const void *data);
+    // Add a write of an existing page to a batch. The buffered copy is replaced first, so nobody reads it stale.
+    RC readAhead(const PageNum &pageNum, const unsigned &count);
+    // Bring pages [pageNum, pageNum + count) in ahead of use, then let the kernel start on the next run
+    RC beginSequentialRead();
+    // Make pages written through other handles visible to a mapping,
+    // and tell the store the pages are about to be read in order
     
     unsigned getNumberOfPages();
     // Get the number of pages in the file
+    unsigned getPageSize();
+    // Bytes in every page of the file, PAGE_SIZE while closed
+    PageNum physicalPageNum(const PageNum &pageNum);
+    // Where a logical page is located in the file
+    PageNum getIndexRoot();
+    RC setIndexRoot(const PageNum &pageNum);
+    // Root page kept in the header for index files
+    RC setFreeSpace(const PageNum &pageNum, const unsigned &freeBytes);
+    // Record in the free-space map how many bytes are left on a page
+    RC findPageWithSpace(const unsigned &freeBytes, PageNum &pageNum);
+    // First page that has at least freeBytes left, -1 if there is none. No data page is read.
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);  // Put the current counter values into variables
+    void countRead(const unsigned &pages = 1);
+    void countWrite(const unsigned &pages = 1);
+    void countAppend(const unsigned &pages = 1);
+    // Add to the counters of the file
+    
+private:
+    PageNum _fsmPageNum(const unsigned &group);
+    RC _pinFsmPage(const unsigned &group, void* &buckets, bool &pinned);
+    RC _unpinFsmPage(const unsigned &group, void * buckets, const bool &pinned, const bool &dirty);
+    RC _reserve(const PageNum &physicalEnd);
+    RC _beginGroup(const PageNum &pageNum);
+    char * _directPage(const PageNum &physical);
     
 };
 
@@ -2,6 +2,8 @@
 
 RecordBasedFileManager* RecordBasedFileManager::_rbf_manager = nullptr;
 
+RC summarizePage(const ZoneMap & zones, const void * buffer, vector<ZoneColumn> & columns);
+
 RecordBasedFileManager* RecordBasedFileManager::instance()
 {
     if(!_rbf_manager)
@@ -27,16 +29,106 @@ RC RecordBasedFileManager::createFile(const string &fileName) {
     return _pfm->createFile(fileName);
 }
 
+RC RecordBasedFileManager::createFile(const string &fileName, const StorageBackend backend, const unsigned pageSize) {
+    return _pfm->createFile(fileName, backend, pageSize);
+}
+
+bool RecordBasedFileManager::fileExists(const string &fileName) {
+    return _pfm->fileExists(fileName);
+}
+
 RC RecordBasedFileManager::destroyFile(const string &fileName) {
+    // the zone map goes with the file
+    auto it = _zoneMaps.find(fileName);
+    if (it != _zoneMaps.end()) {
+        it->second->close();
+        _zoneMaps.erase(it);
+    }
+    if (_pfm->fileExists(fileName + ZONE_MAP_SUFFIX)) {
+        _pfm->destroyFile(fileName + ZONE_MAP_SUFFIX);
+    }
     return _pfm->destroyFile(fileName);
 }
 
-RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle) {
-    return _pfm->openFile(fileName, fileHandle);
+RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle, const FileAccessMode accessMode) {
+    if (_pfm->openFile(fileName, fileHandle, accessMode) != 0) {
+        return -1;
+    }
+    // the zone map is opened with the first handle of the file and closed with the last one
+    if (_zoneMaps.count(fileName) == 0 && _pfm->fileExists(fileName + ZONE_MAP_SUFFIX)) {
+        shared_ptr<ZoneMap> zones = make_shared<ZoneMap>();
+        if (zones->open(fileName + ZONE_MAP_SUFFIX) == 0) {
+            _zoneMaps[fileName] = zones;
+        }
+    }
+    return 0;
 }
 
 RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
-    return _pfm->closeFile(fileHandle);
+    string fileName = fileHandle.fileName;
+    bool lastHandle = fileHandle.state != nullptr && fileHandle.state->openCount == 1;
+    if (_pfm->closeFile(fileHandle) != 0) {
+        return -1;
+    }
+    auto it = _zoneMaps.find(fileName);
+    if (lastHandle && it != _zoneMaps.end()) {
+        it->second->close();
+        _zoneMaps.erase(it);
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::createZoneMap(FileHandle &fileHandle,
+                                         const vector<Attribute> &recordDescriptor,
+                                         const vector<string> &attributeNames) {
+    if (fileHandle.store == nullptr || zoneMapOf(fileHandle)
+        || _pfm->fileExists(fileHandle.fileName + ZONE_MAP_SUFFIX)) {
+        return -1;
+    }
+    if (ZoneMap::create(fileHandle.fileName + ZONE_MAP_SUFFIX, recordDescriptor, attributeNames) != 0) {
+        return -1;
+    }
+    shared_ptr<ZoneMap> zones = make_shared<ZoneMap>();
+    if (zones->open(fileHandle.fileName + ZONE_MAP_SUFFIX) != 0) {
+        _pfm->destroyFile(fileHandle.fileName + ZONE_MAP_SUFFIX);
+        return -1;
+    }
+    _zoneMaps[fileHandle.fileName] = zones;
+    // one pass over the pages the file has now, later changes keep the entries up to date
+    unsigned totalPageNum = fileHandle.getNumberOfPages();
+    vector<ZoneColumn> columns;
+    for (PageNum pageNum = 0; pageNum < totalPageNum; pageNum++) {
+        PageGuard page(fileHandle, pageNum);
+        if (!page.valid()) {
+            return -1;
+        }
+        summarizePage(*zones, page.data(), columns);
+        if (zones->put(pageNum, columns) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::destroyZoneMap(FileHandle &fileHandle) {
+    auto it = _zoneMaps.find(fileHandle.fileName);
+    if (it == _zoneMaps.end()) {
+        return -1;
+    }
+    it->second->close();
+    _zoneMaps.erase(it);
+    return _pfm->destroyFile(fileHandle.fileName + ZONE_MAP_SUFFIX);
+}
+
+shared_ptr<ZoneMap> RecordBasedFileManager::zoneMapOf(const FileHandle &fileHandle) {
+    auto it = _zoneMaps.find(fileHandle.fileName);
+    return it == _zoneMaps.end() ? nullptr : it->second;
+}
+
+RC RecordBasedFileManager::reorganize(const string &fileName,
+                                      const vector<Attribute> &recordDescriptor,
+                                      RBFM_Reorganizer &reorganizer) {
+    return reorganizer.initialize(fileName, recordDescriptor);
 }
 
 /* ---------------------------------------------------------------------------------------
@@ -51,61 +143,127 @@ RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
 
 
 
-short getTotalSlotsNum(const void * data) {
-    short totSlots;
-    memcpy(&totSlots, (char*)data + SLOT_NUM_INFO_POS, sizeof(short));
+unsigned getPageSizeOf(const void * data) {
+    unsigned pageSize;
+    memcpy(&pageSize, (char*)data + RBFM_PAGE_SIZE_POS, sizeof(unsigned));
+    return pageSize;
+}
+
+RC putPageSize(void * data, const unsigned & pageSize) {
+    memcpy((char*)data + RBFM_PAGE_SIZE_POS, & pageSize, sizeof(unsigned));
+    return 0;
+}
+
+// slot 0 sits at the very end of the page, the directory grows to the left
+int getRightMostSlotOffset(const void * data) {
+    return (int) getPageSizeOf(data) - SLOT_SIZE;
+}
+
+int getSlotOffset(const void * data, const SlotNum & slotIdx) {
+    return getRightMostSlotOffset(data) - (int) slotIdx * SLOT_SIZE;
+}
+
+int getTotalSlotsNum(const void * data) {
+    int totSlots;
+    memcpy(&totSlots, (char*)data + SLOT_NUM_INFO_POS, sizeof(int));
     return totSlots;
 }
 
-short getFreeOffset(const void * data) {
-    short offset;
-    memcpy(&offset, (char*)data + FREE_SPACE_INFO_POS, sizeof(short));
+int getFreeOffset(const void * data) {
+    int offset;
+    memcpy(&offset, (char*)data + FREE_SPACE_INFO_POS, sizeof(int));
     return offset;
 }
 
-RC putFreeOffset(const void * data, const short & offset) {
-    memcpy((char*)data + FREE_SPACE_INFO_POS, & offset, sizeof(short));
+RC putFreeOffset(const void * data, const int & offset) {
+    memcpy((char*)data + FREE_SPACE_INFO_POS, & offset, sizeof(int));
     return 0;
 }
 
-RC putTotalSlotsNum(const void * data, const short & totSlots) {
-    memcpy((char*)data + SLOT_NUM_INFO_POS, & totSlots, sizeof(short));
+RC putTotalSlotsNum(const void * data, const int & totSlots) {
+    memcpy((char*)data + SLOT_NUM_INFO_POS, & totSlots, sizeof(int));
     return 0;
 }
 
-short getRecOffset(const void * data, const SlotNum & slotIdx) {
-    short offset;
-    memcpy(&offset, (char*)data + RIGHT_MOST_SLOT_OFFSET - slotIdx * sizeof(int), sizeof(short));
+// slots ever handed out on the page, live or free; the directory never shrinks so RIDs stay put
+int getSlotDirSize(const void * data) {
+    int dirSize;
+    memcpy(&dirSize, (char*)data + SLOT_DIR_SIZE_POS, sizeof(int));
+    return dirSize;
+}
+
+RC putSlotDirSize(void * data, const int & dirSize) {
+    memcpy((char*)data + SLOT_DIR_SIZE_POS, & dirSize, sizeof(int));
+    return 0;
+}
+
+int getFreeSlotHead(const void * data) {
+    int head;
+    memcpy(&head, (char*)data + FREE_SLOT_HEAD_POS, sizeof(int));
+    return head;
+}
+
+RC putFreeSlotHead(void * data, const int & head) {
+    memcpy((char*)data + FREE_SLOT_HEAD_POS, & head, sizeof(int));
+    return 0;
+}
+
+// bytes of deleted or moved records that are still sitting between the live ones
+int getDeadBytes(const void * data) {
+    int deadBytes;
+    memcpy(&deadBytes, (char*)data + DEAD_SPACE_INFO_POS, sizeof(int));
+    return deadBytes;
+}
+
+RC putDeadBytes(void * data, const int & deadBytes) {
+    memcpy((char*)data + DEAD_SPACE_INFO_POS, & deadBytes, sizeof(int));
+    return 0;
+}
+
+int getRecOffset(const void * data, const SlotNum & slotIdx) {
+    int offset;
+    memcpy(&offset, (char*)data + getSlotOffset(data, slotIdx), sizeof(int));
     return offset;
 }
 
-short getRecLength(const void * data, const SlotNum & slotIdx) {
-    short recLen;
-    memcpy(&recLen, (char*)data + RIGHT_MOST_SLOT_OFFSET - slotIdx * sizeof(int) + sizeof(short), sizeof(short));
+int getRecLength(const void * data, const SlotNum & slotIdx) {
+    int recLen;
+    memcpy(&recLen, (char*)data + getSlotOffset(data, slotIdx) + sizeof(int), sizeof(int));
     return recLen;
 }
 
-SlotNum nextAvaiSlot(const void * buffer) {
-    short totSlots = getTotalSlotsNum(buffer);
-    SlotNum i = 0;
-    while (i < totSlots) {
-        short recOffset = getRecOffset(buffer, i);
-        short recLength = getRecLength(buffer, i);
-        if (recOffset == SLOT_OFFSET_CLEAN && recLength == SLOT_RECLEN_CLEAN) {
-            break;
-        }
-        i++;
-    }
-    return i;
+RC putRecOffset(void * data, const SlotNum & slotIdx, const int & offset) {
+    memcpy((char*)data + getSlotOffset(data, slotIdx), & offset, sizeof(int));
+    return 0;
 }
 
-RC putRecOffset(void * data, const SlotNum & slotIdx, const short & offset) {
-    memcpy((char*)data + RIGHT_MOST_SLOT_OFFSET - slotIdx * sizeof(int), & offset, sizeof(short));
+RC putRecLength(void * data, const SlotNum & slotIdx, const int & length) {
+    memcpy((char*)data + getSlotOffset(data, slotIdx) + sizeof(int), & length, sizeof(int));
     return 0;
 }
 
-RC putRecLength(void * data, const SlotNum & slotIdx, const short & length) {
-    memcpy((char*)data + RIGHT_MOST_SLOT_OFFSET - slotIdx * sizeof(int) + sizeof(short), & length, sizeof(short));
+// reuse the most recently freed slot, only grow the directory when none is free
+SlotNum allocateSlot(void * buffer) {
+    int head = getFreeSlotHead(buffer);
+    SlotNum slotIdx;
+    if (head != NO_FREE_SLOT) {
+        slotIdx = (SlotNum) head;
+        // the length of a free slot keeps the next one in the chain
+        putFreeSlotHead(buffer, getRecLength(buffer, slotIdx));
+    }
+    else {
+        slotIdx = (SlotNum) getSlotDirSize(buffer);
+        putSlotDirSize(buffer, slotIdx + 1);
+    }
+    putTotalSlotsNum(buffer, getTotalSlotsNum(buffer) + 1);
+    return slotIdx;
+}
+
+RC releaseSlot(void * buffer, const SlotNum & slotIdx) {
+    putRecOffset(buffer, slotIdx, SLOT_OFFSET_CLEAN);
+    putRecLength(buffer, slotIdx, getFreeSlotHead(buffer));
+    putFreeSlotHead(buffer, (int) slotIdx);
+    putTotalSlotsNum(buffer, getTotalSlotsNum(buffer) - 1);
     return 0;
 }
 
@@ -142,7 +300,7 @@ RID decompressed(const Beacon & beacon) {
 }
 
 bool fileHandleNotExists(FileHandle &fileHandle) {
-    return (fileHandle.pFile == nullptr);
+    return (fileHandle.store == nullptr);
 }
 
 bool recordDescriptorNotExists(const vector<Attribute> &recordDescriptor) {
@@ -155,77 +313,24 @@ bool pageNumInvalid(FileHandle & fileHandle, const PageNum & pageNum) {
     return (pageNum >= totalPageNum);
 }
 
-short getSlotsLeftBound(const void * buffer,
-                        const short & totSlots) {
-    if (totSlots == 0) {
-        // handle empty page
-        return RIGHT_MOST_SLOT_OFFSET; // 4092
-    }
-    SlotNum slotIdx = 0;
-    short counter = 0;
-    short recOffset;
-    short recLength;
-    while (counter < totSlots) {
-        recOffset = getRecOffset(buffer, slotIdx);
-        recLength = getRecLength(buffer, slotIdx);
-        if (recOffset == SLOT_OFFSET_CLEAN &&  recLength == SLOT_RECLEN_CLEAN) {
-            // nullified slot, doesn't count towards totSlots
-            slotIdx += 1; // move slotIdx left by 1
-        }
-        else if (recOffset == SLOT_OFFSET_CLEAN || recLength == SLOT_RECLEN_CLEAN) {
-            throw("UNEXPECTED");
-        }
-        else {
-            slotIdx += 1;
-            counter += 1;
-        }
-    }
-    /*
-     This function should handle 3 cases:
-         1. the leftmost slot is the last "alive" slot, where a valid RID is stored.
-         2. the leftmost slot(s) is one or more CLEANED_SLOT, where there used to be a RID but it got deleted and new RIDs haven't entered.
-         3. For above 2 cases, one more byte left to the leftmost slot could be EMPTY_BYTE or filled with record data.
-     Now, how to find the left cut off?
-         1. The above codes run counter out of totSlots
-         2. The below codes recognize CLEAN_SLOT and extend left bound accordingly. In any other cases, the left bound shouldn't be extended.
-    */
-    recOffset = getRecOffset(buffer, slotIdx);
-    recLength = getRecLength(buffer, slotIdx);
-    while (recOffset == SLOT_OFFSET_CLEAN &&  recLength == SLOT_RECLEN_CLEAN) {
-        slotIdx++; // advance to the next one
-        recOffset = getRecOffset(buffer, slotIdx);
-        recLength = getRecLength(buffer, slotIdx);
-    }
-    
-    return RIGHT_MOST_SLOT_OFFSET - (slotIdx - 1) * sizeof(int);
+// the left most byte of the slot directory, records end before it
+int getSlotsLeftBound(const void * buffer) {
+    return (int) getPageSizeOf(buffer) - getSlotDirSize(buffer) * SLOT_SIZE;
 }
 
 bool slotNumInvalid(const void * buffer, const SlotNum & slotNum) {
-    short leftMostOffset = getSlotsLeftBound(buffer, getTotalSlotsNum(buffer));
     // SlotNum unsigned typed, no need to check < 0
-    // slotNum index should never fall into the left side of leftMostOffset
-    return (RIGHT_MOST_SLOT_OFFSET - slotNum * sizeof(int) < leftMostOffset);
+    return (long long) slotNum >= (long long) getSlotDirSize(buffer);
 }
 
 bool recordDeleted(const void * buffer, const RID & rid) {
-    short recOffset = getRecOffset(buffer, rid.slotNum);
-    short recLength = getRecLength(buffer, rid.slotNum);
-    
-    if (recOffset == SLOT_OFFSET_CLEAN && recLength == SLOT_RECLEN_CLEAN) {
-        return true;
-    }
-    else if (recOffset == SLOT_OFFSET_CLEAN || recLength == SLOT_RECLEN_CLEAN) {
-        throw("Slots info got messed up.");
-    }
-    else {
-        return false;
-    }
+    return getRecOffset(buffer, rid.slotNum) == SLOT_OFFSET_CLEAN;
 }
 
 bool recordRelocated(const void * buffer, const RID & rid)
 {
-    short recLength = getRecLength(buffer, rid.slotNum);
-    if (recLength == (short)BEACON_SIZE) {
+    int recLength = getRecLength(buffer, rid.slotNum);
+    if (recLength == BEACON_SIZE) {
         return true;
     }
     else {
@@ -233,46 +338,40 @@ bool recordRelocated(const void * buffer, const RID & rid)
     }
 }
 
-void * getRecordStraight(const void * buffer, const RID & rid, short & recLen)
-{
-    recLen = getRecLength(buffer, rid.slotNum); // find out the length
-    short recOfs = getRecOffset(buffer, rid.slotNum);
-    void * record = malloc(recLen);
-    memcpy(record, (char*)buffer + recOfs, recLen);
-    return record;
+bool sameRid(const RID & left, const RID & right) {
+    return left.pageNum == right.pageNum && left.slotNum == right.slotNum;
 }
 
-void * getRecordRecursive(FileHandle & fileHandle,
-                 const RID & rid,
-                 RID & realRid,
-                 short & realRecLen) {
-    void * buffer = malloc(PAGE_SIZE);
-    fileHandle.readPage(rid.pageNum, buffer);
-    short recOfs = getRecOffset(buffer, rid.slotNum);
-    short recLen = getRecLength(buffer, rid.slotNum);
-    if (recordDeleted(buffer, rid)) {
-        // missing piece
-        void * record = nullptr;
-        return record;
-    }
-    if (recLen > (short)BEACON_SIZE) {
-        void * record = malloc(recLen);
-        memcpy(record, (char*)buffer + recOfs, (size_t) recLen);
-        realRid.pageNum = rid.pageNum;
-        realRid.slotNum = rid.slotNum;
-        realRecLen = recLen;
-        free(buffer);
-        return record;
-    }
-    else if (recLen == (short)BEACON_SIZE) {
+// Where the record of rid really lives, and the beacons passed on the way there (the home slot first).
+// Updates keep the home slot pointing straight at the record, so that is at most one hop;
+// chains left by older files are followed all the same.
+RC locateRecord(FileHandle & fileHandle,
+                const RID & rid,
+                RID & realRid,
+                vector<RID> & beacons) {
+    beacons.clear();
+    RID curtRid = rid;
+    while (true) {
+        if (pageNumInvalid(fileHandle, curtRid.pageNum)) {
+            return -1;
+        }
+        // pin the page instead of copying it out
+        PageGuard page(fileHandle, curtRid.pageNum);
+        if (!page.valid()) {
+            return -1;
+        }
+        const char * buffer = page.data();
+        if (slotNumInvalid(buffer, curtRid.slotNum) || recordDeleted(buffer, curtRid)) {
+            return -1;
+        }
+        if (!recordRelocated(buffer, curtRid)) {
+            realRid = curtRid;
+            return 0;
+        }
+        beacons.push_back(curtRid);
         Beacon beacon;
-        memcpy(& beacon, (char*)buffer + recOfs, (size_t)BEACON_SIZE);
-        RID newRid = decompressed(beacon);
-        free(buffer);
-        return getRecordRecursive(fileHandle, newRid, realRid, realRecLen);
-    }
-    else {
-        throw("There shouldn't be a record whose length < 5.");
+        memcpy(& beacon, buffer + getRecOffset(buffer, curtRid.slotNum), (size_t)BEACON_SIZE);
+        curtRid = decompressed(beacon);
     }
 }
 
@@ -292,44 +391,175 @@ void * getRecordRecursive(FileHandle & fileHandle,
 // the former doesn't count those slots filled with SLOT_OFFSET_CLEAN and SLOT_RECLEN_CLEAN but the latter does.
 short getTotalUsedSlotsNum(const void * buffer)
 {
-    short leftBound = getSlotsLeftBound(buffer, getTotalSlotsNum(buffer));
-    return (short) ((RIGHT_MOST_SLOT_OFFSET - leftBound) / sizeof(int) + 1);
+    return (short) getSlotDirSize(buffer);
 }
 // these two methods are defined for different purpose:
-// 1. the above one is defined as a helper function so it can be used by RBFM_ScanIterator::loadNxtRecOnSlot()
+// 1. the above one is defined as a helper function so it can be used by RBFM_ScanIterator::findNxtRecOnSlot()
 // 2. the below one is defined as a public function so it can be used in RM module
 // Common thing is they are built on top of two utility functions defined in this module.
 short RecordBasedFileManager::getTotalUsedSlotsNum(const void * buffer)
 {
-    short leftBound = getSlotsLeftBound(buffer, getTotalSlotsNum(buffer));
-    return (short) ((RIGHT_MOST_SLOT_OFFSET - leftBound) / 2 + 1);
+    return (short) getSlotDirSize(buffer);
 }
 
-// This func checks the absolute amount of freespace on the page pointed by fileHandle + pageNum
-// freeSpace -> itself is a pointer variable pointing to the address passed in, in our case, [11]
-short checkForSpace(FileHandle & fileHandle,
-                    const PageNum & pageNum) {
-    void* buffer = malloc(PAGE_SIZE);
-    fileHandle.readPage(pageNum, buffer);
-    short freeSpaceOffset = getFreeOffset(buffer);
-    short leftMostSlotOffset = getSlotsLeftBound(buffer, getTotalSlotsNum(buffer));
-    short freeSpaceAmount = leftMostSlotOffset - freeSpaceOffset;
-    free(buffer);
-    return freeSpaceAmount;
+// the room between the last record and the slot directory, usable without compacting
+int contiguousSpaceOf(const void * buffer) {
+    return getSlotsLeftBound(buffer) - getFreeOffset(buffer);
+}
+
+// This func checks the absolute amount of freespace on a page already in memory, dead bytes included
+int freeSpaceOf(const void * buffer) {
+    return contiguousSpaceOf(buffer) + getDeadBytes(buffer);
+}
+
+// one pass over the live records in page order, sliding each one down over the dead bytes before it
+RC compactPage(void * buffer) {
+    vector<pair<int, SlotNum> > live;
+    int dirSize = getSlotDirSize(buffer);
+    for (SlotNum slotIdx = 0; slotIdx < (SlotNum) dirSize; slotIdx++) {
+        int recOffset = getRecOffset(buffer, slotIdx);
+        if (recOffset != SLOT_OFFSET_CLEAN) {
+            live.push_back(make_pair(recOffset, slotIdx));
+        }
+    }
+    sort(live.begin(), live.end());
+    
+    int nextOffset = RBFM_PAGE_HEADER_SIZE;
+    for (unsigned i = 0; i < live.size(); i++) {
+        int recLength = getRecLength(buffer, live[i].second);
+        if (live[i].first != nextOffset) {
+            memmove((char*)buffer + nextOffset, (char*)buffer + live[i].first, (size_t) recLength);
+            putRecOffset(buffer, live[i].second, nextOffset);
+        }
+        nextOffset += recLength;
+    }
+    memset((char*)buffer + nextOffset, EMPTY_BYTE, (size_t) (getFreeOffset(buffer) - nextOffset));
+    putFreeOffset(buffer, nextOffset);
+    putDeadBytes(buffer, 0);
+    return 0;
+}
+
+// compact only when the contiguous room falls short
+RC makeRoomFor(void * buffer, const int & bytes) {
+    if (contiguousSpaceOf(buffer) < bytes && getDeadBytes(buffer) > 0) {
+        compactPage(buffer);
+    }
+    return contiguousSpaceOf(buffer) >= bytes ? 0 : -1;
+}
+
+
+int fieldLenToMetaLen(const unsigned long & fieldLen) {
+    return (int) sizeof(int) * fieldLen;
+}
+// Field i of a stored record, read straight off its offset array without decoding the record:
+// a field starts where the closest non-NULL field before it ends.
+// nullptr is returned for a NULL field.
+const char * attributeOf(const void * record,
+                         const unsigned long & fieldLen,
+                         const int & i,
+                         int & length)
+{
+    if (i < 0 || (unsigned long) i >= fieldLen) {
+        throw("Incorrect field index.");
+    }
+    const int * fieldEnds = (const int*)record;
+    if (fieldEnds[i] == ATTR_NULL_FLAG) {
+        length = 0;
+        return nullptr;
+    }
+    int begin = fieldLenToMetaLen(fieldLen);
+    for (int j = i - 1; j >= 0; j--) {
+        if (fieldEnds[j] != ATTR_NULL_FLAG) {
+            begin = fieldEnds[j];
+            break;
+        }
+    }
+    length = fieldEnds[i] - begin;
+    return (const char*)record + begin;
+}
+
+
+// what the zone map keeps for the records on a page in memory
+RC summarizePage(const ZoneMap & zones, const void * buffer, vector<ZoneColumn> & columns) {
+    columns.assign(zones.fieldIdxs.size(), ZoneColumn());
+    for (ZoneColumn & column : columns) {
+        memset(& column, 0, sizeof(ZoneColumn));
+    }
+    RID rid;
+    short totUsedSlotsNum = getTotalUsedSlotsNum(buffer);
+    for (rid.slotNum = 0; rid.slotNum < (SlotNum) totUsedSlotsNum; rid.slotNum++) {
+        // a relocated record is summarized on the page it lives on, where scans find it
+        if (recordDeleted(buffer, rid) || recordRelocated(buffer, rid)) {
+            continue;
+        }
+        const char * record = (const char*)buffer + getRecOffset(buffer, rid.slotNum);
+        for (unsigned c = 0; c < columns.size(); c++) {
+            ZoneColumn & column = columns[c];
+            int length;
+            const char * field = attributeOf(record, zones.fieldCount, zones.fieldIdxs[c], length);
+            if (field == nullptr) {
+                column.nulls++;
+                continue;
+            }
+            if (column.values == ZONE_UNBOUNDED) {
+                continue;
+            }
+            char key[ZONE_KEY_SIZE];
+            if (zones.types[c] == TypeVarChar) {
+                zoneKeyOf(zones.types[c], field + sizeof(int), (unsigned) (length - sizeof(int)), key);
+            }
+            else {
+                zoneKeyOf(zones.types[c], field, sizeof(int), key);
+            }
+            if (zones.types[c] == TypeReal) {
+                float real;
+                memcpy(& real, key, sizeof(float));
+                if (real != real) {
+                    // NaN has no place between min and max
+                    column.values = ZONE_UNBOUNDED;
+                    continue;
+                }
+            }
+            if (column.values == 0 || compareZoneKeys(zones.types[c], key, column.min) < 0) {
+                memcpy(column.min, key, ZONE_KEY_SIZE);
+            }
+            if (column.values == 0 || compareZoneKeys(zones.types[c], key, column.max) > 0) {
+                memcpy(column.max, key, ZONE_KEY_SIZE);
+            }
+            column.values++;
+        }
+    }
+    return 0;
 }
 
+// every data page that changes goes through here: the free-space map and the zone map, if the file has one,
+// learn what is on it now, and a reorganization running on the file copies it again
+RC pageChanged(FileHandle & fileHandle, const PageNum & pageNum, const void * buffer) {
+    fileHandle.setFreeSpace(pageNum, freeSpaceOf(buffer));
+    RBFM_Reorganizer * reorganizer = RBFM_Reorganizer::of(fileHandle.fileName);
+    if (reorganizer) {
+        reorganizer->pageWritten(pageNum);
+    }
+    shared_ptr<ZoneMap> zones = RecordBasedFileManager::instance()->zoneMapOf(fileHandle);
+    if (zones) {
+        vector<ZoneColumn> columns;
+        summarizePage(*zones, buffer, columns);
+        return zones->put(pageNum, columns);
+    }
+    return 0;
+}
 
 void * RecordBasedFileManager::decodeMetaFrom(const void* data,
                                               const vector<Attribute> & recordDescriptor,
-                                              short & recordLen)
+                                              int & recordLen)
 {    
     // void* record (pointer to be returned) = malloc(metadata + actualData);
     auto fieldLength = (short) recordDescriptor.size();
-    short metaLength = sizeof(short) * fieldLength;
+    int metaLength = sizeof(int) * fieldLength;
     void* meta = malloc((size_t) metaLength);
     // compute the number of bytes taken to repr NULL fields
     auto n_bytes = (short) ceil((float)fieldLength / BITES_PER_BYTE);
-    short dataLength = n_bytes; // points to where the first actual data byte located
+    int dataLength = n_bytes; // points to where the first actual data byte located
     
     short i = 0;
     while (i < n_bytes) {
@@ -346,29 +576,29 @@ void * RecordBasedFileManager::decodeMetaFrom(const void* data,
             }
             // if current metaByte has j(th) bit being 1 -> (i * 8 + j)th field is NULL;
             if ((metaByte & mask) == mask) {
-                // if the (i * 8 + j)th field is NULL, set [2 * (i * 8 + j), 2 * (i * 8 + j) + 2] in "meta" memory as 0.
-                memcpy((char*)meta + sizeof(short) * target_field_idx, & ATTR_NULL_FLAG, sizeof(short));
+                // if the (i * 8 + j)th field is NULL, set [4 * (i * 8 + j), 4 * (i * 8 + j) + 4] in "meta" memory as ATTR_NULL_FLAG.
+                memcpy((char*)meta + sizeof(int) * target_field_idx, & ATTR_NULL_FLAG, sizeof(int));
                 j++;
                 continue;
             }
             // if this field is not NULL
             switch (recordDescriptor[target_field_idx].type) {
                 case TypeInt:
-                    dataLength += (short) sizeof(int);
+                    dataLength += (int) sizeof(int);
                     break;
                 case TypeReal:
-                    dataLength += (short) sizeof(float);
+                    dataLength += (int) sizeof(float);
                     break;
                 case TypeVarChar:
                     dataLength += _utils->getStringFrom(data, dataLength).length();
-                    dataLength += (short) sizeof(int);
+                    dataLength += (int) sizeof(int);
                     break;
                 default:
                     break;
             }
-            // else "meta" memory records the position where this field of data ends in each 2bytes slot.
-            short newEndsBy = dataLength - n_bytes + metaLength;
-            memcpy((char*)meta + sizeof(short) * target_field_idx, &newEndsBy, sizeof(short));
+            // else "meta" memory records the position where this field of data ends in each 4bytes slot.
+            int newEndsBy = dataLength - n_bytes + metaLength;
+            memcpy((char*)meta + sizeof(int) * target_field_idx, &newEndsBy, sizeof(int));
             j++;
         }
         i++;
@@ -387,33 +617,23 @@ void * RecordBasedFileManager::decodeMetaFrom(const void* data,
 
 
 
+// the free-space map answers without reading any data page
 int findNextAvaiPage(FileHandle & fileHandle,
-                         const short & recordLen) {
-    PageNum totalPageNum = fileHandle.getNumberOfPages();
-    
-    // if no page was ever allocated
-    if ( totalPageNum == 0) {
+                         const int & recordLen) {
+    PageNum pageNum;
+    // freeSpace >= recordLen + oneSlotSpace
+    if (fileHandle.findPageWithSpace(recordLen + SLOT_SIZE, pageNum) != 0) {
         return PAGENUM_UNAVAILABLE;
     }
-    // page indexing starts by 0!!!!!
-    int i = 0;
-    while (i < totalPageNum) {
-        short spaceLeftEmpty = checkForSpace(fileHandle, i);
-        // when freeSpace gets out of the above func, the 2bytes of memory were filled by the page's freespace value
-        if (spaceLeftEmpty >= recordLen + sizeof(int)) { // freeSpace >= recordLen + oneSlotSpace
-            return i;
-        }
-        i++;
-    }
-    // if no page is available
-    return PAGENUM_UNAVAILABLE;
+    return pageNum;
 }
 
-// this helper function is shared by insertIntoNewPage() and insertIntoPage()
+// this helper function is shared by insertIntoNewPage(), insertIntoPage() and updateRecord(),
+// slotIdx has been allocated by the caller
 RC insertIntoPageHelper(void * buffer,
                         const void * record,
-                        const short & recOffset,
-                        const short & recordLen,
+                        const int & recOffset,
+                        const int & recordLen,
                         const SlotNum & slotIdx) {
     
     // fill in slot info
@@ -422,60 +642,91 @@ RC insertIntoPageHelper(void * buffer,
     
     // fill in record data
     memcpy((char*)buffer + recOffset, record, (size_t) recordLen);
-    // fill in slotNum
-    putTotalSlotsNum(buffer, getTotalSlotsNum(buffer) + 1);
     // fill in freeSpaceOffset
     putFreeOffset(buffer, getFreeOffset(buffer) + recordLen);
     
     return 0;
 }
 
-RC insertIntoNewPage(FileHandle & fileHandle,
-                     const void * record,
-                     RID &rid,
-                     const short & recordLen) {
-    
-    void * buffer = malloc(PAGE_SIZE);
+RC initializeRecordPage(void * buffer, const unsigned & pageSize) {
     // without the following memset(), the entire chunk of memory will remain uninitialized
     // ERROR: Syscall param write(buf) points to uninitialised byte(s)
-    memset(buffer, EMPTY_BYTE, PAGE_SIZE);
+    memset(buffer, EMPTY_BYTE, pageSize);
     
-    // init totalSlotsNum
-    putTotalSlotsNum(buffer, (short) 0);
+    // the page knows its own size, the slot directory is laid out from its end
+    putPageSize(buffer, pageSize);
+    // init totalSlotsNum, an empty slot directory and no free slots
+    putTotalSlotsNum(buffer, 0);
+    putSlotDirSize(buffer, 0);
+    putFreeSlotHead(buffer, NO_FREE_SLOT);
+    putDeadBytes(buffer, 0);
     // init freeSpaceOffset
-    putFreeOffset(buffer, (short) 0);
-    // init slotNum, indexing starts by 0
-    rid.slotNum = (SlotNum) 0;
+    putFreeOffset(buffer, RBFM_PAGE_HEADER_SIZE);
+    return 0;
+}
+
+// put the record after the last one on a page already in memory, the caller made sure it has the room
+SlotNum placeRecord(void * buffer,
+                    const void * record,
+                    const int & recordLen) {
+    // the free-space map counts dead bytes as free, close the holes if the record doesn't fit after the last one
+    makeRoomFor(buffer, recordLen + (getFreeSlotHead(buffer) == NO_FREE_SLOT ? SLOT_SIZE : 0));
+    SlotNum slotIdx = allocateSlot(buffer);
+    
+    // recordOffset -> freeSpaceOffset in the buffer, fill in slot info at slotIdx
+    insertIntoPageHelper(buffer, record, getFreeOffset(buffer), recordLen, slotIdx);
+    return slotIdx;
+}
+
+RC insertIntoNewPage(FileHandle & fileHandle,
+                     const void * record,
+                     RID &rid,
+                     const int & recordLen) {
+    
+    void * buffer = malloc(fileHandle.getPageSize());
+    initializeRecordPage(buffer, fileHandle.getPageSize());
+    // a record larger than an empty page has nowhere to go
+    if (freeSpaceOf(buffer) < recordLen + SLOT_SIZE) {
+        free(buffer);
+        return -1;
+    }
     
-    // insert the record into buffer at 0 offset and fill in slotNum 0 with correct recordOffset and recordLen
-    insertIntoPageHelper(buffer, record, (short) 0, recordLen, rid.slotNum);
+    // the record goes right after the page header into slot 0, indexing starts by 0
+    rid.slotNum = placeRecord(buffer, record, recordLen);
     
-    fileHandle.appendPage(buffer);
+    if (fileHandle.appendPage(buffer) != 0) {
+        free(buffer);
+        return -1;
+    }
     
     rid.pageNum = fileHandle.getNumberOfPages() - 1; // indexing starts by 0
+    RC rc = pageChanged(fileHandle, rid.pageNum, buffer);
     
     free(buffer);
-    return 0;
+    return rc;
 }
 
 RC insertIntoPage(FileHandle & fileHandle,
                   const PageNum & next_avai_page,
                   const void * record,
                   RID & rid,
-                  const short & recordLen) {
-    void * buffer = malloc(PAGE_SIZE);
-    fileHandle.readPage(next_avai_page, buffer);
+                  const int & recordLen) {
+    void * buffer = malloc(fileHandle.getPageSize());
+    if (fileHandle.readPage(next_avai_page, buffer) != 0) {
+        free(buffer);
+        return -1;
+    }
     
     rid.pageNum = next_avai_page;
-    rid.slotNum = nextAvaiSlot(buffer);
-    
-    // insert record into buffer at page rid.pageNum, recordOffset -> freeSpaceOffset in the buffer, fill in slot info at rid.slotNum
-    insertIntoPageHelper(buffer, record, getFreeOffset(buffer), recordLen, rid.slotNum);
+    rid.slotNum = placeRecord(buffer, record, recordLen);
     
-    fileHandle.writePage(next_avai_page, buffer);
+    RC rc = fileHandle.writePage(next_avai_page, buffer);
+    if (rc == 0) {
+        rc = pageChanged(fileHandle, next_avai_page, buffer);
+    }
     
     free(buffer);
-    return 0;
+    return rc;
 }
 
 RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
@@ -487,24 +738,179 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
         return -1;
     }
     // must first find recordLen and then find if a suitable page exists.
-    short recordLen;
+    int recordLen;
     // you cannot pass in a uninitialized pointer
     void* record = decodeMetaFrom(data, recordDescriptor, recordLen);
     
     int nxtAvaiPage = findNextAvaiPage(fileHandle, recordLen);
+    RC rc;
     if (nxtAvaiPage == PAGENUM_UNAVAILABLE) {
         // if no page was ever allocated, meaning this is the first ever record insertion,
         // OR if no page was found to have enough capacity to hold this record
         // execute the following
-        insertIntoNewPage(fileHandle, record, rid, recordLen);
+        rc = insertIntoNewPage(fileHandle, record, rid, recordLen);
     }
     else {
-        insertIntoPage(fileHandle, nxtAvaiPage, record, rid, recordLen);
+        rc = insertIntoPage(fileHandle, nxtAvaiPage, record, rid, recordLen);
     }
     
     free(record);
+    return rc;
+}
+
+// append the new pages insertRecords() built and let the free-space map know about them
+RC flushNewPages(FileHandle & fileHandle,
+                 const void * newPages,
+                 unsigned & newPageCount) {
+    if (newPageCount == 0) {
+        return 0;
+    }
+    PageNum firstPage = fileHandle.getNumberOfPages();
+    if (fileHandle.appendPages(newPages, newPageCount) != 0) {
+        return -1;
+    }
+    unsigned appended = newPageCount;
+    newPageCount = 0;
+    for (unsigned i = 0; i < appended; i++) {
+        const void * page = (const char*)newPages + (size_t) fileHandle.getPageSize() * i;
+        if (pageChanged(fileHandle, firstPage + i, page) != 0) {
+            return -1;
+        }
+    }
     return 0;
 }
+
+/*
+ Records are packed into pages in memory:
+ pages that already have room (found through the free-space map) are read once and written back once at the end,
+ together in one batch of the AsyncIOManager,
+ the rest go onto new pages that are built back to back and appended RBFM_BATCH_PAGES at a time.
+ The free-space map is lowered as records are placed so the next lookups see what is left;
+ a page that is never written because the batch failed gets its old entry back.
+ */
+RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle,
+                                         const vector<Attribute> &recordDescriptor,
+                                         const vector<const void *> &data,
+                                         vector<RID> &rids) {
+    // check fileHandler
+    if (fileHandleNotExists(fileHandle) || recordDescriptorNotExists(recordDescriptor)) {
+        return -1;
+    }
+    rids.clear();
+    rids.reserve(data.size());
+    
+    unsigned pageSize = fileHandle.getPageSize();
+    unordered_map<PageNum, void*> touched;
+    unordered_map<PageNum, int> freeBefore;      // what the map said of a touched page before the batch
+    void * newPages = malloc((size_t) pageSize * RBFM_BATCH_PAGES);
+    unsigned newPageCount = 0;
+    RC rc = 0;
+    // what an empty page has room for
+    initializeRecordPage(newPages, pageSize);
+    int emptyPageSpace = freeSpaceOf(newPages);
+    
+    for (unsigned i = 0; i < data.size() && rc == 0; i++) {
+        int recordLen;
+        void * record = decodeMetaFrom(data[i], recordDescriptor, recordLen);
+        // a record larger than an empty page has nowhere to go
+        if (recordLen + SLOT_SIZE > emptyPageSpace) {
+            free(record);
+            rc = -1;
+            break;
+        }
+        
+        RID rid;
+        void * buffer = nullptr;
+        PageNum pageNum;
+        if (newPageCount > 0
+            && freeSpaceOf((char*)newPages + (size_t) pageSize * (newPageCount - 1)) >= recordLen + SLOT_SIZE) {
+            // keep filling the page being built
+            buffer = (char*)newPages + (size_t) pageSize * (newPageCount - 1);
+            rid.pageNum = fileHandle.getNumberOfPages() + newPageCount - 1;
+        }
+        else if (fileHandle.findPageWithSpace(recordLen + SLOT_SIZE, pageNum) == 0) {
+            auto it = touched.find(pageNum);
+            if (it == touched.end()) {
+                buffer = malloc(pageSize);
+                if (fileHandle.readPage(pageNum, buffer) != 0) {
+                    free(buffer);
+                    free(record);
+                    rc = -1;
+                    break;
+                }
+                touched[pageNum] = buffer;
+                freeBefore[pageNum] = freeSpaceOf(buffer);
+            }
+            else {
+                buffer = it->second;
+            }
+            rid.pageNum = pageNum;
+        }
+        else {
+            if (newPageCount == RBFM_BATCH_PAGES && flushNewPages(fileHandle, newPages, newPageCount) != 0) {
+                free(record);
+                rc = -1;
+                break;
+            }
+            buffer = (char*)newPages + (size_t) pageSize * newPageCount;
+            initializeRecordPage(buffer, pageSize);
+            newPageCount++;
+            rid.pageNum = fileHandle.getNumberOfPages() + newPageCount - 1;
+        }
+        
+        rid.slotNum = placeRecord(buffer, record, recordLen);
+        if (rid.pageNum < fileHandle.getNumberOfPages()) {
+            // the next lookups have to see what is left on it
+            fileHandle.setFreeSpace(rid.pageNum, freeSpaceOf(buffer));
+        }
+        rids.push_back(rid);
+        free(record);
+    }
+    
+    // every page that took records is written exactly once, all of them in flight together
+    PageBatch batch;
+    vector<PageNum> queued;                     // the page of each request of the batch
+    for (auto it = touched.begin(); it != touched.end() && rc == 0; it++) {
+        if (fileHandle.queueWrite(batch, it->first, it->second) != 0) {
+            rc = -1;
+            break;
+        }
+        queued.push_back(it->first);
+    }
+    // what was queued is waited for even after a failure, the pages are freed below
+    if (!batch.requests.empty() && AsyncIOManager::instance()->wait(batch) != 0) {
+        rc = -1;
+    }
+    unordered_map<PageNum, bool> written;
+    for (unsigned i = 0; i < queued.size(); i++) {
+        written[queued[i]] = batch.requests[i].rc == 0;
+    }
+    for (auto it = touched.begin(); it != touched.end(); it++) {
+        if (written[it->first]) {
+            if (pageChanged(fileHandle, it->first, it->second) != 0) {
+                rc = -1;
+            }
+        }
+        else {
+            fileHandle.setFreeSpace(it->first, freeBefore[it->first]);
+        }
+        free(it->second);
+    }
+    if (rc == 0) {
+        rc = flushNewPages(fileHandle, newPages, newPageCount);
+    }
+    free(newPages);
+    return rc;
+}
+
+// a record is stored with an int field end per attribute in place of the null bytes, then takes a slot
+unsigned RecordBasedFileManager::maxRecordLength(FileHandle &fileHandle,
+                                                 const vector<Attribute> &recordDescriptor) {
+    long nullBytes = (long) ceil((float) recordDescriptor.size() / BITES_PER_BYTE);
+    long length = (long) fileHandle.getPageSize() - RBFM_PAGE_HEADER_SIZE - SLOT_SIZE
+                  - fieldLenToMetaLen(recordDescriptor.size()) + nullBytes;
+    return length > 0 ? (unsigned) length : 0;
+}
 // ---------------------------------------------------------------------------------------
 
 RC encodeMetaInto(void * data,
@@ -513,12 +919,12 @@ RC encodeMetaInto(void * data,
 {
     short fieldNum = recordDescriptor.size();
     // split record into meta and actualData two parts
-    short metaLen = sizeof(short) * fieldNum;
+    int metaLen = sizeof(int) * fieldNum;
     
     short i = 0;
     auto n_bytes = (short) ceil((float)fieldNum / BITES_PER_BYTE);
     void * encodedMeta = malloc((size_t) n_bytes);
-    short dataLength = metaLen;
+    int dataLength = metaLen;
     
     while (i < n_bytes) {
         char thisByte = 0x0;
@@ -531,8 +937,8 @@ RC encodeMetaInto(void * data,
                 break;
             }
             
-            short curtFieldEnds;
-            memcpy(& curtFieldEnds, (char*)record + target_field_idx * sizeof(short), sizeof(short));
+            int curtFieldEnds;
+            memcpy(& curtFieldEnds, (char*)record + target_field_idx * sizeof(int), sizeof(int));
             
             if (curtFieldEnds == ATTR_NULL_FLAG) {
                 // 0000 0000 | 1000 0000 -> 1000 0000
@@ -568,38 +974,29 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle,
     if (fileHandleNotExists(fileHandle) || recordDescriptorNotExists(recordDescriptor)) {
         return -1;
     }
-    // check page number
-    if (pageNumInvalid(fileHandle, rid.pageNum)) {
-        return -1;
-    }
-    // read page in
-    void * buffer = malloc(PAGE_SIZE);
-    fileHandle.readPage(rid.pageNum, buffer);
-    // check slot number
-    if (slotNumInvalid(buffer, rid.slotNum)) {
-        return -1;
-    }
-    // check if the record still there
-    if (recordDeleted(buffer, rid)) {
-        return -1;
-    }
-
-    // recursively looking for the actual record since multiple updates could potentially lead to multiple beacon-guided locators
-    RID realRid;
-    short realRecLen;
-    void * record = getRecordRecursive(fileHandle, rid, realRid, realRecLen);
-    
-    if (record == nullptr) {
-        // after going into the page and recursively looking for the record, it found the record was deleted.
-        return -1;
+    // a relocated record is one beacon away from its home slot, so this reads at most two pages
+    RID curtRid = rid;
+    while (true) {
+        if (pageNumInvalid(fileHandle, curtRid.pageNum)) {
+            return -1;
+        }
+        PageGuard page(fileHandle, curtRid.pageNum);
+        if (!page.valid()) {
+            return -1;
+        }
+        const char * buffer = page.data();
+        // check slot number and if the record is still there
+        if (slotNumInvalid(buffer, curtRid.slotNum) || recordDeleted(buffer, curtRid)) {
+            return -1;
+        }
+        if (!recordRelocated(buffer, curtRid)) {
+            encodeMetaInto(data, buffer + getRecOffset(buffer, curtRid.slotNum), recordDescriptor);
+            return 0;
+        }
+        Beacon beacon;
+        memcpy(& beacon, buffer + getRecOffset(buffer, curtRid.slotNum), (size_t)BEACON_SIZE);
+        curtRid = decompressed(beacon);
     }
-    
-    encodeMetaInto(data, record, recordDescriptor);
-    
-    free(buffer);
-    free(record);
-    
-    return 0;
 }
 
 RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor,
@@ -611,7 +1008,7 @@ RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor
     
     auto fieldNum = (short) recordDescriptor.size();
     auto n_bytes = (short) ceil((float)fieldNum / BITES_PER_BYTE);
-    short offset = n_bytes;
+    int offset = n_bytes;
     
     short i = 0;
     while (i < n_bytes) {
@@ -639,22 +1036,22 @@ RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor
                 case TypeInt: {
                     int intValue;
                     memcpy(&intValue, (char*)data + offset, sizeof(int));
-                    offset += (short) sizeof(int);
+                    offset += (int) sizeof(int);
                     output += to_string(intValue);
                     break;
                 }
                 case TypeReal: {
                     float floatValue;
                     memcpy(&floatValue, (char*)data + offset, sizeof(float));
-                    offset += (short) sizeof(float);
+                    offset += (int) sizeof(float);
                     output += to_string(floatValue);
                     break;
                 }
                 case TypeVarChar: {
                     string str = _utils->getStringFrom(data, offset);
                     output += str;
-                    offset += (short) sizeof(int);
-                    offset += (short) str.length();
+                    offset += (int) sizeof(int);
+                    offset += (int) str.length();
                     break;
                 }
                 default:
@@ -669,78 +1066,41 @@ RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor
     return 0;
 }
 
-bool allEmptyBytes(const void * buffer,
-                   const short & start,
-                   const short & length) {
-    void * emptyChunk = malloc((size_t) length);
-    memset(emptyChunk, EMPTY_BYTE, (size_t)length);
-    int diff = memcmp((char*)buffer + start, emptyChunk, (size_t)length);
-    // only when diff == 0, it will return !false
-    // else, it returns !true.
-    return !diff;
+// the record's bytes become dead, nothing is moved until the room is needed
+RC removeRecord(void * buffer, const SlotNum & slotNum) {
+    putDeadBytes(buffer, getDeadBytes(buffer) + getRecLength(buffer, slotNum));
+    putRecOffset(buffer, slotNum, SLOT_OFFSET_CLEAN);
+    return 0;
 }
 
-RC kickinRemainingRecords(void * buffer,
-                          const short & breakPoint,
-                          const short & breakLength,
-                          const short & slotLeftBound) {
-    // base case: [breakPoint ... slotsLeftBound] == EMPTY_BYTE
-    if (allEmptyBytes(buffer, breakPoint, slotLeftBound - breakPoint)) {
-        return 0;
+RC deleteRecordFromPage(void * buffer, const RID & rid) {
+    removeRecord(buffer, rid.slotNum);
+    // the slot goes onto the free-slot chain for the next insert
+    releaseSlot(buffer, rid.slotNum);
+    // a page that has become mostly holes is compacted right away, the rest wait for an insert
+    if (getDeadBytes(buffer) * RBFM_COMPACT_DEAD_RATIO >= (int) getPageSizeOf(buffer)) {
+        compactPage(buffer);
     }
-    short nxtRecOffset = breakPoint + breakLength;
-    short nxtRecLength = SLOT_RECLEN_CLEAN; // need to be figured out
-    SlotNum curtSlotIdx = 0;
-    while (RIGHT_MOST_SLOT_OFFSET - curtSlotIdx * sizeof(int) >= slotLeftBound) {
-        short curtRecOffset = getRecOffset(buffer, curtSlotIdx);
-        if (nxtRecOffset == curtRecOffset) {
-            nxtRecLength = getRecLength(buffer, curtSlotIdx);
-            break;
-        }
-        curtSlotIdx++;
-    }
-    // eligibility check : actually found nxtRecLength
-    if (nxtRecLength == SLOT_RECLEN_CLEAN) {
-        throw("Didn't find the slot storing nxtRecOffset.");
-    }
-    // ready to move nxtRec
-    memcpy((char*)buffer + breakPoint, (char*)buffer + nxtRecOffset, (size_t) nxtRecLength);
-    short newBreakPoint = breakPoint + nxtRecLength;
-    // don't forget to move pointers in the slot!
-    putRecOffset(buffer, curtSlotIdx, breakPoint);
-    putRecLength(buffer, curtSlotIdx, nxtRecLength);
-    // create the next break
-    memset((char*)buffer + newBreakPoint, EMPTY_BYTE, (size_t)breakLength);
-    // starting from newBreakPoint, the remaining length equals to the old breakLength
-    // after all, breakLength is not gonna change throughout the process
-    kickinRemainingRecords(buffer, newBreakPoint, breakLength, slotLeftBound);
     return 0;
 }
 
-RC deleteRecordAndRearrange(void * buffer, const RID & rid) {
-    // erase record in memory
-    short recLength = getRecLength(buffer, rid.slotNum);
-    short recOffset = getRecOffset(buffer, rid.slotNum);
-    memset((char*)buffer + recOffset, EMPTY_BYTE, (size_t)recLength);
-    
-    // reset slot info, freeOffset, totalslotNum, etc
-    putRecOffset(buffer, rid.slotNum, SLOT_OFFSET_CLEAN);
-    putRecLength(buffer, rid.slotNum, SLOT_RECLEN_CLEAN);
-    putTotalSlotsNum(buffer, getTotalSlotsNum(buffer) - 1);
-    putFreeOffset(buffer, getFreeOffset(buffer) - recLength);
-    
-    short totalSlots = getTotalSlotsNum(buffer);
-    if (totalSlots == 0) {
-        // the page has become empty
-        return 0;
+
+// drop a record or a beacon, reading and writing back the page it is on
+RC releaseRecordAt(FileHandle & fileHandle, const RID & rid) {
+    void * buffer = malloc(fileHandle.getPageSize());
+    if (fileHandle.readPage(rid.pageNum, buffer) != 0) {
+        free(buffer);
+        return -1;
     }
-    // else fill up the hole
-    short slotLeftBound = getSlotsLeftBound(buffer, totalSlots);
-    kickinRemainingRecords(buffer, recOffset, recLength, slotLeftBound);
-    return 0;
+    deleteRecordFromPage(buffer, rid);
+    RC rc = fileHandle.writePage(rid.pageNum, buffer);
+    if (rc == 0) {
+        rc = pageChanged(fileHandle, rid.pageNum, buffer);
+    }
+    free(buffer);
+    return rc;
 }
 
-
 RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
                                         const vector<Attribute> & recordDescriptor,
                                         const RID &rid) {
@@ -748,35 +1108,27 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
     if (fileHandleNotExists(fileHandle) || recordDescriptorNotExists(recordDescriptor)) {
         return -1;
     }
-    // check page number
-    if (pageNumInvalid(fileHandle, rid.pageNum)) {
+    // find actual RID
+    RID actRid;
+    vector<RID> beacons;
+    if (locateRecord(fileHandle, rid, actRid, beacons) != 0) {
         return -1;
     }
-    // read page in
-    void * buffer = malloc(PAGE_SIZE);
-    fileHandle.readPage(rid.pageNum, buffer);
-    // check slot number
-    if (slotNumInvalid(buffer, rid.slotNum)) {
+    // the record goes, and so do the beacons that led to it: their slots may be handed out again
+    if (releaseRecordAt(fileHandle, actRid) != 0) {
         return -1;
     }
-    // find actual RID
-    RID actRid;
-    short actRecLen;
-    getRecordRecursive(fileHandle, rid, actRid, actRecLen);
-    
-    fileHandle.readPage(actRid.pageNum, buffer); // reload buffer with actRid
-    
-    deleteRecordAndRearrange(buffer, actRid);
-    
-    fileHandle.writePage(actRid.pageNum, buffer);
-    
-    free(buffer);
+    for (unsigned i = 0; i < beacons.size(); i++) {
+        if (releaseRecordAt(fileHandle, beacons[i]) != 0) {
+            return -1;
+        }
+    }
     return 0;
 }
 
 RC putBeaconIntoBuffer(void * buffer,
                        const SlotNum & slotNum,
-                       const short & beaconOfs,
+                       const int & beaconOfs,
                        const Beacon & beacon) {
     // fill in slot info
     putRecOffset(buffer, slotNum, beaconOfs);
@@ -784,21 +1136,148 @@ RC putBeaconIntoBuffer(void * buffer,
     // fill in record data
     memcpy((char*)buffer + beaconOfs, beacon.cpsdPageNum, (size_t) 3);
     memcpy((char*)buffer + beaconOfs + 3, beacon.cpsdSlotNum, (size_t) 2);
-    // fill in slotNum
-    putTotalSlotsNum(buffer, getTotalSlotsNum(buffer) + 1);
     // fill in freeSpaceOffset
     putFreeOffset(buffer, beaconOfs + BEACON_SIZE);
     return 0;
 }
 
+// turn the home slot into a beacon to newRid, or just repoint the beacon it already holds
+RC pointHomeAt(FileHandle & fileHandle, const RID & rid, const RID & newRid) {
+    void * buffer = malloc(fileHandle.getPageSize());
+    if (fileHandle.readPage(rid.pageNum, buffer) != 0) {
+        free(buffer);
+        return -1;
+    }
+    Beacon beacon = compressed(newRid);
+    if (recordRelocated(buffer, rid)) {
+        memcpy((char*)buffer + getRecOffset(buffer, rid.slotNum), & beacon, (size_t) BEACON_SIZE);
+    }
+    else {
+        removeRecord(buffer, rid.slotNum);
+        makeRoomFor(buffer, BEACON_SIZE);
+        putBeaconIntoBuffer(buffer, rid.slotNum, getFreeOffset(buffer), beacon);
+    }
+    RC rc = fileHandle.writePage(rid.pageNum, buffer);
+    if (rc == 0) {
+        rc = pageChanged(fileHandle, rid.pageNum, buffer);
+    }
+    free(buffer);
+    return rc;
+}
+
+// a record that fits none of the pages it has been on goes wherever the free-space map says
+RC relocateRecord(FileHandle & fileHandle,
+                  const void * record,
+                  const int & recordLen,
+                  RID & newRid) {
+    int nxtAvaiPage = findNextAvaiPage(fileHandle, recordLen);
+    if (nxtAvaiPage == PAGENUM_UNAVAILABLE) {
+        // inside the function, an empty page has been initialized and filled in with records as well as all other info, and flushed to disk.
+        return insertIntoNewPage(fileHandle, record, newRid, recordLen);
+    }
+    return insertIntoPage(fileHandle, nxtAvaiPage, record, newRid, recordLen);
+}
+
+// put a page back as it was before an update touched it
+RC restorePage(FileHandle & fileHandle, const PageNum & pageNum, const void * page) {
+    if (fileHandle.writePage(pageNum, page) != 0) {
+        return -1;
+    }
+    return pageChanged(fileHandle, pageNum, page);
+}
+
+// the last resort of a move: the old copy at actRid is released so its page can take the record too
+// and the record is relocated once more; oldPage gets the page as it was, which is written back if that fails
+RC relocateAfterRelease(FileHandle & fileHandle,
+                        const RID & actRid,
+                        const void * record,
+                        const int & recordLen,
+                        RID & newRid,
+                        void * & oldPage) {
+    oldPage = malloc(fileHandle.getPageSize());
+    if (fileHandle.readPage(actRid.pageNum, oldPage) != 0 || releaseRecordAt(fileHandle, actRid) != 0) {
+        free(oldPage);
+        oldPage = nullptr;
+        return -1;
+    }
+    if (relocateRecord(fileHandle, record, recordLen, newRid) != 0) {
+        restorePage(fileHandle, actRid.pageNum, oldPage);
+        free(oldPage);
+        oldPage = nullptr;
+        return -1;
+    }
+    return 0;
+}
+
+// overwrite the record at slotNum on a page in memory if the page can take the new length, -1 if not:
+// a record that doesn't grow, or the last one on the page with room behind it, is overwritten where it is,
+// one that grows goes after the last record, and the page is compacted only when neither has the room
+RC replaceOnPage(void * buffer,
+                 const SlotNum & slotNum,
+                 const void * record,
+                 const int & recordLen) {
+    int oldOffset = getRecOffset(buffer, slotNum);
+    int oldLen = getRecLength(buffer, slotNum);
+    // the old bytes count as free, dead or not
+    if (freeSpaceOf(buffer) + oldLen < recordLen) {
+        return -1;
+    }
+    bool lastOnPage = oldOffset + oldLen == getFreeOffset(buffer);
+    if (recordLen <= oldLen || (lastOnPage && contiguousSpaceOf(buffer) >= recordLen - oldLen)) {
+        memcpy((char*)buffer + oldOffset, record, (size_t) recordLen);
+        putRecLength(buffer, slotNum, recordLen);
+        if (lastOnPage) {
+            putFreeOffset(buffer, oldOffset + recordLen);
+        }
+        else {
+            // the tail it no longer uses is dead until the next compaction
+            putDeadBytes(buffer, getDeadBytes(buffer) + oldLen - recordLen);
+        }
+        return 0;
+    }
+    removeRecord(buffer, slotNum);
+    makeRoomFor(buffer, recordLen);
+    insertIntoPageHelper(buffer, record, getFreeOffset(buffer), recordLen, slotNum);
+    return 0;
+}
+
+// replaceOnPage() on a page that is read and, if the record fit, written back
+RC replaceAt(FileHandle & fileHandle,
+             const RID & rid,
+             const void * record,
+             const int & recordLen) {
+    void * buffer = malloc(fileHandle.getPageSize());
+    RC rc = fileHandle.readPage(rid.pageNum, buffer);
+    if (rc == 0) {
+        rc = replaceOnPage(buffer, rid.slotNum, record, recordLen);
+    }
+    if (rc == 0) {
+        rc = fileHandle.writePage(rid.pageNum, buffer);
+    }
+    if (rc == 0) {
+        rc = pageChanged(fileHandle, rid.pageNum, buffer);
+    }
+    free(buffer);
+    return rc;
+}
+
 /*
  Implementation Algorithm:
  
- if the updated record length <= original record length + remaining space, just delete the original and call kickinRemainingRecord() and append the updated one in the end. Don't forget update the slot info.
- else, just delete the original record, allocate 1 byte memory to store a RID pointing to somewhere in another page, and call kickinRemainingRecord(), and put the updated one in the new place.
+ The home slot (rid) either holds the record or a 5-byte Beacon that points straight at it, never at another beacon:
+ 1. the record goes back to its home page whenever that page has the room, the copy it leaves elsewhere is released;
+    the common case, a record at home that fits, costs one page read and one page write, see replaceOnPage();
+ 2. otherwise a relocated record stays where it is if that page has the room;
+ 3. otherwise it moves to a page the free-space map finds and the home slot is (re)pointed at it,
+    the copy it leaves behind is released instead of becoming another beacon, but only once the home slot leads to the new one;
+    if no page has the room while that copy holds its space, it is released and the move is tried once more,
+    and when that fails too its page is written back as it was.
+ A read therefore costs at most two pages however often the record was updated.
+ Chains that older files may still hold are collapsed by the first update that reaches them.
  
- *** A "regular" record takes at least 6 bytes = [ 2 byte short pointer + 4 byte int data] (Varchar type of data includes 4 byte int indicating its length)
- *** A slot takes 4 bytes
+ *** A "regular" record takes at least 8 bytes = [ 4 byte field end + 4 byte int data] (Varchar type of data includes 4 byte int indicating its length),
+ ***   one whose fields are all NULL takes 4 bytes per field
+ *** A slot takes 8 bytes
  *** A page (4096 B) will hold at most [4096 / 1000]  = 409 such records.
  *** If we use 3 B to hold pageNum, it allows us to append(2^{24}) pages, which is 512GB, large enough.
  *** If we use 2 B to hold slotNum, it allows us to index (2^{16}) slots, which is 65535, large enough.
@@ -822,113 +1301,81 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
     if (pageNumInvalid(fileHandle, rid.pageNum)) {
         return -1;
     }
-    // read page in
-    void * buffer = malloc(PAGE_SIZE);
-    fileHandle.readPage(rid.pageNum, buffer);
-    // check slot
-    if (slotNumInvalid(buffer, rid.slotNum)) {
+    // read the home page in once, most updates are done on it
+    void * buffer = malloc(fileHandle.getPageSize());
+    if (fileHandle.readPage(rid.pageNum, buffer) != 0
+        || slotNumInvalid(buffer, rid.slotNum) || recordDeleted(buffer, rid)) {
+        free(buffer);
         return -1;
     }
-    // check if the record still there
-    if (recordDeleted(buffer, rid)) {
+    // find actual RID and the beacons on the way
+    RID actRid = rid;
+    vector<RID> beacons;
+    if (recordRelocated(buffer, rid) && locateRecord(fileHandle, rid, actRid, beacons) != 0) {
+        free(buffer);
         return -1;
     }
     // prepare upd record
-    short updRecLen;
+    int updRecLen;
     void * updRecord = decodeMetaFrom(data, recordDescriptor, updRecLen);
     
-    // recursively looking for actual RID and load up actualRecLen
-    RID actRid;
-    short actRecLen;
-    getRecordRecursive(fileHandle, rid, actRid, actRecLen);
-    // reload buffer
-    fileHandle.readPage(actRid.pageNum, buffer);
-
-    deleteRecordAndRearrange(buffer, actRid);
-    // freeSpaceOfs after the rearranging the space
-    short freeSpaceOffset = getFreeOffset(buffer);
-    short freeSpaceAmount = checkForSpace(fileHandle, actRid.pageNum);
-    
-    if (freeSpaceAmount >= updRecLen) {
-        
-        // append the updRecord and put new offset/length at the old slot
-        insertIntoPageHelper(buffer, updRecord, freeSpaceOffset, updRecLen, actRid.slotNum);
-        
-        // insertIntoNewPage() AND insertIntoPage() functions handle flush() operation already.
-        fileHandle.writePage(actRid.pageNum, buffer);
-    }
-    else {
-        int nxtAvaiPage = findNextAvaiPage(fileHandle, updRecLen);
-        
-        RID newRid;
-        if (nxtAvaiPage == PAGENUM_UNAVAILABLE) {
-            // inside the function, an empty page has been initialized and filled in with records as well as all other info, and flushed to disk.
-            insertIntoNewPage(fileHandle, updRecord, newRid, updRecLen);
-        }
-        else {
-            insertIntoPage(fileHandle, nxtAvaiPage, updRecord, newRid, updRecLen);
+    // 1. at home, the beacon (if any) is replaced by the record itself; a single page write
+    RC rc = 0;
+    RID newRid;
+    // the page the old copy was on, kept while that copy is released to make room for the move
+    void * oldPage = nullptr;
+    if (replaceOnPage(buffer, rid.slotNum, updRecord, updRecLen) == 0) {
+        rc = fileHandle.writePage(rid.pageNum, buffer);
+        if (rc == 0) {
+            rc = pageChanged(fileHandle, rid.pageNum, buffer);
         }
-        // Since not enough space for updRecord, simply put a 5-byte Beacon there, which points to where the updRecord is located.
-        Beacon beacon = compressed(newRid);
-        putBeaconIntoBuffer(buffer, actRid.slotNum, freeSpaceOffset, beacon);
-        
-//        insertIntoPageHelper(buffer, & beacon, freeSpaceOffset, (short) BEACON_SIZE, actRid.slotNum);
-        
-        // if the updated record's size exceeds what the current page could provide, the above code finds another page to store the record. Now, don't forget to flush the current page so that all the current buffer modifications take place.
-        fileHandle.writePage(actRid.pageNum, buffer);
-    }
-    
-    free(updRecord);
-    free(buffer);
-    
-    return 0;
-}
-
-short fieldLenToMetaLen(const unsigned long & fieldLen) {
-    return (short) sizeof(short) * fieldLen;
-}
-short getAttrOfsFromDecodedRec(const int & i,
-                               const void * record,
-                               const unsigned long & fieldLen) {
-    if (i >= fieldLen || i < 0) {
-        throw("Incorrect field index.");
+        newRid = rid;
     }
-    if (i == 0) {
-        short metaLen = fieldLenToMetaLen(fieldLen);
-        return metaLen;
+    // 2. where it already is
+    else if (!beacons.empty() && replaceAt(fileHandle, actRid, updRecord, updRecLen) == 0) {
+        newRid = actRid;
     }
+    // 3. another page; the old copy keeps its place until the home slot leads to the new one
     else {
-        short offset;
-        memcpy(&offset, (char*)record + (i - 1) * sizeof(short), sizeof(short));
-        return offset;
-    }
-}
-short getAttrLenFromDecodedRec(const int & i,
-                               const void * record,
-                               const unsigned long & fieldLen) {
-    if (i >= fieldLen || i < 0) {
-        throw("Incorrect field index.");
+        rc = relocateRecord(fileHandle, updRecord, updRecLen, newRid);
+        if (rc != 0 && !beacons.empty()) {
+            rc = relocateAfterRelease(fileHandle, actRid, updRecord, updRecLen, newRid, oldPage);
+        }
     }
-    auto thisOfs = *(short*)((char*)record + i * sizeof(short));
-    if (thisOfs == ATTR_NULL_FLAG) {
-        return 0;
+    
+    bool movedHome = sameRid(newRid, rid);
+    // unless the home slot already leads straight there
+    if (rc == 0 && !movedHome && !(beacons.size() == 1 && sameRid(newRid, actRid))) {
+        if (pointHomeAt(fileHandle, rid, newRid) != 0) {
+            // the home slot still leads to the old copy, the new one goes
+            if (!sameRid(newRid, actRid)) {
+                releaseRecordAt(fileHandle, newRid);
+            }
+            if (oldPage != nullptr) {
+                restorePage(fileHandle, actRid.pageNum, oldPage);
+            }
+            rc = -1;
+        }
     }
-    if (i == 0) {
-        short metaLen = fieldLenToMetaLen(fieldLen);
-        auto secRecOfs = *(short*)record;
-        return (secRecOfs - metaLen);
+    // the copy and the beacons the home slot no longer leads through
+    if (rc == 0 && oldPage == nullptr && !beacons.empty() && !sameRid(newRid, actRid)) {
+        rc = releaseRecordAt(fileHandle, actRid);
     }
-    else {
-        auto prevOfs = *(short*)((char*)record + (i - 1) * sizeof(short));
-        return (thisOfs - prevOfs);
+    for (unsigned i = 1; rc == 0 && i < beacons.size(); i++) {
+        rc = releaseRecordAt(fileHandle, beacons[i]);
     }
+    
+    free(oldPage);
+    free(updRecord);
+    free(buffer);
+    return rc;
 }
 
 RC readAttributeNo(const int i, const void * record, const unsigned long & fieldLen, void * data) {
-    short offset = getAttrOfsFromDecodedRec(i, record, fieldLen);
-    short length = getAttrLenFromDecodedRec(i, record, fieldLen);
+    int length;
+    const char * attrData = attributeOf(record, fieldLen, i, length);
     unsigned char nullIndicator;
-    if (length == 0) {
+    if (attrData == nullptr) {
         // the attr value is null;
         nullIndicator = 0x80;
         memcpy(data, & nullIndicator, 1);
@@ -938,38 +1385,56 @@ RC readAttributeNo(const int i, const void * record, const unsigned long & field
         nullIndicator = 0x0;
         // for any attr, the corresponding null indicator length is always 1.
         memcpy(data, & nullIndicator, 1);
-        memcpy((char*)data + 1, (char*)record + offset, (size_t)length);
+        memcpy((char*)data + 1, attrData, (size_t)length);
         return 0;
     }
     
 }
 
+// The page holding the record stays pinned while the attribute is copied out of it,
+// so only the null indicator and the field itself are ever copied.
 RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle,
                                          const vector<Attribute> &recordDescriptor,
                                          const RID &rid,
                                          const string &attributeName,
                                          void *data) {
-    // 1. readRecord() checks everything, including fileHandle, recordDescriptor, rid and if the record still exists.
-    // 2. readRecord() loads up the below ptr with encoded record
-    void * encodedRecord = malloc(PAGE_SIZE);
-    if (readRecord(fileHandle, recordDescriptor, rid, encodedRecord) == -1) {
+    if (fileHandleNotExists(fileHandle) || recordDescriptorNotExists(recordDescriptor)) {
         return -1;
     }
-    // 0 is returned anyway after this line
-    // because an attr will be fetched even it is a nullIndicator.
-    short recordLen;
-    void * record = decodeMetaFrom(encodedRecord, recordDescriptor, recordLen);
     const unsigned long fieldLen = recordDescriptor.size();
-    
-    int attrFound = -1;
-    for(int i = 0; i < fieldLen; i++) {
+    int fieldIdx = -1;
+    for (unsigned long i = 0; i < fieldLen; i++) {
         if (recordDescriptor[i].name == attributeName) {
-            attrFound = readAttributeNo(i, record, fieldLen, data); // load data and return 0
+            fieldIdx = i;
+            break;
         }
     }
-    free(encodedRecord);
-    free(record);
-    return 0;
+    if (fieldIdx == -1) {
+        return -1;
+    }
+    // follow the beacons, if any, to where the record actually lives
+    RID curtRid = rid;
+    while (true) {
+        if (pageNumInvalid(fileHandle, curtRid.pageNum)) {
+            return -1;
+        }
+        PageGuard page(fileHandle, curtRid.pageNum);
+        if (!page.valid()) {
+            return -1;
+        }
+        const char * buffer = page.data();
+        if (slotNumInvalid(buffer, curtRid.slotNum) || recordDeleted(buffer, curtRid)) {
+            return -1;
+        }
+        if (!recordRelocated(buffer, curtRid)) {
+            // 0 is returned even if the attr is NULL, data then holds just the nullIndicator
+            readAttributeNo(fieldIdx, buffer + getRecOffset(buffer, curtRid.slotNum), fieldLen, data);
+            return 0;
+        }
+        Beacon beacon;
+        memcpy(& beacon, buffer + getRecOffset(buffer, curtRid.slotNum), (size_t)BEACON_SIZE);
+        curtRid = decompressed(beacon);
+    }
 }
 
 
@@ -984,8 +1449,17 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
                                 // a list of projected attributes
                                 RBFM_ScanIterator &rbfm_ScanIterator)
 {
-    rbfm_ScanIterator.initialize(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
-    return 0;
+    return rbfm_ScanIterator.initialize(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
+}
+
+RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+                                const vector<Attribute> &recordDescriptor,
+                                const ScanFilter &filter,
+                                const vector<string> &attributeNames,
+                                RBFM_ScanIterator &rbfm_ScanIterator,
+                                const ScanMode mode)
+{
+    return rbfm_ScanIterator.initialize(fileHandle, recordDescriptor, filter, attributeNames, mode);
 }
 
 // ------------------------------------------------------------
@@ -999,79 +1473,171 @@ RC RBFM_ScanIterator::initialize(FileHandle &fileHandle,
                                  // used in the comparison
                                  const vector<string> &attributeNames)
                                  // a list of projected attributes
+{
+    this->conditionAttribute = conditionAttribute;
+    this->compOp = compOp;
+    this->value = value;
+    return initialize(fileHandle,
+                      recordDescriptor,
+                      ScanFilter::compare(conditionAttribute, compOp, value),
+                      attributeNames);
+}
+
+RC RBFM_ScanIterator::initialize(FileHandle &fileHandle,
+                                 const vector<Attribute> &recordDescriptor,
+                                 const ScanFilter &filter,
+                                 const vector<string> &attributeNames,
+                                 const ScanMode mode)
 {
     // add checking statements ?
     // init public variables global to this class
     this->fileHandle = fileHandle;
     this->recordDescriptor = recordDescriptor;
-    this->conditionAttribute = conditionAttribute;
-    this->compOp = compOp;
-    this->value = value;
     this->attributeNames = attributeNames;
     
     for(int i = 0; i < recordDescriptor.size(); i++) {
         this->attrMap[recordDescriptor[i].name] = i;
     }
+    this->projectedFields.clear();
+    this->projectedTypes.clear();
+    this->projectedDescriptor.clear();
+    for (const string & attr : attributeNames) {
+        if (this->attrMap.count(attr) == 0) {
+            return -1;
+        }
+        this->projectedFields.push_back(this->attrMap[attr]);
+        this->projectedTypes.push_back(recordDescriptor[this->attrMap[attr]].type);
+        this->projectedDescriptor.push_back(recordDescriptor[this->attrMap[attr]]);
+    }
+    if (this->condition.compile(recordDescriptor, filter) != 0) {
+        return -1;
+    }
+    skipPagesByZones();
+    this->parallel.reset();
+    if (mode != SerialScan) {
+        this->parallel = make_shared<ParallelScan>(*this, mode == OrderedParallelScan);
+        return 0;
+    }
 
+    // scratch space for the whole scan, nothing is allocated per record
+    this->pageFrame.resize(fileHandle.getPageSize());
+    this->frameValid = false;
     this->curtPageNum = 0;
     this->curtSlotNum = 0;
+    this->readAheadWindow = SCAN_READ_AHEAD_START < this->maxReadAhead ? SCAN_READ_AHEAD_START : this->maxReadAhead;
+    this->readAheadUntil = 0;
+    // pages are visited in order, a mapped file can be read ahead by the kernel
+    this->fileHandle.beginSequentialRead();
+    return 0;
+}
+
+
+RC RBFM_ScanIterator::setReadAhead(const unsigned &pages)
+{
+    this->maxReadAhead = pages;
+    if (this->readAheadWindow > pages) {
+        this->readAheadWindow = pages;
+    }
     return 0;
 }
 
 
-RC RBFM_ScanIterator::loadNxtRecOnSlot(RID & rid,
-                                       void * decodedRec,
+// the next satisfying record on this page, left where it is
+RC RBFM_ScanIterator::findNxtRecOnSlot(RID & rid,
                                        const void * buffer,
-                                       const vector<Attribute> & recordDescriptor)
+                                       const char * & record)
 {
     short totUsedSlotsNum = getTotalUsedSlotsNum(buffer);
     while (this->curtSlotNum < totUsedSlotsNum)
     {
         // update rid every iteration!
         rid.slotNum = this->curtSlotNum;
+        // advance to next slotNum whether or not this one is taken
+        this->curtSlotNum++;
         if (recordDeleted(buffer, rid) || recordRelocated(buffer, rid)) {
-            this->curtSlotNum++;
             continue;
         }
-        short recLen;
-        void * record = getRecordStraight(buffer, rid, recLen);
-        // decodeRec = record is NOT going to do the job!
-        memcpy(decodedRec, record, recLen);
-        // fetch record successful! Now free the holder.
-        free(record);
-        
-        this->curtSlotNum++;
-        // advance to next slotNum if getNextRecord() gets called again.
+        // the condition is tested on the page, only qualifying records are copied out
+        record = (const char*)buffer + getRecOffset(buffer, rid.slotNum);
+        if (!this->condition.test(record, this->recordDescriptor.size())) {
+            continue;
+        }
         return 0;
     }
     // failed to fetch next record on this page
     return -1;
-    
 }
 
-RC RBFM_ScanIterator::loadNxtRecOnPage(RID &rid,
-                                       void * decodedRec,
-                                       const vector<Attribute> & recordDescriptor )
+// the zone map is asked once, when the scan starts; pages appended later are always read
+RC RBFM_ScanIterator::skipPagesByZones()
+{
+    this->skippedPages.clear();
+    shared_ptr<ZoneMap> zones = RecordBasedFileManager::instance()->zoneMapOf(this->fileHandle);
+    if (!zones || zones->fieldCount != this->recordDescriptor.size()) {
+        return 0;
+    }
+    unsigned totalPageNum = this->fileHandle.getNumberOfPages();
+    this->skippedPages.assign(totalPageNum, false);
+    vector<ZoneColumn> columns;
+    for (PageNum pageNum = 0; pageNum < totalPageNum; pageNum++) {
+        bool known;
+        if (zones->get(pageNum, columns, known) == 0 && known) {
+            this->skippedPages[pageNum] = !this->condition.mayMatch(*zones, columns);
+        }
+    }
+    return 0;
+}
+
+// a scan only moves forward, so the next run of pages is read in before it is needed
+void RBFM_ScanIterator::readAheadFrom(const PageNum & pageNum)
+{
+    if (this->maxReadAhead > 0 && pageNum >= this->readAheadUntil) {
+        this->fileHandle.readAhead(pageNum, this->readAheadWindow);
+        this->readAheadUntil = pageNum + this->readAheadWindow;
+        this->readAheadWindow = this->readAheadWindow * 2 > this->maxReadAhead ? this->maxReadAhead : this->readAheadWindow * 2;
+    }
+}
+
+// a mapped file hands out the page itself, otherwise it is copied into the frame once
+const void * RBFM_ScanIterator::pageAt(const PageNum & pageNum)
+{
+    const void * page = this->fileHandle.mappedPage(pageNum);
+    if (page != nullptr) {
+        return page;
+    }
+    if (!this->frameValid || this->framedPage != pageNum) {
+        if (this->fileHandle.readPage(pageNum, this->pageFrame.data()) != 0) {
+            this->frameValid = false;
+            return nullptr;
+        }
+        this->framedPage = pageNum;
+        this->frameValid = true;
+    }
+    return this->pageFrame.data();
+}
+
+// the next satisfying record of the file, left on its page
+RC RBFM_ScanIterator::findNxtRecOnPage(RID &rid, const char * &record)
 {
     unsigned totalPageNum = this->fileHandle.getNumberOfPages();
     while (this->curtPageNum < totalPageNum)
     {
-        void * buffer = malloc(PAGE_SIZE);
-        this->fileHandle.readPage(this->curtPageNum, buffer);
+        if (this->curtPageNum < this->skippedPages.size() && this->skippedPages[this->curtPageNum]) {
+            this->curtPageNum++;
+            this->curtSlotNum = 0;
+            continue;
+        }
+        readAheadFrom(this->curtPageNum);
+        const void * page = pageAt(this->curtPageNum);
         rid.pageNum = this->curtPageNum;
-        // rid.slotNum should be filled while executing loadNxtRecOnSlot()
+        // rid.slotNum should be filled while executing findNxtRecOnSlot()
         
-        RC rc = loadNxtRecOnSlot(rid, decodedRec, buffer, recordDescriptor);
-
         // didn't find a record on curt page
-        if (rc == -1) {
+        if (page == nullptr || findNxtRecOnSlot(rid, page, record) == -1) {
             this->curtPageNum++;
             this->curtSlotNum = 0;
             continue;
         }
-        // void * decodedRec has been loaded
-        
-        free(buffer);
         return 0;
     }
     // failed to load the next record because of EOF
@@ -1079,19 +1645,6 @@ RC RBFM_ScanIterator::loadNxtRecOnPage(RID &rid,
 }
 
 
-RC loadDataFor(const int fieldIdx,
-               void * projectRec,
-               const void * decodedRec,
-               short & proRecLen,
-               const unsigned long & allAttrNum)
-{
-    short offset = getAttrOfsFromDecodedRec(fieldIdx, decodedRec, allAttrNum);
-    short attrLen = getAttrLenFromDecodedRec(fieldIdx, decodedRec, allAttrNum);
-    memcpy((char*)projectRec + proRecLen, (char*)decodedRec + offset, (size_t)attrLen);
-    proRecLen += attrLen;
-    return 0;
-}
-
 RC turnOnBit(void * targetMeta,
              const unsigned long & targetCounter)
 {
@@ -1108,231 +1661,1129 @@ RC turnOnBit(void * targetMeta,
     
     return 0;
 }
-RC loadMetaFor(const int & fieldIdx,
-               void * targetMeta,
-               const void * allMeta,
-               const unsigned long & targetCounter)
-{
-    short byte = fieldIdx / BITES_PER_BYTE;
-    unsigned char allMetaByte;
-    memcpy(& allMetaByte, (char*)allMeta + byte, 1);
-    
-    short bit = fieldIdx % BITES_PER_BYTE;
-    auto mask = (unsigned char) (0x80 >> bit);
-
-    if ((allMetaByte & mask) == mask) {
-        turnOnBit(targetMeta, targetCounter);
-    }
-    
-    return 0;
-}
+/* ---------------------------------------------------------------------------------------
+ Compiled conditions
+ --------------------------------------------------------------------------------------- */
 
-bool compareInt(const void * attrData,
-                const CompOp & compOp,
-                const void * value)
+// op is a template argument, so each instantiation compiles down to a single comparison
+template<CompOp op, typename T>
+inline bool holds(const T & attr, const T & value)
 {
-    switch (compOp) {
+    switch (op) {
         case EQ_OP:
-            return (*(int*)attrData == *(int*)value);
+            return attr == value;
         case LT_OP:
-            return (*(int*)attrData < *(int*)value);
+            return attr < value;
         case LE_OP:
-            return (*(int*)attrData <= *(int*)value);
+            return attr <= value;
         case GT_OP:
-            return (*(int*)attrData > *(int*)value);
+            return attr > value;
         case GE_OP:
-            return (*(int*)attrData >= *(int*)value);
+            return attr >= value;
         case NE_OP:
-            return (*(int*)attrData != *(int*)value);
-        case NO_OP: // just to get rid of warning, it shouldn't be screened in earlier phase
-            return true;
+            return attr != value;
         default:
-            throw("Unrecognized type of CompOp found!");
-            break;
+            return true;
     }
 }
-bool compareReal(const void * attrData,
-                const CompOp & compOp,
-                const void * value)
+
+// fields on a page aren't aligned, they are loaded with memcpy
+template<CompOp op>
+bool intFieldTest(const char * field, const char * value)
 {
-    switch (compOp) {
-        case EQ_OP:
-            return (*(float*)attrData == *(float*)value);
-        case LT_OP:
-            return (*(float*)attrData < *(float*)value);
-        case LE_OP:
-            return (*(float*)attrData <= *(float*)value);
-        case GT_OP:
-            return (*(float*)attrData > *(float*)value);
-        case GE_OP:
-            return (*(float*)attrData >= *(float*)value);
-        case NE_OP:
-            return (*(float*)attrData != *(float*)value);
-        case NO_OP: // just to get rid of warning, it shouldn't be screened in earlier phase
-            return true;
-        default:
-            throw("Unrecognized type of CompOp found!");
-            break;
+    int attr, target;
+    memcpy(& attr, field, sizeof(int));
+    memcpy(& target, value, sizeof(int));
+    return holds<op>(attr, target);
+}
+
+template<CompOp op>
+bool realFieldTest(const char * field, const char * value)
+{
+    float attr, target;
+    memcpy(& attr, field, sizeof(float));
+    memcpy(& target, value, sizeof(float));
+    return holds<op>(attr, target);
+}
+
+// [int length][chars] on both sides, ordered like string::compare()
+template<CompOp op>
+bool varCharFieldTest(const char * field, const char * value)
+{
+    int attrLen, targetLen;
+    memcpy(& attrLen, field, sizeof(int));
+    memcpy(& targetLen, value, sizeof(int));
+    int cmp = memcmp(field + sizeof(int), value + sizeof(int), (size_t) min(attrLen, targetLen));
+    if (cmp == 0) {
+        cmp = (attrLen > targetLen) - (attrLen < targetLen);
     }
+    return holds<op>(cmp, 0);
 }
 
-string getStringFromMemStd(const void * data) {
-    int strLen = *(int*)data;
-    // no Varchar entry takes memory more than 1 page
-    char strVal[PAGE_SIZE];
-    memcpy(strVal, (char*)data + sizeof(int), (size_t) strLen);
-    strVal[strLen] = '\0';
-    return string(strVal);
+template<CompOp op>
+FieldTest fieldTestFor(const AttrType & type)
+{
+    switch (type) {
+        case TypeInt:
+            return intFieldTest<op>;
+        case TypeReal:
+            return realFieldTest<op>;
+        case TypeVarChar:
+            return varCharFieldTest<op>;
+        default:
+            throw("Other type of attribute than TypeInt, TypeReal, TypeVarChar.");
+    }
 }
 
-bool compareVarChar(const void * attrData,
-                const CompOp & compOp,
-                const void * value)
+FieldTest fieldTestFor(const AttrType & type, const CompOp & compOp)
 {
-    
-    string attrStr = getStringFromMemStd(attrData);
-    string valueStr = getStringFromMemStd(value);
     switch (compOp) {
         case EQ_OP:
-            return (attrStr.compare(valueStr) == 0);
+            return fieldTestFor<EQ_OP>(type);
         case LT_OP:
-            return (attrStr.compare(valueStr) < 0);
+            return fieldTestFor<LT_OP>(type);
         case LE_OP:
-            return (attrStr.compare(valueStr) <= 0);
+            return fieldTestFor<LE_OP>(type);
         case GT_OP:
-            return (attrStr.compare(valueStr) > 0);
+            return fieldTestFor<GT_OP>(type);
         case GE_OP:
-            return (attrStr.compare(valueStr) >= 0);
+            return fieldTestFor<GE_OP>(type);
         case NE_OP:
-            return (attrStr.compare(valueStr) != 0);
-        case NO_OP: // just to get rid of warning, it shouldn't be screened in earlier phase
-            return true;
+            return fieldTestFor<NE_OP>(type);
         default:
-            throw("Unrecognized type of CompOp found!");
-            break;
+            return nullptr;
     }
 }
-bool satisfyCondition(const void * decodedRec,
-                      const vector<Attribute> & recordDescriptor,
-                      const unordered_map<string, int> & attrMap,
-                      const string & conditionAttribute,
-                      const CompOp & compOp,
-                      const void * value)
+
+ScanFilter ScanFilter::compare(const string &attribute, const CompOp compOp, const void *value)
 {
-    if (conditionAttribute.compare(string("")) == 0) {
-        // no condition specified
-        return true;
-    }
-    if (compOp == NO_OP) {
-        // no compOp specified
-        return true;
-    }
-    if (value == NULL || value == nullptr) {
-        // no comp value specified
-        return true;
-    }
-    // access mode: attrMap[conditionAttribute] is not allowed when attrMap is const
-    int fieldIdx = attrMap.at(conditionAttribute);
-    void * attrData = malloc(PAGE_SIZE);
-    RC rc = readAttributeNo(fieldIdx, decodedRec, recordDescriptor.size(), attrData);
-    if (rc == -1) {
-        // if attrData is a nullIndicator
-        return (compOp == NO_OP);
-    }
-    // attrData -> [nullIndicator + data]
-    bool rst;
-    switch (recordDescriptor[fieldIdx].type) {
-        case TypeInt:
-            rst = compareInt((char*)attrData + 1, compOp, value);
-            free(attrData);
-            return rst;
-        case TypeReal:
-            rst = compareReal((char*)attrData + 1, compOp, value);
-            free(attrData);
-            return rst;
-        case TypeVarChar:
-            rst = compareVarChar((char*)attrData + 1, compOp, value);
-            free(attrData);
-            return rst;
-        default:
-            throw("Other type of attribute than TypeInt, TypeReal, TypeVarChar.");
-            break;
+    ScanFilter filter;
+    // no condition, no compOp or no comp value: every record qualifies
+    if (attribute.empty() || compOp == NO_OP || value == nullptr) {
+        return filter;
     }
+    filter.kind = FILTER_COMPARE;
+    filter.attribute = attribute;
+    filter.compOp = compOp;
+    filter.values.push_back(value);
+    return filter;
 }
 
-RC projectAttributeOnto(void * projectRec,
-                        const void * decodedRec,
-                        const vector<Attribute> & recordDescriptor,
-                        const unordered_map<string, int> & attrMap,
-                        const vector<string> & attributeNames)
-{
-    void * encodedRec = malloc(PAGE_SIZE);
-    encodeMetaInto(encodedRec, decodedRec, recordDescriptor);
-    // get its encoded version and put into allMeta
-    const unsigned long allAttrNum = recordDescriptor.size();
-    short a_bytes = ceil((double)allAttrNum / BITES_PER_BYTE);
-    void * allMeta = malloc((size_t) a_bytes);
-    memcpy(allMeta, encodedRec, (size_t) a_bytes);
-    
-    // unsigned char targetMeta[t_bytes] -> variable size object cannot be initialized : everything initialized like this sits on stack and their size must be figured out during compile time
-    // on the other hand, you can use "new" to initialize a char array with variable size in heap
-    const unsigned long targetAttrNum = attributeNames.size();
-    short t_bytes = ceil((double)targetAttrNum / BITES_PER_BYTE);
-    void * targetMeta = malloc((size_t) t_bytes);
-    memset(targetMeta, 0, (size_t) t_bytes);
-    
-    short proRecLen = t_bytes; // where to start appending field data
-    unsigned long targetCounter = 0;
-    
-    for(string attr : attributeNames) {
-        if (attrMap.count(attr) == 0) {
-            throw("sanity check");
-        }
-        int idx = attrMap.at(attr);
-        loadMetaFor(idx, targetMeta, allMeta, targetCounter);
-        loadDataFor(idx, projectRec, decodedRec, proRecLen, allAttrNum);
-        targetCounter++;
-    }
-
-    memcpy(projectRec, targetMeta, t_bytes);
-    
-    free(encodedRec);
-    free(allMeta);
-    free(targetMeta);
-    return 0;
+ScanFilter ScanFilter::in(const string &attribute, const vector<const void*> &values)
+{
+    ScanFilter filter;
+    filter.kind = FILTER_IN;
+    filter.attribute = attribute;
+    filter.values = values;
+    return filter;
 }
 
-// load up rid and data
-RC RBFM_ScanIterator::getNextRecord(RID &rid,
-                                    void *data)
+ScanFilter ScanFilter::between(const string &attribute, const void *low, const void *high)
 {
-    // get some space
-    void * decodedRec = malloc(PAGE_SIZE);
-    do {
-        // fetch the next decoded record
-        RC rc1 = loadNxtRecOnPage(rid, decodedRec, this->recordDescriptor);
-        if (rc1 == -1) {
+    ScanFilter filter;
+    filter.kind = FILTER_BETWEEN;
+    filter.attribute = attribute;
+    filter.values.push_back(low);
+    filter.values.push_back(high);
+    return filter;
+}
+
+ScanFilter ScanFilter::allOf(const vector<ScanFilter> &filters)
+{
+    ScanFilter filter;
+    filter.kind = FILTER_AND;
+    filter.children = filters;
+    return filter;
+}
+
+ScanFilter ScanFilter::anyOf(const vector<ScanFilter> &filters)
+{
+    ScanFilter filter;
+    filter.kind = FILTER_OR;
+    filter.children = filters;
+    return filter;
+}
+
+ScanFilter ScanFilter::negate(const ScanFilter &filter)
+{
+    ScanFilter negation;
+    negation.kind = FILTER_NOT;
+    negation.children.push_back(filter);
+    return negation;
+}
+
+// a filter evaluates to one of three values, a term on a NULL attr is unknown
+const int TRUTH_FALSE = 0;
+const int TRUTH_TRUE = 1;
+const int TRUTH_UNKNOWN = 2;
+
+// FNV-1a over the bytes of a field
+size_t hashOfBytes(const char * bytes, const size_t & length)
+{
+    size_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// the bytes of a field an in-list matches on: a varchar without its length, a real with -0 as 0
+const char * memberKeyOf(const char * field, const AttrType & type, int & length, float & zero)
+{
+    if (type == TypeVarChar) {
+        int charsLen;
+        memcpy(& charsLen, field, sizeof(int));
+        length = charsLen;
+        return field + sizeof(int);
+    }
+    length = sizeof(int);
+    float real;
+    memcpy(& real, field, sizeof(float));
+    if (type == TypeReal && real == 0) {
+        zero = 0;
+        return (const char*)& zero;
+    }
+    return field;
+}
+
+size_t attrValueLen(const AttrType & type, const void * value)
+{
+    if (type == TypeVarChar) {
+        int charsLen;
+        memcpy(& charsLen, value, sizeof(int));
+        return sizeof(int) + charsLen;
+    }
+    return sizeof(int);
+}
+
+// rough selectivities of the textbook kind, there are no statistics to go by
+double selectivityOf(const CompOp & compOp)
+{
+    switch (compOp) {
+        case EQ_OP:
+            return 0.1;
+        case NE_OP:
+            return 0.9;
+        default:
+            return 1.0 / 3;
+    }
+}
+
+RC CompiledCondition::compile(const vector<Attribute> &recordDescriptor,
+                              const ScanFilter &filter)
+{
+    this->_nodes.clear();
+    this->_root = -1;
+    if (filter.kind == FILTER_ALL) {
+        return 0;
+    }
+    return this->_compile(recordDescriptor, filter, this->_root);
+}
+
+RC CompiledCondition::_compileLeaf(const vector<Attribute> &recordDescriptor,
+                                   const ScanFilter &filter,
+                                   ConditionNode &node)
+{
+    node.fieldIdx = -1;
+    for (unsigned i = 0; i < recordDescriptor.size(); i++) {
+        if (recordDescriptor[i].name == filter.attribute) {
+            node.fieldIdx = i;
+            break;
+        }
+    }
+    if (node.fieldIdx == -1) {
+        return -1;
+    }
+    for (const void * value : filter.values) {
+        if (value == nullptr) {
+            return -1;
+        }
+    }
+    node.type = recordDescriptor[node.fieldIdx].type;
+    node.cost = node.type == TypeVarChar ? 2 : 1;
+    // keep copies of the values, the caller's buffers may not outlive the scan
+    switch (filter.kind) {
+        case FILTER_COMPARE:
+            node.compOp = filter.compOp;
+            node.test = fieldTestFor(node.type, filter.compOp);
+            node.value.assign((const char*)filter.values[0], attrValueLen(node.type, filter.values[0]));
+            node.selectivity = selectivityOf(filter.compOp);
+            return 0;
+        case FILTER_BETWEEN:
+            if (filter.values.size() != 2) {
+                return -1;
+            }
+            node.test = fieldTestFor(node.type, GE_OP);
+            node.value.assign((const char*)filter.values[0], attrValueLen(node.type, filter.values[0]));
+            node.upperTest = fieldTestFor(node.type, LE_OP);
+            node.upperValue.assign((const char*)filter.values[1], attrValueLen(node.type, filter.values[1]));
+            node.cost *= 2;
+            node.selectivity = 0.25;
+            return 0;
+        case FILTER_IN:
+            for (const void * value : filter.values) {
+                int keyLen;
+                float zero;
+                const char * key = memberKeyOf((const char*)value, node.type, keyLen, zero);
+                node.members.insert(make_pair(hashOfBytes(key, keyLen), string(key, keyLen)));
+            }
+            node.cost += 1;
+            node.selectivity = min(0.1 * filter.values.size(), 0.5);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+// terms are placed depth first, a node's children are ordered once they are all compiled:
+// an AND runs first what is cheap and most often false (cost / (1 - selectivity)),
+// an OR what is cheap and most often true (cost / selectivity)
+RC CompiledCondition::_compile(const vector<Attribute> &recordDescriptor,
+                               const ScanFilter &filter,
+                               int &nodeIdx)
+{
+    ConditionNode node;
+    node.kind = filter.kind;
+    node.compOp = NO_OP;
+    node.test = nullptr;
+    node.upperTest = nullptr;
+    node.cost = 0;
+    node.selectivity = 1;
+    switch (filter.kind) {
+        case FILTER_ALL:
+            break;
+        case FILTER_COMPARE:
+        case FILTER_IN:
+        case FILTER_BETWEEN:
+            if (this->_compileLeaf(recordDescriptor, filter, node) != 0) {
+                return -1;
+            }
+            break;
+        case FILTER_AND:
+        case FILTER_OR:
+        case FILTER_NOT:
+            if (filter.kind == FILTER_NOT && filter.children.size() != 1) {
+                return -1;
+            }
+            node.selectivity = filter.kind == FILTER_OR ? 0 : 1;
+            for (const ScanFilter & child : filter.children) {
+                int childIdx;
+                if (this->_compile(recordDescriptor, child, childIdx) != 0) {
+                    return -1;
+                }
+                const ConditionNode & compiled = this->_nodes[childIdx];
+                node.children.push_back(childIdx);
+                node.cost += compiled.cost;
+                if (filter.kind == FILTER_OR) {
+                    node.selectivity = 1 - (1 - node.selectivity) * (1 - compiled.selectivity);
+                }
+                else if (filter.kind == FILTER_AND) {
+                    node.selectivity *= compiled.selectivity;
+                }
+                else {
+                    node.selectivity = 1 - compiled.selectivity;
+                }
+            }
+            break;
+    }
+    const vector<ConditionNode> & nodes = this->_nodes;
+    if (node.kind == FILTER_AND) {
+        stable_sort(node.children.begin(), node.children.end(), [&nodes](const int & a, const int & b) {
+            return nodes[a].cost * (1 - nodes[b].selectivity) < nodes[b].cost * (1 - nodes[a].selectivity);
+        });
+    }
+    else if (node.kind == FILTER_OR) {
+        stable_sort(node.children.begin(), node.children.end(), [&nodes](const int & a, const int & b) {
+            return nodes[a].cost * nodes[b].selectivity < nodes[b].cost * nodes[a].selectivity;
+        });
+    }
+    nodeIdx = (int) this->_nodes.size();
+    this->_nodes.push_back(node);
+    return 0;
+}
+
+int CompiledCondition::_evaluate(const int &nodeIdx, const void * record, const unsigned long & fieldLen) const
+{
+    const ConditionNode & node = this->_nodes[nodeIdx];
+    int truth;
+    switch (node.kind) {
+        case FILTER_ALL:
+            return TRUTH_TRUE;
+        case FILTER_AND:
+            // false decides, unknown only if nothing is false
+            truth = TRUTH_TRUE;
+            for (const int & child : node.children) {
+                int term = this->_evaluate(child, record, fieldLen);
+                if (term == TRUTH_FALSE) {
+                    return TRUTH_FALSE;
+                }
+                if (term == TRUTH_UNKNOWN) {
+                    truth = TRUTH_UNKNOWN;
+                }
+            }
+            return truth;
+        case FILTER_OR:
+            truth = TRUTH_FALSE;
+            for (const int & child : node.children) {
+                int term = this->_evaluate(child, record, fieldLen);
+                if (term == TRUTH_TRUE) {
+                    return TRUTH_TRUE;
+                }
+                if (term == TRUTH_UNKNOWN) {
+                    truth = TRUTH_UNKNOWN;
+                }
+            }
+            return truth;
+        case FILTER_NOT:
+            truth = this->_evaluate(node.children[0], record, fieldLen);
+            if (truth == TRUTH_UNKNOWN) {
+                return TRUTH_UNKNOWN;
+            }
+            return truth == TRUTH_TRUE ? TRUTH_FALSE : TRUTH_TRUE;
+        default:
+            break;
+    }
+    int length;
+    const char * field = attributeOf(record, fieldLen, node.fieldIdx, length);
+    if (field == nullptr) {
+        return TRUTH_UNKNOWN;
+    }
+    if (node.kind == FILTER_IN) {
+        int keyLen;
+        float zero;
+        const char * key = memberKeyOf(field, node.type, keyLen, zero);
+        auto range = node.members.equal_range(hashOfBytes(key, keyLen));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.size() == (size_t) keyLen && memcmp(it->second.data(), key, keyLen) == 0) {
+                return TRUTH_TRUE;
+            }
+        }
+        return TRUTH_FALSE;
+    }
+    if (!node.test(field, node.value.data())) {
+        return TRUTH_FALSE;
+    }
+    if (node.upperTest != nullptr && !node.upperTest(field, node.upperValue.data())) {
+        return TRUTH_FALSE;
+    }
+    return TRUTH_TRUE;
+}
+
+bool CompiledCondition::test(const void * record, const unsigned long & fieldLen) const
+{
+    if (this->_root == -1) {
+        return true;
+    }
+    return this->_evaluate(this->_root, record, fieldLen) == TRUTH_TRUE;
+}
+
+// an AND needs every term to be possible, an OR one of them;
+// a NOT, or a term on an attribute that isn't summarized, rules nothing out
+bool CompiledCondition::_mayMatch(const int &nodeIdx, const ZoneMap & zones, const vector<ZoneColumn> & columns) const
+{
+    const ConditionNode & node = this->_nodes[nodeIdx];
+    switch (node.kind) {
+        case FILTER_AND:
+            for (const int & child : node.children) {
+                if (!this->_mayMatch(child, zones, columns)) {
+                    return false;
+                }
+            }
+            return true;
+        case FILTER_OR:
+            for (const int & child : node.children) {
+                if (this->_mayMatch(child, zones, columns)) {
+                    return true;
+                }
+            }
+            return false;
+        case FILTER_COMPARE:
+        case FILTER_BETWEEN:
+        case FILTER_IN:
+            break;
+        default:
+            return true;
+    }
+    int c = zones.columnOf(node.fieldIdx);
+    if (c == -1) {
+        return true;
+    }
+    char key[ZONE_KEY_SIZE];
+    if (node.kind == FILTER_IN) {
+        // the members are kept without a varchar's length
+        for (auto it = node.members.begin(); it != node.members.end(); ++it) {
+            zoneKeyOf(node.type, it->second.data(), (unsigned) it->second.size(), key);
+            if (zoneMayHold(node.type, columns[c], EQ_OP, key)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    const int valueOfs = node.type == TypeVarChar ? sizeof(int) : 0;
+    zoneKeyOf(node.type, node.value.data() + valueOfs, (unsigned) (node.value.size() - valueOfs), key);
+    if (node.kind == FILTER_COMPARE) {
+        return zoneMayHold(node.type, columns[c], node.compOp, key);
+    }
+    if (!zoneMayHold(node.type, columns[c], GE_OP, key)) {
+        return false;
+    }
+    zoneKeyOf(node.type, node.upperValue.data() + valueOfs, (unsigned) (node.upperValue.size() - valueOfs), key);
+    return zoneMayHold(node.type, columns[c], LE_OP, key);
+}
+
+bool CompiledCondition::mayMatch(const ZoneMap & zones, const vector<ZoneColumn> & columns) const
+{
+    if (this->_root == -1) {
+        return true;
+    }
+    return this->_mayMatch(this->_root, zones, columns);
+}
+
+// ---------------------------------------------------------------------------------------
+
+// the projected fields are copied straight from the stored record,
+// the null bits are set from its offset array
+RC projectAttributeOnto(void * projectRec,
+                        const void * record,
+                        const unsigned long & fieldLen,
+                        const vector<int> & projectedFields)
+{
+    const unsigned long targetAttrNum = projectedFields.size();
+    int t_bytes = ceil((double)targetAttrNum / BITES_PER_BYTE);
+    memset(projectRec, 0, (size_t) t_bytes);
+    int proRecLen = t_bytes; // where to start appending field data
+    
+    for (unsigned long targetCounter = 0; targetCounter < targetAttrNum; targetCounter++) {
+        int attrLen;
+        const char * attrData = attributeOf(record, fieldLen, projectedFields[targetCounter], attrLen);
+        if (attrData == nullptr) {
+            turnOnBit(projectRec, targetCounter);
+        }
+        else {
+            memcpy((char*)projectRec + proRecLen, attrData, (size_t)attrLen);
+            proRecLen += attrLen;
+        }
+    }
+    return 0;
+}
+
+// load up rid and data
+RC RBFM_ScanIterator::getNextRecord(RID &rid,
+                                    void *data)
+{
+    if (this->parallel) {
+        const char * record;
+        if (this->parallel->next(rid, record) == -1) {
             return RBFM_EOF;
         }
-    // check if the attr satisfy the select criteria
-    } while (!satisfyCondition(decodedRec,
-                               this->recordDescriptor,
-                               this->attrMap,
-                               this->conditionAttribute,
-                               this->compOp,
-                               this->value));
+        // the workers projected it already
+        encodeMetaInto(data, record, this->projectedDescriptor);
+        return 0;
+    }
+    // fetch the next record that satisfies the select criteria, it stays on its page
+    const char * record;
+    if (findNxtRecOnPage(rid, record) == -1) {
+        return RBFM_EOF;
+    }
     
     // project required attribute to data
     projectAttributeOnto(data,
-                         decodedRec,
-                         this->recordDescriptor,
-                         this->attrMap,
-                         this->attributeNames);
+                         record,
+                         this->recordDescriptor.size(),
+                         this->projectedFields);
     return 0;
 };
 
 
+/* ---------------------------------------------------------------------------------------
+ Record batches
+ --------------------------------------------------------------------------------------- */
 
+RecordBatch::RecordBatch(const unsigned & capacity)
+: capacity(capacity)
+{
+}
 
+RC RecordBatch::clear(const vector<AttrType> & types)
+{
+    this->rows = 0;
+    if (this->types != types || this->rids.size() != this->capacity) {
+        this->types = types;
+        this->rids.resize(this->capacity);
+        this->values.assign(types.size(), vector<char>());
+        this->offsets.assign(types.size(), vector<unsigned>());
+        this->bytes.assign(types.size(), vector<char>());
+        this->nulls.assign(types.size(), vector<unsigned char>());
+        for (unsigned c = 0; c < types.size(); c++) {
+            if (types[c] == TypeVarChar) {
+                this->offsets[c].resize(this->capacity + 1);
+            }
+            else {
+                this->values[c].resize((size_t) this->capacity * sizeof(int));
+            }
+            this->nulls[c].resize((this->capacity + BITES_PER_BYTE - 1) / BITES_PER_BYTE);
+        }
+    }
+    for (unsigned c = 0; c < types.size(); c++) {
+        memset(this->nulls[c].data(), 0, this->nulls[c].size());
+        this->bytes[c].clear();
+        if (types[c] == TypeVarChar) {
+            this->offsets[c][0] = 0;
+        }
+    }
+    return 0;
+}
 
+const int * RecordBatch::intColumn(const unsigned & column) const
+{
+    return (const int*) this->values[column].data();
+}
 
+const float * RecordBatch::realColumn(const unsigned & column) const
+{
+    return (const float*) this->values[column].data();
+}
+
+const char * RecordBatch::varCharAt(const unsigned & column, const unsigned & row, unsigned & length) const
+{
+    length = this->offsets[column][row + 1] - this->offsets[column][row];
+    return this->bytes[column].data() + this->offsets[column][row];
+}
+
+bool RecordBatch::isNull(const unsigned & column, const unsigned & row) const
+{
+    return (this->nulls[column][row / BITES_PER_BYTE] & (0x80 >> (row % BITES_PER_BYTE))) != 0;
+}
+
+RC RecordBatch::select(const unsigned & column, const CompOp & compOp, const void * value, vector<unsigned char> & mask) const
+{
+    mask.resize((this->rows + BITES_PER_BYTE - 1) / BITES_PER_BYTE);
+    RC rc;
+    switch (this->types[column]) {
+        case TypeInt:
+            int intValue;
+            memcpy(& intValue, value, sizeof(int));
+            rc = selectInts(intColumn(column), this->rows, compOp, intValue, mask.data());
+            break;
+        case TypeReal:
+            float realValue;
+            memcpy(& realValue, value, sizeof(float));
+            rc = selectReals(realColumn(column), this->rows, compOp, realValue, mask.data());
+            break;
+        default:
+            return -1;
+    }
+    for (unsigned i = 0; i < mask.size(); i++) {
+        mask[i] &= (unsigned char) ~this->nulls[column][i];
+    }
+    return rc;
+}
+
+// scatter the projected fields of a stored record into the next row of the batch
+RC appendToBatch(RecordBatch & batch,
+                 const RID & rid,
+                 const char * record,
+                 const unsigned long & fieldLen,
+                 const vector<int> & projectedFields)
+{
+    unsigned row = batch.rows;
+    batch.rids[row] = rid;
+    for (unsigned c = 0; c < projectedFields.size(); c++) {
+        int length;
+        const char * field = attributeOf(record, fieldLen, projectedFields[c], length);
+        if (field == nullptr) {
+            batch.nulls[c][row / BITES_PER_BYTE] |= (unsigned char) (0x80 >> (row % BITES_PER_BYTE));
+        }
+        if (batch.types[c] != TypeVarChar) {
+            char * value = batch.values[c].data() + (size_t) row * sizeof(int);
+            if (field == nullptr) {
+                memset(value, 0, sizeof(int));
+            }
+            else {
+                memcpy(value, field, sizeof(int));
+            }
+            continue;
+        }
+        if (field != nullptr) {
+            batch.bytes[c].insert(batch.bytes[c].end(), field + sizeof(int), field + length);
+        }
+        batch.offsets[c][row + 1] = (unsigned) batch.bytes[c].size();
+    }
+    batch.rows++;
+    return 0;
+}
+
+// the records are read straight off each page, one page at a time
+RC RBFM_ScanIterator::getNextBatch(RecordBatch & batch)
+{
+    batch.clear(this->projectedTypes);
+    if (this->parallel) {
+        // the workers projected the records already, so field c is column c
+        vector<int> columns;
+        for (unsigned c = 0; c < this->projectedFields.size(); c++) {
+            columns.push_back(c);
+        }
+        RID rid;
+        const char * record;
+        while (batch.rows < batch.capacity && this->parallel->next(rid, record) == 0) {
+            appendToBatch(batch, rid, record, columns.size(), columns);
+        }
+        return batch.rows == 0 ? RBFM_EOF : 0;
+    }
+    RID rid;
+    const char * record;
+    while (batch.rows < batch.capacity && findNxtRecOnPage(rid, record) == 0) {
+        appendToBatch(batch, rid, record, this->recordDescriptor.size(), this->projectedFields);
+    }
+    if (batch.rows == 0) {
+        return RBFM_EOF;
+    }
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ Parallel scans
+ --------------------------------------------------------------------------------------- */
+
+// the projected fields of a stored record, as a stored record of their own
+int projectStoredRecord(char * projected,
+                        const void * record,
+                        const unsigned long & fieldLen,
+                        const vector<int> & projectedFields)
+{
+    int end = fieldLenToMetaLen(projectedFields.size());
+    for (unsigned c = 0; c < projectedFields.size(); c++) {
+        int length;
+        const char * field = attributeOf(record, fieldLen, projectedFields[c], length);
+        int fieldEnd = ATTR_NULL_FLAG;
+        if (field != nullptr) {
+            memcpy(projected + end, field, (size_t) length);
+            end += length;
+            fieldEnd = end;
+        }
+        memcpy(projected + c * sizeof(int), & fieldEnd, sizeof(int));
+    }
+    return end;
+}
+
+ParallelScan::ParallelScan(const RBFM_ScanIterator & iterator, const bool & ordered)
+: _fileHandle(iterator.fileHandle),
+  _condition(iterator.condition),
+  _fieldLen(iterator.recordDescriptor.size()),
+  _projectedFields(iterator.projectedFields),
+  _ordered(ordered),
+  _skippedPages(iterator.skippedPages)
+{
+    this->_pageCount = this->_fileHandle.getNumberOfPages();
+    this->_morselCount = (this->_pageCount + SCAN_MORSEL_PAGES - 1) / SCAN_MORSEL_PAGES;
+    // a mapping is made to cover every page once, before any worker reads through it
+    this->_fileHandle.beginSequentialRead();
+    unsigned workers = min(SCAN_WORKER_THREADS, this->_morselCount);
+    for (unsigned i = 0; i < workers; i++) {
+        this->_workers.push_back(thread(&ParallelScan::_workerLoop, this));
+    }
+}
+
+ParallelScan::~ParallelScan()
+{
+    {
+        lock_guard<mutex> lock(this->_latch);
+        this->_stopping = true;
+    }
+    this->_consumed.notify_all();
+    for (thread & worker : this->_workers) {
+        worker.join();
+    }
+    this->_fileHandle.countRead(this->_pagesRead);
+}
+
+void ParallelScan::_workerLoop()
+{
+    // a copy that tallies its reads, they go into the file's counter on the consumer's thread
+    FileHandle fileHandle = this->_fileHandle;
+    unsigned pagesRead = 0;
+    fileHandle.readTally = & pagesRead;
+    fileHandle.fixedMapping = true;
+    void * buffer = malloc(fileHandle.getPageSize());
+    while (true) {
+        unsigned morsel;
+        {
+            unique_lock<mutex> lock(this->_latch);
+            this->_consumed.wait(lock, [this] {
+                return this->_stopping || this->_nextMorsel - this->_consumedMorsels < SCAN_MORSELS_AHEAD;
+            });
+            if (this->_stopping || this->_nextMorsel >= this->_morselCount) {
+                break;
+            }
+            morsel = this->_nextMorsel++;
+        }
+        ScanMorsel out;
+        this->_scanMorsel(fileHandle, buffer, morsel, out);
+        {
+            lock_guard<mutex> lock(this->_latch);
+            this->_ready[morsel] = move(out);
+            this->_pagesRead += pagesRead;
+        }
+        pagesRead = 0;
+        this->_produced.notify_all();
+    }
+    free(buffer);
+}
+
+void ParallelScan::_scanMorsel(FileHandle & fileHandle, void * buffer, const unsigned & morsel, ScanMorsel & out)
+{
+    PageNum first = morsel * SCAN_MORSEL_PAGES;
+    PageNum last = min(first + SCAN_MORSEL_PAGES, this->_pageCount);
+    // only the run between the first and the last page the zone map leaves is read ahead
+    while (first < last && first < this->_skippedPages.size() && this->_skippedPages[first]) {
+        first++;
+    }
+    while (last > first && last - 1 < this->_skippedPages.size() && this->_skippedPages[last - 1]) {
+        last--;
+    }
+    if (first < last) {
+        fileHandle.readAhead(first, last - first);
+    }
+    for (PageNum pageNum = first; pageNum < last; pageNum++) {
+        if (pageNum < this->_skippedPages.size() && this->_skippedPages[pageNum]) {
+            continue;
+        }
+        const void * page = fileHandle.mappedPage(pageNum);
+        if (page == nullptr) {
+            if (fileHandle.readPage(pageNum, buffer) != 0) {
+                continue;
+            }
+            page = buffer;
+        }
+        RID rid;
+        rid.pageNum = pageNum;
+        SlotNum totUsedSlotsNum = getTotalUsedSlotsNum(page);
+        for (SlotNum slotNum = 0; slotNum < totUsedSlotsNum; slotNum++) {
+            rid.slotNum = slotNum;
+            if (recordDeleted(page, rid) || recordRelocated(page, rid)) {
+                continue;
+            }
+            const char * record = (const char*)page + getRecOffset(page, slotNum);
+            if (!this->_condition.test(record, this->_fieldLen)) {
+                continue;
+            }
+            // room for every projected field even if one is projected twice
+            size_t at = out.records.size();
+            out.records.resize(at + fieldLenToMetaLen(this->_projectedFields.size())
+                               + (size_t) this->_projectedFields.size() * getRecLength(page, slotNum));
+            int length = projectStoredRecord(& out.records[at], record, this->_fieldLen, this->_projectedFields);
+            out.records.resize(at + length);
+            out.rids.push_back(rid);
+            out.offsets.push_back(at);
+        }
+    }
+}
+
+RC ParallelScan::next(RID & rid, const char * & record)
+{
+    while (!this->_hasCurrent || this->_currentRow == this->_current.rids.size()) {
+        if (this->_hasCurrent) {
+            this->_hasCurrent = false;
+            {
+                lock_guard<mutex> lock(this->_latch);
+                this->_consumedMorsels++;
+            }
+            this->_consumed.notify_all();
+        }
+        unique_lock<mutex> lock(this->_latch);
+        if (this->_consumedMorsels == this->_morselCount) {
+            return -1;
+        }
+        // an ordered scan waits for the next morsel in page order, an unordered one takes any
+        this->_produced.wait(lock, [this] {
+            return this->_ordered ? this->_ready.count(this->_nextToConsume) > 0 : !this->_ready.empty();
+        });
+        auto it = this->_ordered ? this->_ready.find(this->_nextToConsume) : this->_ready.begin();
+        this->_current = move(it->second);
+        this->_ready.erase(it);
+        // the workers' reads reach the file's counter here, on the consumer's thread
+        this->_fileHandle.countRead(this->_pagesRead);
+        this->_pagesRead = 0;
+        this->_nextToConsume++;
+        this->_currentRow = 0;
+        this->_hasCurrent = true;
+    }
+    rid = this->_current.rids[this->_currentRow];
+    record = this->_current.records.data() + this->_current.offsets[this->_currentRow];
+    this->_currentRow++;
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ Reorganization
+ --------------------------------------------------------------------------------------- */
+
+unordered_map<string, RBFM_Reorganizer*> RBFM_Reorganizer::_running;
+
+// RIDs in page order, so the records copied from one page are next to each other in a map
+unsigned long long ridKeyOf(const RID & rid) {
+    return ((unsigned long long) rid.pageNum << 32) | rid.slotNum;
+}
+
+RID ridOfKey(const unsigned long long & key) {
+    RID rid;
+    rid.pageNum = (PageNum) (key >> 32);
+    rid.slotNum = (SlotNum) (key & 0xFFFFFFFF);
+    return rid;
+}
+
+RBFM_Reorganizer::~RBFM_Reorganizer()
+{
+    if (this->_active) {
+        this->close();
+    }
+}
+
+RBFM_Reorganizer * RBFM_Reorganizer::of(const string &fileName)
+{
+    if (_running.empty()) {
+        return nullptr;
+    }
+    auto it = _running.find(fileName);
+    return it == _running.end() ? nullptr : it->second;
+}
+
+RC RBFM_Reorganizer::initialize(const string &fileName, const vector<Attribute> &recordDescriptor)
+{
+    RecordBasedFileManager * rbfm = RecordBasedFileManager::instance();
+    if (this->_active || of(fileName) != nullptr || recordDescriptor.empty()) {
+        return -1;
+    }
+    if (rbfm->openFile(fileName, this->_source) != 0) {
+        return -1;
+    }
+    // a reorganization given up halfway may have left its file behind
+    string newName = fileName + REORG_FILE_SUFFIX;
+    if (rbfm->fileExists(newName)) {
+        rbfm->destroyFile(newName);
+    }
+    StorageBackend backend = dynamic_pointer_cast<MemoryPageStore>(this->_source.store) ? MemoryStorage : PosixStorage;
+    if (rbfm->createFile(newName, backend, this->_source.getPageSize()) != 0) {
+        rbfm->closeFile(this->_source);
+        return -1;
+    }
+    // the new file summarizes the same attributes, its entries are written as the records come in
+    shared_ptr<ZoneMap> zones = rbfm->zoneMapOf(this->_source);
+    if (zones) {
+        vector<string> attributeNames;
+        for (int fieldIdx : zones->fieldIdxs) {
+            attributeNames.push_back(recordDescriptor[fieldIdx].name);
+        }
+        ZoneMap::create(newName + ZONE_MAP_SUFFIX, recordDescriptor, attributeNames);
+    }
+    if (rbfm->openFile(newName, this->_target) != 0) {
+        rbfm->closeFile(this->_source);
+        rbfm->destroyFile(newName);
+        return -1;
+    }
+    this->_fileName = fileName;
+    this->_nextPage = 0;
+    this->_recopy.clear();
+    this->_copies.clear();
+    this->_beacons.clear();
+    this->_relocated.clear();
+    this->_done = false;
+    this->_active = true;
+    _running[fileName] = this;
+    return 0;
+}
+
+void RBFM_Reorganizer::pageWritten(const PageNum &pageNum)
+{
+    // pages not copied yet are copied as they are when their turn comes
+    if (pageNum < this->_nextPage) {
+        this->_recopy.insert(pageNum);
+    }
+}
+
+// every record on the page goes to the new file, every beacon is remembered
+RC RBFM_Reorganizer::_copyPage(const PageNum &pageNum)
+{
+    PageGuard page(this->_source, pageNum);
+    if (!page.valid()) {
+        return -1;
+    }
+    const char * buffer = page.data();
+    RID rid;
+    rid.pageNum = pageNum;
+    short totUsedSlotsNum = getTotalUsedSlotsNum(buffer);
+    for (rid.slotNum = 0; rid.slotNum < (SlotNum) totUsedSlotsNum; rid.slotNum++) {
+        if (recordDeleted(buffer, rid)) {
+            continue;
+        }
+        if (recordRelocated(buffer, rid)) {
+            Beacon beacon;
+            memcpy(& beacon, buffer + getRecOffset(buffer, rid.slotNum), (size_t) BEACON_SIZE);
+            this->_beacons[ridKeyOf(rid)] = decompressed(beacon);
+            continue;
+        }
+        RID newRid;
+        const char * record = buffer + getRecOffset(buffer, rid.slotNum);
+        if (relocateRecord(this->_target, record, getRecLength(buffer, rid.slotNum), newRid) != 0) {
+            return -1;
+        }
+        this->_copies[ridKeyOf(rid)] = newRid;
+    }
+    return 0;
+}
+
+// take back what an earlier _copyPage() of the page put into the new file
+RC RBFM_Reorganizer::_uncopyPage(const PageNum &pageNum)
+{
+    RID first;
+    first.pageNum = pageNum;
+    first.slotNum = 0;
+    RID next;
+    next.pageNum = pageNum + 1;
+    next.slotNum = 0;
+    auto begin = this->_copies.lower_bound(ridKeyOf(first));
+    auto end = this->_copies.lower_bound(ridKeyOf(next));
+    for (auto it = begin; it != end; it++) {
+        if (releaseRecordAt(this->_target, it->second) != 0) {
+            return -1;
+        }
+    }
+    this->_copies.erase(begin, end);
+    this->_beacons.erase(this->_beacons.lower_bound(ridKeyOf(first)), this->_beacons.lower_bound(ridKeyOf(next)));
+    return 0;
+}
+
+RC RBFM_Reorganizer::step(const unsigned &pageCount)
+{
+    if (this->_done) {
+        return 0;
+    }
+    if (!this->_active || pageCount == 0) {
+        return -1;
+    }
+    unsigned budget = pageCount;
+    while (budget > 0 && !this->_recopy.empty()) {
+        PageNum pageNum = *this->_recopy.begin();
+        this->_recopy.erase(this->_recopy.begin());
+        if (this->_uncopyPage(pageNum) != 0 || this->_copyPage(pageNum) != 0) {
+            return -1;
+        }
+        budget--;
+    }
+    // pages appended meanwhile are copied too
+    while (budget > 0 && this->_nextPage < this->_source.getNumberOfPages()) {
+        if (this->_copyPage(this->_nextPage) != 0) {
+            return -1;
+        }
+        this->_nextPage++;
+        budget--;
+    }
+    if (!this->_recopy.empty() || this->_nextPage < this->_source.getNumberOfPages()) {
+        return 0;
+    }
+    return this->_swap();
+}
+
+RC RBFM_Reorganizer::_swap()
+{
+    // a reader still on the old file keeps it, the next step tries again
+    if (this->_source.state->openCount > 1) {
+        return 0;
+    }
+    RecordBasedFileManager * rbfm = RecordBasedFileManager::instance();
+    PagedFileManager * pfm = PagedFileManager::instance();
+    string newName = this->_fileName + REORG_FILE_SUFFIX;
+    _running.erase(this->_fileName);
+    this->_active = false;
+    rbfm->closeFile(this->_source);
+    rbfm->closeFile(this->_target);
+    // the zone map goes first: once the new file is in, the old summaries would skip the wrong pages.
+    // One that can't be moved is destroyed, the table is then scanned without it
+    string zoneName = this->_fileName + ZONE_MAP_SUFFIX;
+    bool zonesMoved = false;
+    if (pfm->fileExists(newName + ZONE_MAP_SUFFIX)) {
+        zonesMoved = pfm->renameFile(newName + ZONE_MAP_SUFFIX, zoneName) == 0;
+        if (!zonesMoved) {
+            pfm->destroyFile(newName + ZONE_MAP_SUFFIX);
+            if (pfm->fileExists(zoneName)) {
+                pfm->destroyFile(zoneName);
+            }
+        }
+    }
+    if (pfm->renameFile(newName, this->_fileName) != 0) {
+        rbfm->destroyFile(newName);
+        // the old file stays, the zone map of the new one can't
+        if (zonesMoved) {
+            pfm->destroyFile(zoneName);
+        }
+        return -1;
+    }
+    // a home slot holding a beacon now leads to where the record it pointed at went
+    for (auto & beacon : this->_beacons) {
+        RID realRid = beacon.second;
+        for (unsigned hops = 0; hops < this->_beacons.size(); hops++) {
+            auto next = this->_beacons.find(ridKeyOf(realRid));
+            if (next == this->_beacons.end()) {
+                break;
+            }
+            realRid = next->second;
+        }
+        auto copy = this->_copies.find(ridKeyOf(realRid));
+        if (copy != this->_copies.end()) {
+            this->_copies[beacon.first] = copy->second;
+        }
+        this->_relocated.insert(ridKeyOf(beacon.second));
+    }
+    this->_beacons.clear();
+    this->_recopy.clear();
+    this->_done = true;
+    return 0;
+}
+
+bool RBFM_Reorganizer::done() const
+{
+    return this->_done;
+}
+
+RC RBFM_Reorganizer::movedTo(const RID &rid, RID &newRid) const
+{
+    if (!this->_done) {
+        return -1;
+    }
+    auto it = this->_copies.find(ridKeyOf(rid));
+    if (it == this->_copies.end()) {
+        return -1;
+    }
+    newRid = it->second;
+    return 0;
+}
+
+RC RBFM_Reorganizer::movedRecords(vector<pair<RID, RID> > &moves) const
+{
+    moves.clear();
+    if (!this->_done) {
+        return -1;
+    }
+    for (auto & copy : this->_copies) {
+        RID rid = ridOfKey(copy.first);
+        if (!sameRid(rid, copy.second) && this->_relocated.count(copy.first) == 0) {
+            moves.push_back(make_pair(rid, copy.second));
+        }
+    }
+    return 0;
+}
+
+RC RBFM_Reorganizer::close()
+{
+    if (!this->_active) {
+        return -1;
+    }
+    RecordBasedFileManager * rbfm = RecordBasedFileManager::instance();
+    _running.erase(this->_fileName);
+    this->_active = false;
+    rbfm->closeFile(this->_source);
+    rbfm->closeFile(this->_target);
+    return rbfm->destroyFile(this->_fileName + REORG_FILE_SUFFIX);
+}
@@ -2,7 +2,17 @@
 #define _rbfm_h_
 
 
+#include <algorithm>
+#include <memory>
+#include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
 #include "pfm.h"
+#include "kernels.h"
+#include "zonemap.h"
 #include "../Utils/utils.h"
 
 using namespace std;
@@ -16,21 +26,213 @@ using namespace std;
 //  }
 //  rbfmScanIterator.close();
 
+// A filter over any number of attributes for scan(): comparisons, IN-lists and BETWEEN,
+// combined with AND / OR / NOT. Values are laid out like the attribute in a record
+// (int, float or [int length][chars]); the buffers are read once when the scan starts.
+// A comparison on a NULL attribute is unknown, so neither it nor its negation qualifies.
+//  vector<ScanFilter> terms;
+//  terms.push_back(ScanFilter::between("age", &low, &high));
+//  terms.push_back(ScanFilter::negate(ScanFilter::in("city", cities)));
+//  rbfm->scan(fileHandle, recordDescriptor, ScanFilter::allOf(terms), attributeNames, iterator);
+typedef enum { FILTER_ALL = 0,  // every record
+    FILTER_COMPARE,
+    FILTER_IN,
+    FILTER_BETWEEN,             // low <= attr <= high
+    FILTER_AND,
+    FILTER_OR,
+    FILTER_NOT
+} FilterKind;
+
+class ScanFilter
+{
+public:
+    static ScanFilter compare(const string &attribute, const CompOp compOp, const void *value);
+    static ScanFilter in(const string &attribute, const vector<const void*> &values);
+    static ScanFilter between(const string &attribute, const void *low, const void *high);
+    static ScanFilter allOf(const vector<ScanFilter> &filters);
+    static ScanFilter anyOf(const vector<ScanFilter> &filters);
+    static ScanFilter negate(const ScanFilter &filter);
+    
+    FilterKind kind = FILTER_ALL;
+    string attribute;
+    CompOp compOp = NO_OP;
+    vector<const void*> values;
+    vector<ScanFilter> children;
+};
+
+// A ScanFilter compiled once by RBFM_ScanIterator::initialize():
+// attributes are resolved to field indexes and comparisons to functions typed for them,
+// so every record is tested on its stored bytes without name lookups, copies or switches.
+// The terms of an AND / OR are ordered by estimated cost and selectivity, cheap terms
+// that decide the outcome most often run first.
+typedef bool (*FieldTest)(const char * field, const char * value);
+
+typedef struct
+{
+    FilterKind kind;
+    int fieldIdx;
+    AttrType type;
+    CompOp compOp;                              // compare
+    FieldTest test;                             // compare, the lower bound of between
+    string value;
+    FieldTest upperTest;                        // the upper bound of between
+    string upperValue;
+    unordered_multimap<size_t, string> members; // in-list, by hash of the field bytes
+    vector<int> children;
+    double cost;                                // estimated work per record
+    double selectivity;                         // estimated fraction of records that qualify
+} ConditionNode;
+
+class CompiledCondition
+{
+public:
+    RC compile(const vector<Attribute> &recordDescriptor,
+               const ScanFilter &filter);                             // -1 if an attribute doesn't exist
+    bool test(const void * record, const unsigned long & fieldLen) const;   // record in the stored format
+    // false only if no record of a page summarized by columns (see ZoneMap) can qualify
+    bool mayMatch(const ZoneMap & zones, const vector<ZoneColumn> & columns) const;
+    
+private:
+    vector<ConditionNode> _nodes;
+    int _root = -1;                             // -1: every record qualifies
+    
+    RC _compile(const vector<Attribute> &recordDescriptor, const ScanFilter &filter, int &nodeIdx);
+    RC _compileLeaf(const vector<Attribute> &recordDescriptor, const ScanFilter &filter, ConditionNode &node);
+    int _evaluate(const int &nodeIdx, const void * record, const unsigned long & fieldLen) const;
+    bool _mayMatch(const int &nodeIdx, const ZoneMap & zones, const vector<ZoneColumn> & columns) const;
+};
+
+// Scanned records column by column, filled by RBFM_ScanIterator::getNextBatch().
+// Column c is the c-th projected attribute, row r the r-th record of the batch:
+//  int / real: intColumn(c)[r] / realColumn(c)[r], one contiguous array per column
+//  varchar:    varCharAt(c, r, length), all of a column's chars live in one buffer,
+//              row r spans bytes[c][offsets[c][r] .. offsets[c][r + 1])
+//  NULL:       isNull(c, r), nulls[c] has a bit per row, 0x80 >> (r % 8) of byte r / 8;
+//              a NULL int / real reads as 0 and a NULL varchar is empty
+// The buffers are sized once and reused by every batch, the caller owns the batch.
+class RecordBatch
+{
+public:
+    RecordBatch(const unsigned & capacity = SCAN_BATCH_ROWS);
+    
+    unsigned capacity;
+    unsigned rows = 0;
+    vector<AttrType> types;
+    vector<RID> rids;
+    vector<vector<char>> values;            // int / real columns, 4 bytes a row
+    vector<vector<unsigned>> offsets;       // varchar columns, rows + 1 entries
+    vector<vector<char>> bytes;
+    vector<vector<unsigned char>> nulls;
+    
+    const int * intColumn(const unsigned & column) const;
+    const float * realColumn(const unsigned & column) const;
+    const char * varCharAt(const unsigned & column, const unsigned & row, unsigned & length) const;
+    bool isNull(const unsigned & column, const unsigned & row) const;
+    // rows of an int / real column that satisfy "column compOp value" as a mask laid out like nulls[column];
+    // runs the SIMD kernels (see kernels.h), NULL rows never qualify, -1 for a varchar column
+    RC select(const unsigned & column, const CompOp & compOp, const void * value, vector<unsigned char> & mask) const;
+    
+    RC clear(const vector<AttrType> & types);  // empty, laid out for columns of these types
+};
+
+// How a scan visits the pages of a file
+typedef enum {
+    SerialScan = 0,             // in page order, on the calling thread
+    OrderedParallelScan,        // morsels of pages on worker threads, records still come in page order
+    UnorderedParallelScan       // morsels on worker threads, records come as soon as a morsel is done
+} ScanMode;
+
+// Qualifying records of one morsel, projected and kept in the stored format back to back
+typedef struct
+{
+    string records;
+    vector<RID> rids;
+    vector<size_t> offsets;     // where each record starts in records
+} ScanMorsel;
+
+class RBFM_ScanIterator;
+
+// The workers of a parallel scan. The pages the file has when the scan starts are cut into
+// morsels of SCAN_MORSEL_PAGES; each worker takes the next morsel, tests the condition and
+// projects the records on its own copy of the FileHandle, then hands the morsel over.
+// At most SCAN_MORSELS_AHEAD morsels are out at a time, so a slow consumer holds the workers back.
+// A worker's page reads reach the file's read counter when its morsel is consumed, on the consumer's thread,
+// and a mapped file is mapped again once before the workers start, never while they read.
+class ParallelScan
+{
+public:
+    ParallelScan(const RBFM_ScanIterator & iterator, const bool & ordered);   // starts the workers
+    ~ParallelScan();                                                        // stops and joins them
+    
+    RC next(RID & rid, const char * & record);     // the next projected record (stored format), -1 at the end
+    
+private:
+    FileHandle _fileHandle;
+    CompiledCondition _condition;
+    unsigned long _fieldLen;
+    vector<int> _projectedFields;
+    bool _ordered;
+    vector<bool> _skippedPages;
+    unsigned _morselCount;
+    PageNum _pageCount;
+    
+    mutex _latch;
+    condition_variable _produced;
+    condition_variable _consumed;
+    unsigned _nextMorsel = 0;               // the next one a worker takes
+    unsigned _consumedMorsels = 0;
+    unsigned _nextToConsume = 0;            // ordered scans hand morsels out in this order
+    map<unsigned, ScanMorsel> _ready;       // done but not consumed yet
+    unsigned _pagesRead = 0;                // by the workers, not yet added to the file's counter
+    bool _stopping = false;
+    vector<thread> _workers;
+    
+    // the morsel being consumed, only touched by the consumer
+    ScanMorsel _current;
+    size_t _currentRow = 0;
+    bool _hasCurrent = false;
+    
+    void _workerLoop();
+    void _scanMorsel(FileHandle & fileHandle, void * buffer, const unsigned & morsel, ScanMorsel & out);
+};
+
 class RBFM_ScanIterator {
 public:
     // declare public variables global to this class
     FileHandle fileHandle;
     vector<Attribute> recordDescriptor;
     string conditionAttribute;
-    CompOp compOp;
-    const void * value;
+    CompOp compOp = NO_OP;
+    const void * value = nullptr;
     vector<string> attributeNames;
     
     unordered_map<string, int> attrMap;
+    vector<int> projectedFields;                // field index of each projected attribute
+    vector<AttrType> projectedTypes;
+    vector<Attribute> projectedDescriptor;
+    CompiledCondition condition;
     RID rid;
     PageNum curtPageNum;
     SlotNum curtSlotNum;
     
+    // read-ahead: pages before readAheadUntil have been asked for already,
+    // the window doubles on every run up to maxReadAhead pages
+    unsigned maxReadAhead = SCAN_READ_AHEAD_PAGES;
+    unsigned readAheadWindow = SCAN_READ_AHEAD_START;
+    PageNum readAheadUntil = 0;
+    
+    // set up by initialize() and reused for the whole scan, so getNextRecord() allocates nothing:
+    // the page being scanned is copied in once unless the file is mapped
+    vector<char> pageFrame;
+    PageNum framedPage = 0;
+    bool frameValid = false;
+    
+    // pages the zone map of the file rules out for the condition, they are never read
+    vector<bool> skippedPages;
+    
+    // set for the parallel modes, shared by copies of the iterator
+    shared_ptr<ParallelScan> parallel;
+    
     RBFM_ScanIterator() {};
     ~RBFM_ScanIterator() {};
     
@@ -38,11 +240,23 @@ public:
     // a satisfying record needs to be fetched from the file.
     // "data" follows the same format as RecordBasedFileManager::insertRecord().
     RC getNextRecord(RID &rid, void *data);
+    // Up to batch.capacity satisfying records at once, see RecordBatch; RBFM_EOF once none are left.
+    RC getNextBatch(RecordBatch &batch);
+    // Let go of the file; the handle stays open, closing it is up to whoever opened it.
+    // Calling it again is harmless, getNextRecord() returns RBFM_EOF from then on.
     RC close() {
-        // TODO : fclose(fileHandle.pFile);
-        return -1;
+        // the workers of a parallel scan stop once no copy of the iterator uses them
+        parallel.reset();
+        // the copy of the handle shares the store and the header, dropping it doesn't close the file
+        fileHandle = FileHandle();
+        vector<char>().swap(pageFrame);
+        frameValid = false;
+        skippedPages.clear();
+        return 0;
     };
     
+    RC setReadAhead(const unsigned &pages);     // largest read-ahead run in pages, 0 turns it off
+    
     RC initialize(FileHandle &fileHandle,
                   const vector<Attribute> &recordDescriptor,
                   const string &conditionAttribute,
@@ -52,13 +266,74 @@ public:
                   // used in the comparison
                   const vector<string> &attributeNames);
                   // a list of projected attributes
+    RC initialize(FileHandle &fileHandle,
+                  const vector<Attribute> &recordDescriptor,
+                  const ScanFilter &filter,
+                  const vector<string> &attributeNames,
+                  const ScanMode mode = SerialScan);
 private:
-    RC loadNxtRecOnPage(RID &rid, void * data, const vector<Attribute> & recordDescriptor);
-    RC loadNxtRecOnSlot(RID &rid, void * data, const void * buffer, const vector<Attribute> & recordDescriptor);
+    RC findNxtRecOnPage(RID &rid, const char * &record);
+    RC findNxtRecOnSlot(RID &rid, const void * buffer, const char * &record);
+    const void * pageAt(const PageNum &pageNum);
+    void readAheadFrom(const PageNum &pageNum);
+    RC skipPagesByZones();
     
 };
 
 
+// Rewrites a record file densely into fileName + REORG_FILE_SUFFIX a few pages at a time, then puts the new file
+// in the place of the old one. The pages of the old file are copied in order: every record goes into the new file
+// by first fit (a relocated one from the page it lives on), beacons, holes and empty pages stay behind.
+// Readers and writers keep using the old file until the swap; a copied page written meanwhile is copied again.
+// The swap waits until no other handle has the old file open. RIDs change, see movedTo().
+//  RBFM_Reorganizer reorganizer;
+//  rbfm.reorganize(fileName, recordDescriptor, reorganizer);
+//  while (reorganizer.step() == 0 && !reorganizer.done()) {
+//    let the readers in;
+//  }
+class RBFM_Reorganizer {
+public:
+    RBFM_Reorganizer() {};
+    ~RBFM_Reorganizer();        // gives up unless the new file is in place
+    
+    RC initialize(const string &fileName, const vector<Attribute> &recordDescriptor);
+    // Copy up to pageCount pages of the old file, pages written since they were copied first,
+    // and swap the files once all are copied
+    RC step(const unsigned &pageCount = REORG_STEP_PAGES);
+    bool done() const;          // the new file is in place
+    // Where the record the old file had under rid is in the new one, -1 if it had none.
+    // Valid once done(); a relocated record can be asked for by its home or by where it lived.
+    RC movedTo(const RID &rid, RID &newRid) const;
+    RC movedRecords(vector<pair<RID, RID> > &moves) const;     // every (home, new) pair that differs
+    RC close();                 // give up, the old file stays as it is
+    
+    // called for every page of the old file that is written while the reorganization runs
+    void pageWritten(const PageNum &pageNum);
+    static RBFM_Reorganizer * of(const string &fileName);      // nullptr if the file isn't being reorganized
+    
+private:
+    string _fileName;
+    FileHandle _source;
+    FileHandle _target;
+    bool _active = false;
+    bool _done = false;
+    PageNum _nextPage = 0;                  // pages before it have been copied
+    set<PageNum> _recopy;                   // copied pages written since
+    map<unsigned long long, RID> _copies;   // RID in the old file -> RID in the new one, of every record copied
+    map<unsigned long long, RID> _beacons;  // RID of a beacon in the old file -> RID it points at
+    set<unsigned long long> _relocated;     // RIDs in the old file a beacon pointed at, none of them a home
+    
+    static unordered_map<string, RBFM_Reorganizer*> _running;
+    
+    RC _copyPage(const PageNum &pageNum);
+    RC _uncopyPage(const PageNum &pageNum);
+    RC _swap();
+    
+    RBFM_Reorganizer(const RBFM_Reorganizer &);
+    RBFM_Reorganizer & operator = (const RBFM_Reorganizer &);
+};
+
+
 class RecordBasedFileManager
 {
 public:
@@ -66,9 +341,13 @@ public:
     
     RC createFile(const string &fileName);
     
+    RC createFile(const string &fileName, const StorageBackend backend, const unsigned pageSize = 0);
+    
     RC destroyFile(const string &fileName);
     
-    RC openFile(const string &fileName, FileHandle &fileHandle);
+    bool fileExists(const string &fileName);
+    
+    RC openFile(const string &fileName, FileHandle &fileHandle, const FileAccessMode accessMode = ReadWrite);
     
     RC closeFile(FileHandle &fileHandle);
     
@@ -93,6 +372,17 @@ public:
                     const void *data,
                     RID &rid);
     
+    // Insert many records of the same format at once, rids[i] is where data[i] went.
+    // Every page that takes records is written once, new pages are appended in runs.
+    RC insertRecords(FileHandle &fileHandle,
+                     const vector<Attribute> &recordDescriptor,
+                     const vector<const void *> &data,
+                     vector<RID> &rids);
+    
+    // The longest record in insertRecord() format, null bytes included, that fits on an empty page of the file;
+    // a longer one can't be inserted.
+    unsigned maxRecordLength(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor);
+    
     RC readRecord(FileHandle &fileHandle,
                   const vector<Attribute> &recordDescriptor,
                   const RID &rid,
@@ -124,9 +414,32 @@ public:
             const vector<string> &attributeNames, // a list of projected attributes
             RBFM_ScanIterator &rbfm_ScanIterator);
     
+    // Same, with a filter over any number of attributes, optionally on worker threads (see ScanMode)
+    RC scan(FileHandle &fileHandle,
+            const vector<Attribute> &recordDescriptor,
+            const ScanFilter &filter,
+            const vector<string> &attributeNames,
+            RBFM_ScanIterator &rbfm_ScanIterator,
+            const ScanMode mode = SerialScan);
+    
+    // Keep a zone map of some attributes of the file (see ZoneMap), built from the pages it has now
+    // and kept up to date by every insert, update and delete; scans then skip the pages it rules out.
+    // -1 if the file has one already or an attribute doesn't exist.
+    RC createZoneMap(FileHandle &fileHandle,
+                     const vector<Attribute> &recordDescriptor,
+                     const vector<string> &attributeNames);
+    RC destroyZoneMap(FileHandle &fileHandle);
+    shared_ptr<ZoneMap> zoneMapOf(const FileHandle &fileHandle);     // nullptr if the file has none
+    
+    // Start rewriting the file densely into a new one that takes its place (see RBFM_Reorganizer).
+    // -1 if the file is being reorganized already.
+    RC reorganize(const string &fileName,
+                  const vector<Attribute> &recordDescriptor,
+                  RBFM_Reorganizer &reorganizer);
+    
     void * decodeMetaFrom(const void* data,
                           const vector<Attribute> & recordDescriptor,
-                          short & recordLen);
+                          int & recordLen);
     
 //    RC encodeMetaInto(void * data,
 //                      const void * record,
@@ -141,6 +454,7 @@ private:
     
     PagedFileManager * _pfm;
     UtilsManager * _utils;
+    unordered_map<string, shared_ptr<ZoneMap> > _zoneMaps;     // fileName -> zone map of a file that is open
 
 };
 
@@ -0,0 +1,216 @@
+#include "zonemap.h"
+
+// the page listing the attributes is [fieldCount][columns]([fieldIdx][type]) x columns
+const unsigned ZONE_SPEC_PAGE = 0;
+// an entry is [state] followed by a ZoneColumn per attribute
+const unsigned ZONE_ENTRY_HEADER = sizeof(unsigned short);
+
+
+/* ---------------------------------------------------------------------------------------
+ Keys
+ --------------------------------------------------------------------------------------- */
+
+RC zoneKeyOf(const AttrType & type, const char * bytes, const unsigned & length, char * key)
+{
+    memset(key, 0, ZONE_KEY_SIZE);
+    if (type == TypeVarChar) {
+        memcpy(key, bytes, min(length, ZONE_KEY_SIZE));
+    }
+    else {
+        memcpy(key, bytes, sizeof(int));
+    }
+    return 0;
+}
+
+int compareZoneKeys(const AttrType & type, const char * left, const char * right)
+{
+    switch (type) {
+        case TypeInt: {
+            int l, r;
+            memcpy(& l, left, sizeof(int));
+            memcpy(& r, right, sizeof(int));
+            return l < r ? -1 : (l > r ? 1 : 0);
+        }
+        case TypeReal: {
+            float l, r;
+            memcpy(& l, left, sizeof(float));
+            memcpy(& r, right, sizeof(float));
+            return l < r ? -1 : (l > r ? 1 : 0);
+        }
+        default:
+            // the zero padding sorts a shorter string first, like the varchar comparison
+            return memcmp(left, right, ZONE_KEY_SIZE);
+    }
+}
+
+bool zoneMayHold(const AttrType & type, const ZoneColumn & column, const CompOp & compOp, const char * key)
+{
+    if (column.values == ZONE_UNBOUNDED || compOp == NO_OP) {
+        return true;
+    }
+    // a comparison with NULL never holds
+    if (column.values == 0) {
+        return false;
+    }
+    if (type == TypeReal) {
+        float real;
+        memcpy(& real, key, sizeof(float));
+        if (real != real) {
+            return true;
+        }
+    }
+    int low = compareZoneKeys(type, column.min, key);
+    int high = compareZoneKeys(type, column.max, key);
+    // equal varchar keys may stand for different strings, so they never rule anything out
+    bool exact = type != TypeVarChar;
+    switch (compOp) {
+        case EQ_OP:
+            return low <= 0 && high >= 0;
+        case LT_OP:
+            return exact ? low < 0 : low <= 0;
+        case LE_OP:
+            return low <= 0;
+        case GT_OP:
+            return exact ? high > 0 : high >= 0;
+        case GE_OP:
+            return high >= 0;
+        case NE_OP:
+            return !exact || low != 0 || high != 0;
+        default:
+            return true;
+    }
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ Zone map file
+ --------------------------------------------------------------------------------------- */
+
+RC ZoneMap::create(const string & fileName,
+                   const vector<Attribute> & recordDescriptor,
+                   const vector<string> & attributeNames)
+{
+    if (attributeNames.empty() || attributeNames.size() > ZONE_MAX_COLUMNS) {
+        return -1;
+    }
+    vector<int> fieldIdxs;
+    for (const string & name : attributeNames) {
+        int fieldIdx = -1;
+        for (unsigned i = 0; i < recordDescriptor.size(); i++) {
+            if (recordDescriptor[i].name == name) {
+                fieldIdx = i;
+                break;
+            }
+        }
+        if (fieldIdx == -1 || find(fieldIdxs.begin(), fieldIdxs.end(), fieldIdx) != fieldIdxs.end()) {
+            return -1;
+        }
+        fieldIdxs.push_back(fieldIdx);
+    }
+
+    PagedFileManager * pfm = PagedFileManager::instance();
+    if (pfm->createFile(fileName) != 0) {
+        return -1;
+    }
+    FileHandle fileHandle;
+    if (pfm->openFile(fileName, fileHandle) != 0) {
+        return -1;
+    }
+    vector<char> spec(fileHandle.getPageSize(), 0);
+    unsigned header[2] = {(unsigned) recordDescriptor.size(), (unsigned) fieldIdxs.size()};
+    memcpy(spec.data(), header, sizeof(header));
+    for (unsigned c = 0; c < fieldIdxs.size(); c++) {
+        int column[2] = {fieldIdxs[c], (int) recordDescriptor[fieldIdxs[c]].type};
+        memcpy(spec.data() + sizeof(header) + c * sizeof(column), column, sizeof(column));
+    }
+    RC rc = fileHandle.appendPage(spec.data());
+    pfm->closeFile(fileHandle);
+    return rc;
+}
+
+RC ZoneMap::open(const string & fileName)
+{
+    if (PagedFileManager::instance()->openFile(fileName, this->_fileHandle) != 0) {
+        return -1;
+    }
+    PageGuard spec(this->_fileHandle, ZONE_SPEC_PAGE);
+    if (!spec.valid()) {
+        this->close();
+        return -1;
+    }
+    unsigned header[2];
+    memcpy(header, spec.data(), sizeof(header));
+    this->fieldCount = header[0];
+    this->fieldIdxs.clear();
+    this->types.clear();
+    for (unsigned c = 0; c < header[1]; c++) {
+        int column[2];
+        memcpy(column, spec.data() + sizeof(header) + c * sizeof(column), sizeof(column));
+        this->fieldIdxs.push_back(column[0]);
+        this->types.push_back((AttrType) column[1]);
+    }
+    this->_entrySize = ZONE_ENTRY_HEADER + (unsigned) this->fieldIdxs.size() * sizeof(ZoneColumn);
+    this->_entriesPerPage = this->_fileHandle.getPageSize() / this->_entrySize;
+    return 0;
+}
+
+RC ZoneMap::close()
+{
+    return PagedFileManager::instance()->closeFile(this->_fileHandle);
+}
+
+int ZoneMap::columnOf(const int & fieldIdx) const
+{
+    for (unsigned c = 0; c < this->fieldIdxs.size(); c++) {
+        if (this->fieldIdxs[c] == fieldIdx) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+RC ZoneMap::put(const PageNum & pageNum, const vector<ZoneColumn> & columns)
+{
+    PageNum entryPage = ZONE_SPEC_PAGE + 1 + pageNum / this->_entriesPerPage;
+    if (this->_fileHandle.getNumberOfPages() <= entryPage) {
+        // pages without an entry yet read as ZONE_UNKNOWN
+        vector<char> empty(this->_fileHandle.getPageSize(), 0);
+        while (this->_fileHandle.getNumberOfPages() <= entryPage) {
+            if (this->_fileHandle.appendPage(empty.data()) != 0) {
+                return -1;
+            }
+        }
+    }
+    PageGuard page(this->_fileHandle, entryPage);
+    if (!page.valid()) {
+        return -1;
+    }
+    char * entry = page.data() + (pageNum % this->_entriesPerPage) * this->_entrySize;
+    memcpy(entry, & ZONE_KNOWN, ZONE_ENTRY_HEADER);
+    memcpy(entry + ZONE_ENTRY_HEADER, columns.data(), columns.size() * sizeof(ZoneColumn));
+    page.markDirty();
+    return 0;
+}
+
+RC ZoneMap::get(const PageNum & pageNum, vector<ZoneColumn> & columns, bool & known)
+{
+    known = false;
+    PageNum entryPage = ZONE_SPEC_PAGE + 1 + pageNum / this->_entriesPerPage;
+    if (this->_fileHandle.getNumberOfPages() <= entryPage) {
+        return 0;
+    }
+    PageGuard page(this->_fileHandle, entryPage);
+    if (!page.valid()) {
+        return -1;
+    }
+    const char * entry = page.data() + (pageNum % this->_entriesPerPage) * this->_entrySize;
+    unsigned short state;
+    memcpy(& state, entry, ZONE_ENTRY_HEADER);
+    if (state != ZONE_KNOWN) {
+        return 0;
+    }
+    columns.resize(this->fieldIdxs.size());
+    memcpy(columns.data(), entry + ZONE_ENTRY_HEADER, columns.size() * sizeof(ZoneColumn));
+    known = true;
+    return 0;
+}
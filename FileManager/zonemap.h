@@ -0,0 +1,57 @@
+#ifndef _zonemap_h_
+#define _zonemap_h_
+
+#include <algorithm>
+
+#include "pfm.h"
+#include "../Utils/utils.h"
+
+using namespace std;
+
+// Summary of one attribute over the records of one page.
+// Keys order like the values: ints and reals are kept as they are,
+// a varchar by its first ZONE_KEY_SIZE chars padded with zeros, so two keys only tell
+// which string is smaller when they differ.
+typedef struct
+{
+    char min[ZONE_KEY_SIZE];
+    char max[ZONE_KEY_SIZE];
+    unsigned short values;      // non-NULL values, min and max mean nothing while it is 0; ZONE_UNBOUNDED
+    unsigned short nulls;
+} ZoneColumn;
+
+RC zoneKeyOf(const AttrType & type, const char * bytes, const unsigned & length, char * key);  // a varchar without its length
+int compareZoneKeys(const AttrType & type, const char * left, const char * right);
+// false only if no value summarized by column can satisfy "value compOp key"
+bool zoneMayHold(const AttrType & type, const ZoneColumn & column, const CompOp & compOp, const char * key);
+
+// Per-page min / max / NULL count of some attributes of a record file, kept next to it in fileName + ZONE_MAP_SUFFIX.
+// Logical page 0 lists the attributes, the pages after it have an entry for every data page:
+//  [state][ZoneColumn] x attributes
+// A data page whose entry is ZONE_UNKNOWN is never skipped. Like the free-space map,
+// the entries go through the buffer pool and reach the file when it is closed.
+class ZoneMap
+{
+public:
+    static RC create(const string & fileName,
+                     const vector<Attribute> & recordDescriptor,
+                     const vector<string> & attributeNames);      // -1 for an unknown or a repeated attribute
+
+    RC open(const string & fileName);
+    RC close();
+
+    unsigned fieldCount = 0;            // attributes of the records
+    vector<int> fieldIdxs;              // the summarized ones
+    vector<AttrType> types;
+
+    int columnOf(const int & fieldIdx) const;      // -1 if the attribute isn't summarized
+    RC put(const PageNum & pageNum, const vector<ZoneColumn> & columns);
+    RC get(const PageNum & pageNum, vector<ZoneColumn> & columns, bool & known);
+
+private:
+    FileHandle _fileHandle;
+    unsigned _entrySize = 0;
+    unsigned _entriesPerPage = 0;
+};
+
+#endif /* zonemap_h */
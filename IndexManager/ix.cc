@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "ix.h"
 
 /*
@@ -34,49 +36,40 @@ RC IndexManager::destroyFile(const string &fileName)
     return _pfm->destroyFile(fileName);
 }
 
-RC IndexManager::openFile(const string &fileName, IXFileHandle & ixFileHandle)
+RC IndexManager::openFile(const string &fileName, IXFileHandle & ixFileHandle, const FileAccessMode accessMode)
 {
-    
-    if (!_utils->fileExists(fileName)) {
+    // an IXFileHandle is a FileHandle, so the index shares the buffer pool with the tables
+    if (_pfm->openFile(fileName, ixFileHandle, accessMode) != 0) {
         return -1;
     }
-    if (ixFileHandle.pFile != nullptr) {
-        return -1;
+    // the root page number is kept in the file header, an empty tree has none
+    PageNum rootPage = ixFileHandle.getIndexRoot();
+    if (rootPage == NULL_PAGE) {
+        rootptr = nullptr;
+        return 0;
     }
-    // read binary and update
-    ixFileHandle.pFile = fopen(fileName.c_str(), "rb+");
-    ixFileHandle.fileName = fileName;
-    
-    if (ixFileHandle.pFile == nullptr) {
+    void * buffer = malloc(ixFileHandle.getPageSize());
+    if (ixFileHandle.readPage(rootPage, buffer) != 0) {
+        free(buffer);
+        _pfm->closeFile(ixFileHandle);
         return -1;
     }
-    
-    // read persistent counters from disk
-    _utils->readFileStatsFrom(fileName,
-                              ixFileHandle.readPageCounter,
-                              ixFileHandle.writePageCounter,
-                              ixFileHandle.appendPageCounter);
+    root = IndexNode(buffer, ixFileHandle.getPageSize());
+    root.initialize();
+    root.setThisPageNum(rootPage);
+    free(buffer);
+    rootptr = & root;
     return 0;
 }
 
 RC IndexManager::closeFile(IXFileHandle & ixFileHandle)
 {
-    if (ixFileHandle.pFile == NULL) {
-        // file wasn't opened.
-        return -1;
-    }
-    _utils->writeFileStatsTo(ixFileHandle.fileName,
-                             ixFileHandle.readPageCounter,
-                             ixFileHandle.writePageCounter,
-                             ixFileHandle.appendPageCounter);
-    
-    fclose(ixFileHandle.pFile);
-    return 0;
+    return _pfm->closeFile(ixFileHandle);
 }
 
 bool IndexManager::_validIxFileHandle(const IXFileHandle & ixFileHandle) const
 {
-    if (_utils->fileExists(ixFileHandle.fileName) && ixFileHandle.pFile != nullptr) {
+    if (_pfm->fileExists(ixFileHandle.fileName) && ixFileHandle.store != nullptr) {
         return true;
     }
     else {return false;}
@@ -87,10 +80,11 @@ bool IndexManager::_validIxFileHandle(const IXFileHandle & ixFileHandle) const
 
 RC IndexManager::_createNewNode(const NodeType & nodeType,
                                 const AttrType & keyType,
+                                const unsigned & pageSize,
                                 IndexNode* &newNode)
 {
-    void * buffer = malloc(PAGE_SIZE);
-    newNode = new IndexNode(buffer); // memcpy of the buffer
+    void * buffer = malloc(pageSize);
+    newNode = new IndexNode(buffer, pageSize); // memcpy of the buffer
     free(buffer);
     newNode->initializeEmptyNode();
     newNode->setKeyType(keyType);
@@ -103,10 +97,11 @@ RC IndexManager::_createNewNode(const NodeType & nodeType,
 
 RC IndexManager::_initializeBplusRoot(const NodeType & nodeType,
                                       const AttrType & keyType,
+                                      const unsigned & pageSize,
                                       IndexNode & root)
 {
     IndexNode* rootptr = nullptr;
-    _createNewNode(nodeType, keyType, rootptr);
+    _createNewNode(nodeType, keyType, pageSize, rootptr);
     root = *rootptr;
     return 0;
 }
@@ -254,10 +249,10 @@ RC IndexManager::_insertIntoLeaf(IndexNode & leaf,
     // initialized with .next being nullptr
     LeafTuple inserted = LeafTuple(key, keyType, rid);
     
-    short freeSpaceAmount = leaf.getFreeSpaceAmount(); // curt space
+    int freeSpaceAmount = leaf.getFreeSpaceAmount(); // curt space
     
     // EMPTY PAGE
-    if (freeSpaceAmount == IDX_INFO_LEFT_BOUND_OFS) {
+    if (freeSpaceAmount == leaf.getInfoLeftBound()) {
         leaf.rollinToBuffer(& inserted);
         
         ixFileHandle.writePage(leaf.getThisPageNum(), leaf.getBufferPtr());
@@ -283,12 +278,14 @@ RC IndexManager::_insertIntoLeaf(IndexNode & leaf,
 //    _printLeafTupleList(second, keyType);
     
     IndexNode* sibling;
-    _createNewNode(Leaf, keyType, sibling);
+    _createNewNode(Leaf, keyType, ixFileHandle.getPageSize(), sibling);
     leaf.rollinToBuffer(first);
     sibling->rollinToBuffer(second);
     
     PageNum newPageNum = ixFileHandle.getNumberOfPages();
     sibling->setThisPageNum(newPageNum);
+    // the sibling goes in between the leaf and the one that followed it
+    sibling->setNextPageNum(leaf.getNextPageNum());
     leaf.setNextPageNum(newPageNum);
     
     ixFileHandle.writePage(leaf.getThisPageNum(), leaf.getBufferPtr());
@@ -325,9 +322,9 @@ RC IndexManager::_insertIntoBplusTree(IndexNode & root,
         PageNum nextPage;
         root.linearSearchBranchTupleForChild(key, keyType, nextPage);
         
-        void * buffer = malloc(PAGE_SIZE);
+        void * buffer = malloc(ixFileHandle.getPageSize());
         ixFileHandle.readPage(nextPage, buffer);
-        IndexNode node = IndexNode(buffer);
+        IndexNode node = IndexNode(buffer, ixFileHandle.getPageSize());
         node.initialize();
         
         _insertIntoBplusTree(node,
@@ -343,7 +340,7 @@ RC IndexManager::_insertIntoBplusTree(IndexNode & root,
                                                 node.getThisPageNum(),
                                                 newChildPtr->getThisPageNum());
             // get current free space amount
-            short freeSpaceAmount = root.getFreeSpaceAmount();
+            int freeSpaceAmount = root.getFreeSpaceAmount();
             // insert bubUpBtup into branch tuple linkedlist
             BranchTuple* first;
             _insertIntoBranchTupleList(root, bubUpBtup, first);
@@ -359,7 +356,7 @@ RC IndexManager::_insertIntoBplusTree(IndexNode & root,
                 BranchTuple* second;
                 _splitBranchTupleList(first, second);
                 IndexNode* sibling;
-                _createNewNode(Branch, keyType, sibling);
+                _createNewNode(Branch, keyType, ixFileHandle.getPageSize(), sibling);
                 root.rollinToBuffer(first);
                 sibling->rollinToBuffer(second);
                 
@@ -389,10 +386,11 @@ RC IndexManager::insertEntry(IXFileHandle &ixFileHandle,
     if (rootptr == nullptr) {
         assert(ixFileHandle.getNumberOfPages() == 0 &&
                "IndexManager::insertEntry() : ERROR");
-        _initializeBplusRoot(Leaf, attribute.type, root);
+        _initializeBplusRoot(Leaf, attribute.type, ixFileHandle.getPageSize(), root);
         ixFileHandle.appendPage(root.getBufferPtr());
         root.setThisPageNum(ixFileHandle.getNumberOfPages() - 1);
         rootptr = & root;
+        ixFileHandle.setIndexRoot(root.getThisPageNum());
     }
     IndexNode * newChildPtr = nullptr;
     _insertIntoBplusTree(root,
@@ -406,7 +404,7 @@ RC IndexManager::insertEntry(IXFileHandle &ixFileHandle,
     if (newChildPtr != nullptr) {
         // a new root is needed, expand in height
         IndexNode newRoot;
-        _initializeBplusRoot(Branch, attribute.type, newRoot);
+        _initializeBplusRoot(Branch, attribute.type, ixFileHandle.getPageSize(), newRoot);
         BranchTuple bubUpBtup = BranchTuple(newChildPtr->getBufferPtr(),
                                             newChildPtr->getKeyType(),
                                             root.getThisPageNum(),
@@ -418,10 +416,168 @@ RC IndexManager::insertEntry(IXFileHandle &ixFileHandle,
         ixFileHandle.appendPage(newRoot.getBufferPtr());
         root = newRoot;
         rootptr = & root;
+        ixFileHandle.setIndexRoot(root.getThisPageNum());
     }
     return 0;
 }
 
+/*
+ * --------------------------------------------------------------------
+ */
+
+// leaves are filled as far as insertEntry() would fill them before splitting,
+// nodes gets the page of every leaf and firstKeys the smallest key on it
+RC IndexManager::_buildLeafLevel(IXFileHandle & ixFileHandle,
+                                 const AttrType & keyType,
+                                 vector<LeafTuple> & tuples,
+                                 vector<PageNum> & nodes,
+                                 vector<const void *> & firstKeys)
+{
+    IndexNode* leaf;
+    _createNewNode(Leaf, keyType, ixFileHandle.getPageSize(), leaf);
+    size_t first = 0;
+    while (first < tuples.size()) {
+        size_t end = first + 1;
+        int used = tuples[first].getLength();
+        while (end < tuples.size() && used + tuples[end].getLength() <= leaf->getInfoLeftBound()) {
+            used += tuples[end].getLength();
+            tuples[end - 1].next = & tuples[end];
+            end++;
+        }
+        tuples[end - 1].next = nullptr;
+        
+        PageNum pageNum = ixFileHandle.getNumberOfPages();
+        leaf->rollinToBuffer(& tuples[first]);
+        leaf->setThisPageNum(pageNum);
+        leaf->setNextPageNum(end < tuples.size() ? pageNum + 1 : NO_MORE_PAGE);
+        if (ixFileHandle.appendPage(leaf->getBufferPtr()) != 0) {
+            delete leaf;
+            return -1;
+        }
+        nodes.push_back(pageNum);
+        firstKeys.push_back(tuples[first].getKeyPtr());
+        first = end;
+    }
+    delete leaf;
+    return 0;
+}
+
+// one level of branches over nodes, which are replaced by the branches.
+// A branch over children [first, end) has a tuple for each child but the first,
+// keyed like insertEntry() keys them: by the smallest key under the child on its right.
+RC IndexManager::_buildBranchLevel(IXFileHandle & ixFileHandle,
+                                   const AttrType & keyType,
+                                   vector<PageNum> & nodes,
+                                   vector<const void *> & firstKeys)
+{
+    IndexNode* branch;
+    _createNewNode(Branch, keyType, ixFileHandle.getPageSize(), branch);
+    vector<PageNum> parents;
+    vector<const void *> parentKeys;
+    size_t first = 0;
+    while (first < nodes.size()) {
+        size_t end = first + 1;
+        int used = 0;
+        while (end < nodes.size()) {
+            int length = BranchTuple(firstKeys[end], keyType, 0, 0).getLength();
+            if (used + length >= branch->getInfoLeftBound()) {
+                break;
+            }
+            used += length;
+            end++;
+        }
+        // a branch needs two children, the last one must not be left with only one
+        if (end + 1 == nodes.size() && end - first > 2) {
+            end--;
+        }
+        vector<BranchTuple> tuples;
+        for (size_t child = first + 1; child < end; child++) {
+            tuples.push_back(BranchTuple(firstKeys[child], keyType, nodes[child - 1], nodes[child]));
+        }
+        for (size_t i = 0; i + 1 < tuples.size(); i++) {
+            tuples[i].next = & tuples[i + 1];
+        }
+        
+        PageNum pageNum = ixFileHandle.getNumberOfPages();
+        branch->clearAll();
+        branch->rollinToBuffer(tuples.empty() ? nullptr : & tuples[0]);
+        branch->setThisPageNum(pageNum);
+        branch->setNextPageNum(end < nodes.size() ? pageNum + 1 : NO_MORE_PAGE);
+        if (ixFileHandle.appendPage(branch->getBufferPtr()) != 0) {
+            delete branch;
+            return -1;
+        }
+        parents.push_back(pageNum);
+        parentKeys.push_back(firstKeys[first]);
+        first = end;
+    }
+    delete branch;
+    nodes.swap(parents);
+    firstKeys.swap(parentKeys);
+    return 0;
+}
+
+RC IndexManager::insertEntries(IXFileHandle &ixFileHandle,
+                               const Attribute &attribute,
+                               const vector<const void *> &keys,
+                               const vector<RID> &rids)
+{
+    if (!_validIxFileHandle(ixFileHandle) || keys.size() != rids.size()) {
+        return -1;
+    }
+    vector<LeafTuple> given;
+    vector<size_t> order;
+    given.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        given.push_back(LeafTuple(keys[i], attribute.type, rids[i]));
+        order.push_back(i);
+    }
+    // equal keys stay in the order they were given
+    stable_sort(order.begin(), order.end(), [&given](const size_t & left, const size_t & right) {
+        return given[left] < given[right];
+    });
+    vector<LeafTuple> tuples;
+    tuples.reserve(order.size());
+    for (size_t i : order) {
+        tuples.push_back(given[i]);
+    }
+    
+    if (ixFileHandle.getIndexRoot() != NULL_PAGE) {
+        for (LeafTuple & tuple : tuples) {
+            if (insertEntry(ixFileHandle, attribute, tuple.getKeyPtr(), tuple.getRid()) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (tuples.empty()) {
+        return 0;
+    }
+    
+    // the tree grows upwards until one node covers everything, that one is the root
+    vector<PageNum> nodes;
+    vector<const void *> firstKeys;
+    if (_buildLeafLevel(ixFileHandle, attribute.type, tuples, nodes, firstKeys) != 0) {
+        return -1;
+    }
+    while (nodes.size() > 1) {
+        if (_buildBranchLevel(ixFileHandle, attribute.type, nodes, firstKeys) != 0) {
+            return -1;
+        }
+    }
+    void * buffer = malloc(ixFileHandle.getPageSize());
+    if (ixFileHandle.readPage(nodes[0], buffer) != 0) {
+        free(buffer);
+        return -1;
+    }
+    root = IndexNode(buffer, ixFileHandle.getPageSize());
+    root.initialize();
+    root.setThisPageNum(nodes[0]);
+    free(buffer);
+    rootptr = & root;
+    return ixFileHandle.setIndexRoot(nodes[0]);
+}
+
 /*
  * --------------------------------------------------------------------
  */
@@ -497,9 +653,9 @@ RC IndexManager::_deleteEntryHelper(IXFileHandle & ixFileHandle,
                                     const void * key,
                                     const RID & rid)
 {
-    void * buffer = malloc(PAGE_SIZE);
+    void * buffer = malloc(ixFileHandle.getPageSize());
     ixFileHandle.readPage(pageNum, buffer);
-    IndexNode node = IndexNode(buffer);
+    IndexNode node = IndexNode(buffer, ixFileHandle.getPageSize());
     node.initialize();
     
     if (node.getThisNodeType() == Leaf) {
@@ -603,9 +759,9 @@ void IndexManager::_printBtreeHelper(PageNum & pageNum,
                                      IXFileHandle & ixFileHandle,
                                      const AttrType & keyType)
 const {
-    void * buffer = malloc(PAGE_SIZE);
+    void * buffer = malloc(ixFileHandle.getPageSize());
     ixFileHandle.readPage(pageNum, buffer);
-    IndexNode node = IndexNode(buffer);
+    IndexNode node = IndexNode(buffer, ixFileHandle.getPageSize());
     node.initialize();
     
     if (node.getThisNodeType() == Leaf) {
@@ -699,9 +855,9 @@ RC IX_ScanIterator::_putScanIteratorCursors()
     // _nodeCurs.getThisNodeType() == Branch
     PageNum childpage;
     _nodeCurs.linearSearchBranchTupleForChild(_lowKey, _keyType, childpage);
-    void * buffer = malloc(PAGE_SIZE);
+    void * buffer = malloc(_ixFileHandle.getPageSize());
     _ixFileHandle.readPage(childpage, buffer);
-    _nodeCurs = IndexNode(buffer);
+    _nodeCurs = IndexNode(buffer, _ixFileHandle.getPageSize());
     _nodeCurs.initialize();
     _putScanIteratorCursors();
     return 0;
@@ -764,6 +920,23 @@ LeafTuple IX_ScanIterator::_highestBoundTup(AttrType & keyType)
     return LeafTuple(key, keyType, rid);
 }
 
+// a mapped file is copied into the node straight from the mapping, skipping the read buffer
+IndexNode loadNodeFrom(IXFileHandle & ixFileHandle, const PageNum & pageNum)
+{
+    const void * page = ixFileHandle.mappedPage(pageNum);
+    if (page != nullptr) {
+        IndexNode node = IndexNode((void*)page, ixFileHandle.getPageSize());
+        node.initialize();
+        return node;
+    }
+    void * buffer = malloc(ixFileHandle.getPageSize());
+    ixFileHandle.readPage(pageNum, buffer);
+    IndexNode node = IndexNode(buffer, ixFileHandle.getPageSize());
+    node.initialize();
+    free(buffer);
+    return node;
+}
+
 RC IX_ScanIterator::initialize(const PageNum & rootPageNum,
                                IXFileHandle & ixFileHandle,
                                const AttrType & keyType,
@@ -772,11 +945,9 @@ RC IX_ScanIterator::initialize(const PageNum & rootPageNum,
                                bool lowKeyInclusive,
                                bool highKeyInclusive)
 {
-    void * buffer = malloc(PAGE_SIZE);
-    ixFileHandle.readPage(rootPageNum, buffer);
-    IndexNode root = IndexNode(buffer);
-    root.initialize();
-    _nodeCurs = root;
+    // leaves are followed left to right, a mapped file can be read ahead by the kernel
+    ixFileHandle.beginSequentialRead();
+    _nodeCurs = loadNodeFrom(ixFileHandle, rootPageNum);
     _pageCurs = _nodeCurs.getThisPageNum();
     
     _ixFileHandle = ixFileHandle;
@@ -845,10 +1016,7 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void* &key)
     // done traversing the current page
     else if (_nodeCurs.getNextPageNum() != NO_MORE_PAGE) {
         _pageCurs = _nodeCurs.getNextPageNum();
-        void * buffer = malloc(PAGE_SIZE);
-        _ixFileHandle.readPage(_pageCurs, buffer);
-        _nodeCurs = IndexNode(buffer);
-        _nodeCurs.initialize();
+        _nodeCurs = loadNodeFrom(_ixFileHandle, _pageCurs);
         
         LeafTuple * headptr = nullptr;
         _nodeCurs.rolloutOfBuffer(headptr);
@@ -877,11 +1045,9 @@ RC IX_ScanIterator::close()
 
 IXFileHandle::IXFileHandle()
 {
-    readPageCounter = 0;
-    writePageCounter = 0;
-    appendPageCounter = 0;
     fileName = "";
-    pFile = NULL;
+    store = nullptr;
+    fileId = 0;
 }
 
 IXFileHandle::~IXFileHandle()
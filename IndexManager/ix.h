@@ -27,7 +27,7 @@ public:
     RC destroyFile(const string &fileName);
 
     // Open an index and return an ixfileHandle.
-    RC openFile(const string &fileName, IXFileHandle &ixfileHandle);
+    RC openFile(const string &fileName, IXFileHandle &ixfileHandle, const FileAccessMode accessMode = ReadWrite);
 
     // Close an ixfileHandle for an index.
     RC closeFile(IXFileHandle &ixfileHandle);
@@ -38,6 +38,11 @@ public:
     // Delete an entry from the given index that is indicated by the given ixfileHandle.
     RC deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attribute, const void *key, const RID &rid);
 
+    // Insert many entries at once. An empty index is built bottom-up: the entries are sorted by key,
+    // packed into full leaves and the branches are laid over them a level at a time.
+    // An index that has entries already gets them one insertEntry() at a time, in key order.
+    RC insertEntries(IXFileHandle &ixfileHandle, const Attribute &attribute, const vector<const void *> &keys, const vector<RID> &rids);
+
     // Initialize and IX_ScanIterator to support a range search
     RC scan(IXFileHandle &ixfileHandle,
             const Attribute &attribute,
@@ -63,9 +68,10 @@ private:
     
     RC _createNewNode(const NodeType & nodeType,
                       const AttrType & keyType,
+                      const unsigned & pageSize,
                       IndexNode* &newNode);
     
-    RC _initializeBplusRoot(const NodeType & nodeType, const AttrType & keyType, IndexNode & root);
+    RC _initializeBplusRoot(const NodeType & nodeType, const AttrType & keyType, const unsigned & pageSize, IndexNode & root);
     
     RC _insertIntoLeafTupleList(IndexNode & leaf,
                                 LeafTuple & inserted,
@@ -86,6 +92,17 @@ private:
                        const void * key,
                        const RID & rid);
     
+    RC _buildLeafLevel(IXFileHandle & ixFileHandle,
+                       const AttrType & keyType,
+                       vector<LeafTuple> & tuples,
+                       vector<PageNum> & nodes,
+                       vector<const void *> & firstKeys);
+    
+    RC _buildBranchLevel(IXFileHandle & ixFileHandle,
+                         const AttrType & keyType,
+                         vector<PageNum> & nodes,
+                         vector<const void *> & firstKeys);
+    
     RC _insertIntoBplusTree(IndexNode & root,
                             IndexNode* &newChildPtr,
                             IXFileHandle & ixFileHandle,
@@ -132,15 +149,14 @@ class IXFileHandle : public FileHandle {
 /*
  * Inherited from the FileHandle class
 
-    unsigned readPageCounter;
-    unsigned writePageCounter;
-    unsigned appendPageCounter;
     string fileName;
-    FILE * pFile;
+    shared_ptr<PageStore> store;
+    shared_ptr<OpenFileState> state;
  
     RC readPage(PageNum pageNum, void *data);
     RC writePage(PageNum pageNum, const void *data);
     RC appendPage(const void *data);
+    RC sync();
     RC collectCounterValues(unsigned &readPageCount,
                             unsigned &writePageCount,
                             unsigned &appendPageCount);
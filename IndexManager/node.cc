@@ -10,71 +10,86 @@ Node::Node(void * data)
  */
 
 // explicitly inherit constructor from Node()
-IndexNode::IndexNode(void * data)
+IndexNode::IndexNode(void * data, const unsigned & pageSize)
 {
-    memcpy(_buffer, data, PAGE_SIZE); // is done by the header
+    if (pageSize != _pageSize) {
+        // _buffer starts out PAGE_SIZE long
+        free(_buffer);
+        _buffer = malloc(pageSize);
+        _pageSize = pageSize;
+    }
+    memcpy(_buffer, data, _pageSize); // is done by the header
 }
 
 
+char * IndexNode::_infoPtr(const int & distance) const
+{
+    return (char*)_buffer + _pageSize - distance;
+}
+
 RC IndexNode::initializeEmptyNode()
 {
-    memset(_buffer, EMPTY_BYTE, PAGE_SIZE);
+    memset(_buffer, EMPTY_BYTE, _pageSize);
     return 0;
 }
 RC IndexNode::initialize()
 {
-    _nodeType = *(NodeType*)((char*)_buffer + IDX_NODE_TYPE_INFO_OFS);
-    _freeSpaceOfs = *(short*)((char*)_buffer + IDX_FREE_SPACE_INFO_OFS);
-    _thisPage = *(PageNum*)((char*)_buffer + IDX_THIS_NODE_PAGENUM);
-    _nextPage = *(PageNum*)((char*)_buffer + IDX_NEXT_NODE_PAGENUM);
-    _keyType = (AttrType) *(int*)((char*)_buffer + IDX_KEY_TYPE_INFO_OFS);
+    _nodeType = *(NodeType*)_infoPtr(IDX_NODE_TYPE_INFO_OFS);
+    _freeSpaceOfs = *(int*)_infoPtr(IDX_FREE_SPACE_INFO_OFS);
+    _thisPage = *(PageNum*)_infoPtr(IDX_THIS_NODE_PAGENUM);
+    _nextPage = *(PageNum*)_infoPtr(IDX_NEXT_NODE_PAGENUM);
+    _keyType = (AttrType) *(int*)_infoPtr(IDX_KEY_TYPE_INFO_OFS);
     return 0;
 }
 
-RC IndexNode::_setFreeSpaceOfs(const short & freeSpaceOfs)
+RC IndexNode::_setFreeSpaceOfs(const int & freeSpaceOfs)
 {
-    memcpy((char*)_buffer + IDX_FREE_SPACE_INFO_OFS, & freeSpaceOfs, sizeof(short));
+    memcpy(_infoPtr(IDX_FREE_SPACE_INFO_OFS), & freeSpaceOfs, sizeof(int));
     _freeSpaceOfs = freeSpaceOfs;
     return 0;
 }
 RC IndexNode::_setThisNodeType(const NodeType & nodeType)
 {
-    memcpy((char*)_buffer + IDX_NODE_TYPE_INFO_OFS, & nodeType, sizeof(NodeType));
+    memcpy(_infoPtr(IDX_NODE_TYPE_INFO_OFS), & nodeType, sizeof(NodeType));
     _nodeType = nodeType;
     return 0;
 }
 
 RC IndexNode::_setThisPageNum(const PageNum & thisPage)
 {
-    memcpy((char*)_buffer + IDX_THIS_NODE_PAGENUM, & thisPage, sizeof(PageNum));
+    memcpy(_infoPtr(IDX_THIS_NODE_PAGENUM), & thisPage, sizeof(PageNum));
     _thisPage = thisPage;
     return 0;
 }
 
 RC IndexNode::_setNextPageNum(const PageNum & nextPage)
 {
-    memcpy((char*)_buffer + IDX_NEXT_NODE_PAGENUM, & nextPage, sizeof(PageNum));
+    memcpy(_infoPtr(IDX_NEXT_NODE_PAGENUM), & nextPage, sizeof(PageNum));
     _nextPage = nextPage;
     return 0;
 }
 RC IndexNode::_setKeyType(const AttrType & keyType)
 {
-    memcpy((char*)_buffer + IDX_KEY_TYPE_INFO_OFS, & keyType, sizeof(int));
+    memcpy(_infoPtr(IDX_KEY_TYPE_INFO_OFS), & keyType, sizeof(int));
     _keyType = keyType;
     return 0;
 }
 
 
-RC IndexNode::setFreeSpaceOfs(const short & freeSpaceOfs) {
+RC IndexNode::setFreeSpaceOfs(const int & freeSpaceOfs) {
     return _setFreeSpaceOfs(freeSpaceOfs);
 }
-short IndexNode::getFreeSpaceOfs() const
+int IndexNode::getFreeSpaceOfs() const
 {
     return _freeSpaceOfs;
 }
-short IndexNode::getFreeSpaceAmount() const
+int IndexNode::getFreeSpaceAmount() const
+{
+    return getInfoLeftBound() - getFreeSpaceOfs();
+}
+int IndexNode::getInfoLeftBound() const
 {
-    return IDX_INFO_LEFT_BOUND_OFS - getFreeSpaceOfs();
+    return (int) _pageSize - IDX_INFO_LEFT_BOUND_OFS;
 }
 RC IndexNode::setThisNodeType(const NodeType & nodeType)
 {
@@ -145,13 +160,13 @@ RC IndexNode::_rollinToBufferLeafHelper(LeafTuple * t,
 
 RC IndexNode::rollinToBuffer(LeafTuple * headptr)
 {
-    short increment = FIRST_TUPLE_OFS;
+    int increment = FIRST_TUPLE_OFS;
     
     // clear current _buffer of the page
-    memset(_buffer, EMPTY_BYTE, IDX_INFO_LEFT_BOUND_OFS);
+    memset(_buffer, EMPTY_BYTE, getInfoLeftBound());
     
     while (headptr != nullptr && headptr->getKeyPtr() != nullptr) {
-        assert(increment <= IDX_INFO_LEFT_BOUND_OFS &&
+        assert(increment <= getInfoLeftBound() &&
                "IndexNode::rollinToBuffer(LeafTupe) ERROR.");
 
         _rollinToBufferLeafHelper(headptr, (char*)_buffer + increment);
@@ -201,9 +216,9 @@ RC IndexNode::_rollinToBufferBranchHelper(BranchTuple* t,
 }
 RC IndexNode::rollinToBuffer(BranchTuple* headptr)
 {
-    short increment = FIRST_TUPLE_OFS;
+    int increment = FIRST_TUPLE_OFS;
     while (headptr != nullptr) {
-        assert(increment <= IDX_INFO_LEFT_BOUND_OFS &&
+        assert(increment <= getInfoLeftBound() &&
                "IndexNode::rollinToBuffer(BranchTuple) ERROR.");
         _rollinToBufferBranchHelper(headptr, (char*)_buffer + increment);
         increment += headptr->getLength();
@@ -218,7 +233,7 @@ RC IndexNode::rolloutOfBuffer(LeafTuple* & headptr)
     headptr = new LeafTuple(_buffer, FIRST_TUPLE_OFS, _keyType);
     LeafTuple * curs = headptr;
     LeafTuple * nextptr;
-    short increment = curs->getLength();
+    int increment = curs->getLength();
     while (increment < _freeSpaceOfs) {
         nextptr = new LeafTuple(_buffer, increment, _keyType);
         curs->next = nextptr;
@@ -233,7 +248,7 @@ RC IndexNode::rolloutOfBuffer(BranchTuple* &headptr)
     headptr = new BranchTuple(_buffer, FIRST_TUPLE_OFS, _keyType);
     BranchTuple* curs = headptr;
     BranchTuple* nextptr;
-    short increment = headptr->getLength();
+    int increment = headptr->getLength();
     while (increment < _freeSpaceOfs) {
         nextptr = new BranchTuple(_buffer, increment, _keyType);
         curs->next = nextptr;
@@ -314,7 +329,7 @@ RC IndexNode::linearSearchLeafTupleForKey(const bool & lowKeyInclusive,
 
 RC IndexNode::clearAll()
 {
-    memset(getBufferPtr(), EMPTY_BYTE, IDX_INFO_LEFT_BOUND_OFS);
+    memset(getBufferPtr(), EMPTY_BYTE, getInfoLeftBound());
     _setFreeSpaceOfs(0);
     return 0;
 }
@@ -399,7 +414,7 @@ LeafTuple::LeafTuple(const void * key,
 
 // LeafTuple Constructor 2: init from page buffer
 LeafTuple::LeafTuple(const void * buffer,
-                     const short & tupleOfs,
+                     const int & tupleOfs,
                      const AttrType & keyType)
 {
     _keyPtr = (char*)buffer + tupleOfs;
@@ -494,7 +509,7 @@ BranchTuple::BranchTuple(const void * key,
 
 // BranchTuple Constructor 2: init from page buffer
 BranchTuple::BranchTuple(void * data,
-                         const short & tupleOfs,
+                         const int & tupleOfs,
                          const AttrType & keyType)
 {
     _keyPtr = (char*)data + tupleOfs;
@@ -3,15 +3,17 @@
 
 #include "../Utils/utils.h"
 
-const short IDX_NEXT_NODE_PAGENUM = 4092; //   [92 + 0000]
-const short IDX_THIS_NODE_PAGENUM = 4088; //     [88 + 0000]
-const short IDX_NODE_TYPE_INFO_OFS = 4084; //   [84 + 0000]
-const short IDX_FREE_SPACE_INFO_OFS = 4082; //  [82 + 00]
-const short IDX_KEY_TYPE_INFO_OFS = 4078; //    [80 + 00000]
-const short IDX_INFO_LEFT_BOUND_OFS = 4078; //  [80]
+// node info sits at the end of the page, these are distances back from the end
+// so the same layout works for any page size
+const int IDX_NEXT_NODE_PAGENUM = 4; //     [-4 + 0000]
+const int IDX_THIS_NODE_PAGENUM = 8; //     [-8 + 0000]
+const int IDX_NODE_TYPE_INFO_OFS = 12; //   [-12 + 0000]
+const int IDX_FREE_SPACE_INFO_OFS = 16; //  [-16 + 0000]
+const int IDX_KEY_TYPE_INFO_OFS = 20; //    [-20 + 0000]
+const int IDX_INFO_LEFT_BOUND_OFS = 20; //  [-20]
 
 const PageNum NO_MORE_PAGE = pow(2, 32) - 1;
-const short NO_TUPLE_OFS = pow(2, 16) - 1;
+const short NO_TUPLE_OFS = -1;     // all 16 bits set
 
 const PageNum ROOT_PAGE = 0;
 const short FIRST_TUPLE_OFS = 0;
@@ -76,7 +78,7 @@ public:
               const RID & rid);
     
     LeafTuple(const void * buffer,
-              const short & tupleOfs,
+              const int & tupleOfs,
               const AttrType & keyType);
     
     bool exactMatch(LeafTuple & leafTuple);
@@ -96,7 +98,7 @@ public:
     ~BranchTuple() {};
     
     BranchTuple(void * data,
-                const short & tupleOfs,
+                const int & tupleOfs,
                 const AttrType & keyType);
     
     BranchTuple(const void * key,
@@ -130,6 +132,7 @@ public:
 protected:
     void * _buffer = malloc(PAGE_SIZE);
     // void * _buffer; seems give it a NULL address WTF?
+    unsigned _pageSize = PAGE_SIZE;     // bytes in _buffer, the page size of the index file
 };
 
 class IndexNode : public Node
@@ -140,12 +143,13 @@ public:
     ~IndexNode() {};
     
     // constructor
-    IndexNode(void * data);
+    IndexNode(void * data, const unsigned & pageSize = PAGE_SIZE);
 
     // free ofs
-    RC setFreeSpaceOfs(const short & freeSpaceOfs);
-    short getFreeSpaceOfs() const;
-    short getFreeSpaceAmount() const;
+    RC setFreeSpaceOfs(const int & freeSpaceOfs);
+    int getFreeSpaceOfs() const;
+    int getFreeSpaceAmount() const;
+    int getInfoLeftBound() const;       // where the node info starts, tuples end before it
     // type
     RC setThisNodeType(const NodeType & nodeType);
     NodeType getThisNodeType() const;
@@ -182,19 +186,20 @@ public:
     void * getBufferPtr();
     
 protected:
-    short _freeSpaceOfs;
+    int _freeSpaceOfs;
     NodeType _nodeType;
-    PageNum _nextPage = NULL;
+    PageNum _nextPage = 0;
     AttrType _keyType;
-    PageNum _thisPage = NULL;
+    PageNum _thisPage = 0;
     
-    RC _setFreeSpaceOfs(const short & freeSpaceOfs);
+    RC _setFreeSpaceOfs(const int & freeSpaceOfs);
     RC _setThisNodeType(const NodeType & nodeType);
     RC _setThisPageNum(const PageNum & thisPage);
     RC _setNextPageNum(const PageNum & nextPage);
     RC _setKeyType(const AttrType & keyType);
     RC _rollinToBufferLeafHelper(LeafTuple* t, void* bufferOfs);
     RC _rollinToBufferBranchHelper(BranchTuple* t, void* bufferOfs);
+    char * _infoPtr(const int & distance) const;
     
 };
 
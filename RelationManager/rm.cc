@@ -1,6 +1,7 @@
 #include "rm.h"
 #include "../FileManager/rbfm.h"
 #include "../FileManager/pfm.h"
+#include "../IndexManager/ix.h"
 
 
 /* ---------------------------------------------------------------------------------------
@@ -194,8 +195,8 @@ RC printTableMap(const unordered_map<string, Table> & map)
 
 RC RelationManager::_loadTABLE(FileHandle & tableHandle)
 {
-    void * pageBuffer = malloc(PAGE_SIZE);
-    void * data = malloc(PAGE_SIZE);
+    void * pageBuffer = malloc(tableHandle.getPageSize());
+    void * data = malloc(tableHandle.getPageSize());
     
     Table tbl;
     RID tRid;
@@ -252,8 +253,8 @@ RC RelationManager::_loadTABLE(FileHandle & tableHandle)
 
 RC RelationManager::_loadCOLUMN(FileHandle & columnHandle)
 {
-    void * pageBuffer = malloc(PAGE_SIZE);
-    void * data = malloc(PAGE_SIZE);
+    void * pageBuffer = malloc(columnHandle.getPageSize());
+    void * data = malloc(columnHandle.getPageSize());
     
     Column clm;
     RID cRid;
@@ -337,7 +338,7 @@ RelationManager::RelationManager()
 {
     _rbf_manager = RecordBasedFileManager::instance();
     
-    if (_utils->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX) && _utils->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
+    if (_rbf_manager->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX) && _rbf_manager->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
         
         _rbf_manager->openFile(INIT_TABLE_NAME + DAT_FILE_SUFFIX, tableHandle);
         TABLEMAP.clear(); // global
@@ -362,7 +363,7 @@ RelationManager::~RelationManager()
 
 RC RelationManager::createCatalog()
 {
-    if (_utils->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX) || _utils->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
+    if (_rbf_manager->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX) || _rbf_manager->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
         cout << "Catalog TABLE.dat and COLUMN.dat already exists." << endl;
         return -1;
     }
@@ -458,11 +459,11 @@ RC RelationManager::createCatalog()
 
 RC RelationManager::deleteCatalog()
 {
-    if (_utils->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX)) {
+    if (_rbf_manager->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX)) {
         _rbf_manager->destroyFile(INIT_TABLE_NAME + DAT_FILE_SUFFIX);
     }
     
-    if (_utils->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
+    if (_rbf_manager->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
         _rbf_manager->destroyFile(INIT_COLUMN_NAME + DAT_FILE_SUFFIX);
     }
     
@@ -482,14 +483,14 @@ RC RelationManager::createTable(const string &tableName,
                                 const vector<Attribute> &attrs)
 {
     // check existence of the corresponding file 'cause there shouldn't be.
-    if (_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         cout << "The table already exists." << endl;
         return -1;
     }
     _rbf_manager->createFile(tableName + DAT_FILE_SUFFIX);
     
     // check existence of the primitive two files: TABLE and COLUMN
-    if (!_utils->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX) || !_utils->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(INIT_TABLE_NAME + DAT_FILE_SUFFIX) || !_rbf_manager->fileExists(INIT_COLUMN_NAME + DAT_FILE_SUFFIX)) {
         cout << "Catalog TABLE.dat and COLUMN.dat don't exist." << endl;
         return -1;
     }
@@ -532,7 +533,7 @@ RC RelationManager::createTable(const string &tableName,
 
 RC RelationManager::deleteTable(const string &tableName)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     if (checkOwnership(TABLEMAP[tableName]) == SYSTEM) {
@@ -559,7 +560,7 @@ RC RelationManager::deleteTable(const string &tableName)
 
 RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &attrs)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     // get attributes about a table from COLUMNSMAP
@@ -573,7 +574,7 @@ RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &at
 
 RC RelationManager::insertTuple(const string &tableName, const void *data, RID &rid)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     if (checkOwnership(TABLEMAP[tableName]) == SYSTEM) {
@@ -595,7 +596,7 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
 
 RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     if (checkOwnership(TABLEMAP[tableName]) == SYSTEM) {
@@ -617,7 +618,7 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
 
 RC RelationManager::updateTuple(const string &tableName, const void *data, const RID &rid)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     if (checkOwnership(TABLEMAP[tableName]) == SYSTEM) {
@@ -637,9 +638,131 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     return updateSuccess;
 }
 
+RC RelationManager::createZoneMap(const string &tableName, const vector<string> &attributeNames)
+{
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
+        return -1;
+    }
+    
+    FileHandle fileHandle;
+    _rbf_manager->openFile(tableName + DAT_FILE_SUFFIX, fileHandle);
+    
+    vector<Attribute> tupleDescriptor;
+    getAttributes(tableName, tupleDescriptor);
+    
+    RC createSuccess = _rbf_manager->createZoneMap(fileHandle, tupleDescriptor, attributeNames);
+    
+    _rbf_manager->closeFile(fileHandle);
+    
+    return createSuccess;
+}
+
+RC RelationManager::reorganizeTable(const string &tableName,
+                                    const vector<TableIndex> &indexes,
+                                    RM_Reorganizer &rm_Reorganizer)
+{
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
+        return -1;
+    }
+    if (checkOwnership(TABLEMAP[tableName]) == SYSTEM) {
+        return -1;
+    }
+    
+    vector<Attribute> tupleDescriptor;
+    getAttributes(tableName, tupleDescriptor);
+    
+    return rm_Reorganizer.initialize(tableName + DAT_FILE_SUFFIX, tupleDescriptor, indexes);
+}
+
+RC RM_Reorganizer::initialize(const string &fileName, const vector<Attribute> &attrs, const vector<TableIndex> &indexes)
+{
+    // every index must be on an attribute of the table
+    for (const TableIndex & index : indexes) {
+        bool found = false;
+        for (const Attribute & attr : attrs) {
+            found = found || attr.name == index.attributeName;
+        }
+        if (!found) {
+            return -1;
+        }
+    }
+    if (RecordBasedFileManager::instance()->reorganize(fileName, attrs, _rbfmReorganizer) != 0) {
+        return -1;
+    }
+    _fileName = fileName;
+    _attrs = attrs;
+    _indexes = indexes;
+    return 0;
+}
+
+RC RM_Reorganizer::step(const unsigned &pageCount)
+{
+    if (_rbfmReorganizer.step(pageCount) != 0) {
+        return -1;
+    }
+    // the indexes are moved in the step that swapped the file in, so nobody finds them pointing into the old one
+    if (_rbfmReorganizer.done() && !_indexes.empty()) {
+        RC rc = _moveIndexEntries();
+        _indexes.clear();
+        return rc;
+    }
+    return 0;
+}
+
+// one entry at a time the new RID goes in before the old one goes out, so a key is never missing from the index
+RC RM_Reorganizer::_moveIndexEntries()
+{
+    RecordBasedFileManager * rbfm = RecordBasedFileManager::instance();
+    IndexManager * ix = IndexManager::instance();
+    vector<pair<RID, RID> > moves;
+    if (_rbfmReorganizer.movedRecords(moves) != 0) {
+        return -1;
+    }
+    
+    FileHandle fileHandle;
+    if (rbfm->openFile(_fileName, fileHandle) != 0) {
+        return -1;
+    }
+    void * data = malloc(fileHandle.getPageSize());
+    RC rc = 0;
+    for (const TableIndex & index : _indexes) {
+        Attribute attribute;
+        for (const Attribute & attr : _attrs) {
+            if (attr.name == index.attributeName) {
+                attribute = attr;
+            }
+        }
+        IXFileHandle ixFileHandle;
+        if (ix->openFile(index.fileName, ixFileHandle) != 0) {
+            rc = -1;
+            continue;
+        }
+        for (const pair<RID, RID> & move : moves) {
+            // the tuple is the same in the new file, its key is read from there
+            if (rbfm->readAttribute(fileHandle, _attrs, move.second, index.attributeName, data) != 0) {
+                rc = -1;
+                continue;
+            }
+            // a NULL key has no entry
+            if (*(unsigned char*)data & 0x80) {
+                continue;
+            }
+            // the old entry stays if the new one can't go in, a lookup still finds the key
+            if (ix->insertEntry(ixFileHandle, attribute, (char*)data + 1, move.second) != 0
+                || ix->deleteEntry(ixFileHandle, attribute, (char*)data + 1, move.first) != 0) {
+                rc = -1;
+            }
+        }
+        ix->closeFile(ixFileHandle);
+    }
+    free(data);
+    rbfm->closeFile(fileHandle);
+    return rc;
+}
+
 RC RelationManager::readTuple(const string &tableName, const RID &rid, void *data)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     // no ownership check required
@@ -665,7 +788,7 @@ RC RelationManager::printTuple(const vector<Attribute> &attrs, const void *data)
 
 RC RelationManager::readAttribute(const string &tableName, const RID &rid, const string &attributeName, void *data)
 {
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     // no ownership check required
@@ -684,6 +807,15 @@ RC RelationManager::readAttribute(const string &tableName, const RID &rid, const
 }
 
 
+// the handle of a scan whose iterator was dropped without close() still gets closed
+void closeScanHandle(FileHandle * fileHandle)
+{
+    if (fileHandle->store != nullptr) {
+        RecordBasedFileManager::instance()->closeFile(* fileHandle);
+    }
+    delete fileHandle;
+}
+
 RC RelationManager::scan(const string &tableName,
                          const string &conditionAttribute,
                          const CompOp compOp,
@@ -691,27 +823,442 @@ RC RelationManager::scan(const string &tableName,
                          const vector<string> &attributeNames,
                          RM_ScanIterator &rm_ScanIterator)
 {
+    return scan(tableName, ScanFilter::compare(conditionAttribute, compOp, value), attributeNames, rm_ScanIterator);
+}
+
+RC RelationManager::scan(const string &tableName,
+                         const ScanFilter &filter,
+                         const vector<string> &attributeNames,
+                         RM_ScanIterator &rm_ScanIterator,
+                         const ScanMode mode)
+{
     
-    if (!_utils->fileExists(tableName + DAT_FILE_SUFFIX)) {
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
         return -1;
     }
     // no ownership check required
     
-    FileHandle fileHandle;
-    _rbf_manager->openFile(tableName + DAT_FILE_SUFFIX, fileHandle);
+    shared_ptr<FileHandle> fileHandle(new FileHandle(), closeScanHandle);
+    if (_rbf_manager->openFile(tableName + DAT_FILE_SUFFIX, * fileHandle) != 0) {
+        return -1;
+    }
     
     vector<Attribute> tupleDescriptor;
     getAttributes(tableName, tupleDescriptor);
     
     RBFM_ScanIterator rbfmsi = RBFM_ScanIterator();
     
-    _rbf_manager->scan(fileHandle, tupleDescriptor, conditionAttribute, compOp, value, attributeNames, rbfmsi);
-    // -> which finishes the following initialization : rbfmsi.initialize(fileHandle, tupleDescriptor, conditionAttribute, compOp, value, attributeNames);
+    // a scan that can't start closes its handle here, the iterator is left as it was
+    if (_rbf_manager->scan(* fileHandle, tupleDescriptor, filter, attributeNames, rbfmsi, mode) != 0) {
+        return -1;
+    }
+    // -> which finishes the following initialization : rbfmsi.initialize(fileHandle, tupleDescriptor, filter, attributeNames, mode);
     
-    rm_ScanIterator.initialize(rbfmsi);
+    // the handle stays open while the rm_ScanIterator uses it
+    return rm_ScanIterator.initialize(rbfmsi, fileHandle);
+}
+
+
+/* ---------------------------------------------------------------------------------------
+ Bulk load
+ --------------------------------------------------------------------------------------- */
+
+// one piece of the source file and the tuples parsed out of it
+typedef struct {
+    string text;                // whole lines / whole binary tuples only
+    string tuples;              // parsed tuples back to back, insertTuple() format
+    vector<size_t> offsets;     // where each tuple starts in tuples
+    size_t maxTupleLength;      // a longer tuple doesn't fit on a page of the table
+    RC rc;
+} LoadChunk;
+
+// where the CSV line starting at pos ends: the first '\n' outside quotes, size if there is none
+size_t csvLineEnd(const char * text, const size_t & size, size_t pos)
+{
+    bool quoted = false;
+    for (; pos < size; pos++) {
+        if (text[pos] == '"') {
+            // "" inside a quoted field flips twice
+            quoted = !quoted;
+        }
+        else if (text[pos] == '\n' && !quoted) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+// a tuple in insertTuple() format as long as it claims to be, -1 if it runs past available
+long tupleLengthOf(const char * tuple, const size_t & available, const vector<Attribute> & attrs)
+{
+    size_t nullBytes = (attrs.size() + BITES_PER_BYTE - 1) / BITES_PER_BYTE;
+    size_t length = nullBytes;
+    if (length > available) {
+        return -1;
+    }
+    for (size_t i = 0; i < attrs.size(); i++) {
+        auto mask = (unsigned char) (0x80 >> (i % BITES_PER_BYTE));
+        if ((tuple[i / BITES_PER_BYTE] & mask) == mask) {
+            continue;
+        }
+        size_t fieldLength = sizeof(int);
+        if (attrs[i].type == TypeVarChar) {
+            if (length + sizeof(int) > available) {
+                return -1;
+            }
+            int strLength;
+            memcpy(& strLength, tuple + length, sizeof(int));
+            if (strLength < 0 || (AttrLength) strLength > attrs[i].length) {
+                return -1;
+            }
+            fieldLength += strLength;
+        }
+        length += fieldLength;
+        if (length > available) {
+            return -1;
+        }
+    }
+    return (long) length;
+}
+
+// the value of attribute attrIdx inside a tuple in insertTuple() format, nullptr if it is NULL
+const char * fieldOf(const char * tuple, const vector<Attribute> & attrs, const unsigned & attrIdx)
+{
+    const char * field = tuple + (attrs.size() + BITES_PER_BYTE - 1) / BITES_PER_BYTE;
+    for (unsigned i = 0; i <= attrIdx; i++) {
+        auto mask = (unsigned char) (0x80 >> (i % BITES_PER_BYTE));
+        if ((tuple[i / BITES_PER_BYTE] & mask) == mask) {
+            if (i == attrIdx) {
+                return nullptr;
+            }
+            continue;
+        }
+        if (i == attrIdx) {
+            return field;
+        }
+        int strLength = 0;
+        if (attrs[i].type == TypeVarChar) {
+            memcpy(& strLength, field, sizeof(int));
+        }
+        field += sizeof(int) + strLength;
+    }
+    return nullptr;
+}
+
+// an unquoted empty field is NULL, the rest are converted to the type of their column
+RC parseCsvLine(const char * line, const size_t & length, const vector<Attribute> & attrs, string & tuples)
+{
+    size_t nullBytes = (attrs.size() + BITES_PER_BYTE - 1) / BITES_PER_BYTE;
+    size_t start = tuples.size();
+    tuples.append(nullBytes, '\0');
+    
+    size_t pos = 0;
+    string field;
+    for (size_t i = 0; i < attrs.size(); i++) {
+        if (pos > length) {
+            // fewer fields than columns
+            return -1;
+        }
+        field.clear();
+        bool quoted = pos < length && line[pos] == '"';
+        if (quoted) {
+            pos++;
+            while (true) {
+                if (pos >= length) {
+                    return -1;
+                }
+                if (line[pos] == '"') {
+                    if (pos + 1 < length && line[pos + 1] == '"') {
+                        field += '"';
+                        pos += 2;
+                        continue;
+                    }
+                    pos++;
+                    break;
+                }
+                field += line[pos++];
+            }
+            if (pos < length && line[pos] != ',') {
+                return -1;
+            }
+        }
+        else {
+            size_t end = pos;
+            while (end < length && line[end] != ',') {
+                end++;
+            }
+            field.assign(line + pos, end - pos);
+            pos = end;
+        }
+        pos++; // past the ','
+        
+        if (!quoted && field.empty()) {
+            tuples[start + i / BITES_PER_BYTE] |= (char) (0x80 >> (i % BITES_PER_BYTE));
+            continue;
+        }
+        char * end = nullptr;
+        switch (attrs[i].type) {
+            case TypeInt: {
+                long intValue = strtol(field.c_str(), & end, 10);
+                if (quoted || * end != '\0' || intValue < INT_MIN || intValue > INT_MAX) {
+                    return -1;
+                }
+                int value = (int) intValue;
+                tuples.append((const char*) & value, sizeof(int));
+                break;
+            }
+            case TypeReal: {
+                float value = strtof(field.c_str(), & end);
+                if (quoted || * end != '\0') {
+                    return -1;
+                }
+                tuples.append((const char*) & value, sizeof(float));
+                break;
+            }
+            case TypeVarChar: {
+                if (field.size() > attrs[i].length) {
+                    return -1;
+                }
+                int strLength = (int) field.size();
+                tuples.append((const char*) & strLength, sizeof(int));
+                tuples.append(field);
+                break;
+            }
+            default:
+                return -1;
+        }
+    }
+    if (pos <= length) {
+        // more fields than columns
+        return -1;
+    }
+    return 0;
+}
+
+void parseChunk(LoadChunk * chunk, const vector<Attribute> * attrs, const BulkLoadFormat format)
+{
+    chunk->tuples.clear();
+    chunk->offsets.clear();
+    chunk->rc = 0;
+    const char * text = chunk->text.data();
+    size_t size = chunk->text.size();
+    size_t pos = 0;
+    while (pos < size) {
+        size_t start = chunk->tuples.size();
+        if (format == CsvFormat) {
+            size_t end = csvLineEnd(text, size, pos);
+            size_t length = end - pos;
+            if (length > 0 && text[pos + length - 1] == '\r') {
+                length--;
+            }
+            // blank lines are skipped
+            if (length > 0) {
+                if (parseCsvLine(text + pos, length, * attrs, chunk->tuples) != 0
+                    || chunk->tuples.size() - start > chunk->maxTupleLength) {
+                    chunk->tuples.resize(start);
+                    chunk->rc = -1;
+                    return;
+                }
+                chunk->offsets.push_back(start);
+            }
+            pos = end + 1;
+        }
+        else {
+            int length;
+            if (pos + sizeof(int) > size) {
+                chunk->rc = -1;
+                return;
+            }
+            memcpy(& length, text + pos, sizeof(int));
+            pos += sizeof(int);
+            if (length <= 0 || pos + length > size || tupleLengthOf(text + pos, length, * attrs) != length
+                || (size_t) length > chunk->maxTupleLength) {
+                chunk->rc = -1;
+                return;
+            }
+            chunk->tuples.append(text + pos, length);
+            chunk->offsets.push_back(start);
+            pos += length;
+        }
+    }
+}
+
+// where the last whole tuple in text ends
+size_t wholeTuplesEnd(const string & text, const BulkLoadFormat & format)
+{
+    if (format == CsvFormat) {
+        // a newline inside quotes is part of a field, not the end of a tuple
+        size_t end = 0;
+        size_t newline;
+        while ((newline = csvLineEnd(text.data(), text.size(), end)) < text.size()) {
+            end = newline + 1;
+        }
+        return end;
+    }
+    size_t pos = 0;
+    while (pos + sizeof(int) <= text.size()) {
+        int length;
+        memcpy(& length, text.data() + pos, sizeof(int));
+        if (length <= 0) {
+            // malformed, let the parser report it
+            return text.size();
+        }
+        if (pos + sizeof(int) + length > text.size()) {
+            break;
+        }
+        pos += sizeof(int) + length;
+    }
+    return pos;
+}
+
+// the next piece of the source; a tuple cut in half is carried over to the piece after it
+bool readChunk(FILE * source, const BulkLoadFormat & format, string & carry, string & text)
+{
+    text.swap(carry);
+    carry.clear();
+    size_t kept = text.size();
+    text.resize(kept + BULK_LOAD_CHUNK_BYTES);
+    size_t got = fread(& text[kept], 1, BULK_LOAD_CHUNK_BYTES, source);
+    text.resize(kept + got);
+    if (got == 0) {
+        // end of the source, whatever is left is the last piece
+        return !text.empty();
+    }
+    size_t end = wholeTuplesEnd(text, format);
+    carry.assign(text, end, string::npos);
+    text.resize(end);
+    return true;
+}
+
+// the keys of one index collected during a load, back to back
+typedef struct {
+    unsigned attrIdx;
+    string keys;
+    vector<size_t> offsets;
+    vector<RID> rids;
+} LoadedKeys;
+
+RC RelationManager::bulkLoad(const string &tableName,
+                             const string &sourceFile,
+                             const BulkLoadFormat format,
+                             const vector<TableIndex> &indexes)
+{
+    if (!_rbf_manager->fileExists(tableName + DAT_FILE_SUFFIX)) {
+        return -1;
+    }
+    if (checkOwnership(TABLEMAP[tableName]) == SYSTEM) {
+        return -1;
+    }
+    vector<Attribute> tupleDescriptor;
+    getAttributes(tableName, tupleDescriptor);
+    // every index must be on an attribute of the table and its file must be there
+    vector<LoadedKeys> loaded(indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        loaded[i].attrIdx = (unsigned) tupleDescriptor.size();
+        for (unsigned attrIdx = 0; attrIdx < tupleDescriptor.size(); attrIdx++) {
+            if (tupleDescriptor[attrIdx].name == indexes[i].attributeName) {
+                loaded[i].attrIdx = attrIdx;
+            }
+        }
+        if (loaded[i].attrIdx == tupleDescriptor.size() || !_rbf_manager->fileExists(indexes[i].fileName)) {
+            return -1;
+        }
+    }
+    FILE * source = fopen(sourceFile.c_str(), "rb");
+    if (source == nullptr) {
+        return -1;
+    }
+    
+    // the table is opened once for the whole load
+    FileHandle fileHandle;
+    if (_rbf_manager->openFile(tableName + DAT_FILE_SUFFIX, fileHandle) != 0) {
+        fclose(source);
+        return -1;
+    }
     
-    // leave the fileHandle.pFile open while the rm_ScanIterator exists. 
-//    _rbf_manager->closeFile(fileHandle);
+    unsigned threads = thread::hardware_concurrency();
+    if (threads == 0 || threads > BULK_LOAD_THREADS) {
+        threads = threads == 0 ? 1 : BULK_LOAD_THREADS;
+    }
+    vector<LoadChunk> chunks(threads);
+    // a tuple too long for a page stops the load like a malformed one, behind the tuples in front of it
+    for (LoadChunk & chunk : chunks) {
+        chunk.maxTupleLength = _rbf_manager->maxRecordLength(fileHandle, tupleDescriptor);
+    }
+    string carry;
+    bool more = true;
+    RC rc = 0;
+    while (rc == 0 && more) {
+        // read a round of pieces, parse them side by side, then insert them in file order
+        unsigned filled = 0;
+        while (filled < threads && (more = readChunk(source, format, carry, chunks[filled].text))) {
+            filled++;
+        }
+        vector<thread> workers;
+        for (unsigned i = 0; i < filled; i++) {
+            workers.push_back(thread(parseChunk, & chunks[i], & tupleDescriptor, format));
+        }
+        for (unsigned i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        for (unsigned i = 0; i < filled && rc == 0; i++) {
+            // a piece with a malformed tuple still has the good ones in front of it parsed
+            vector<const void *> tuples;
+            tuples.reserve(chunks[i].offsets.size());
+            for (size_t offset : chunks[i].offsets) {
+                tuples.push_back(chunks[i].tuples.data() + offset);
+            }
+            vector<RID> rids;
+            rc = _rbf_manager->insertRecords(fileHandle, tupleDescriptor, tuples, rids);
+            if (rc != 0) {
+                break;
+            }
+            if (chunks[i].rc != 0) {
+                rc = -1;
+            }
+            // a NULL key has no entry
+            for (LoadedKeys & index : loaded) {
+                const Attribute & attr = tupleDescriptor[index.attrIdx];
+                for (size_t t = 0; t < rids.size(); t++) {
+                    const char * key = fieldOf((const char*) tuples[t], tupleDescriptor, index.attrIdx);
+                    if (key == nullptr) {
+                        continue;
+                    }
+                    int length = sizeof(int);
+                    if (attr.type == TypeVarChar) {
+                        memcpy(& length, key, sizeof(int));
+                        length += sizeof(int);
+                    }
+                    index.offsets.push_back(index.keys.size());
+                    index.keys.append(key, (size_t) length);
+                    index.rids.push_back(rids[t]);
+                }
+            }
+        }
+    }
+    if (ferror(source)) {
+        rc = -1;
+    }
+    fclose(source);
+    _rbf_manager->closeFile(fileHandle);
     
-    return 0;
+    // whatever got into the table gets into the indexes, even when the load stopped early
+    IndexManager * ix = IndexManager::instance();
+    for (size_t i = 0; i < indexes.size(); i++) {
+        vector<const void *> keys;
+        keys.reserve(loaded[i].offsets.size());
+        for (size_t offset : loaded[i].offsets) {
+            keys.push_back(loaded[i].keys.data() + offset);
+        }
+        IXFileHandle ixFileHandle;
+        if (ix->openFile(indexes[i].fileName, ixFileHandle) != 0) {
+            rc = -1;
+            continue;
+        }
+        if (ix->insertEntries(ixFileHandle, tupleDescriptor[loaded[i].attrIdx], keys, loaded[i].rids) != 0) {
+            rc = -1;
+        }
+        ix->closeFile(ixFileHandle);
+    }
+    return rc;
 }
@@ -2,6 +2,8 @@
 #define _rm_h_
 
 
+#include <thread>
+
 #include "../FileManager/pfm.h"
 #include "../FileManager/rbfm.h"
 
@@ -9,6 +11,14 @@ using namespace std;
 
 #define RM_EOF (-1)  // end of a scan operator
 
+// Layout of a file handed to RelationManager::bulkLoad()
+typedef enum {
+    CsvFormat = 0,      // one tuple per line, fields in column order separated by ',';
+                        // an empty field is NULL, "..." quotes a varchar ("" inside is one quote),
+                        // which may hold ',' and line breaks; '"' appears nowhere but in quoted fields
+    BinaryFormat        // tuples back to back, each one a 4-byte length followed by the tuple in insertTuple() format
+} BulkLoadFormat;
+
 typedef struct {
     int tid;
     string tableName;
@@ -27,14 +37,23 @@ typedef struct {
     RID cRid;
 } Column;
 
+// An index on one attribute of a table; the catalog doesn't list indexes, whoever keeps one names it
+typedef struct {
+    string attributeName;
+    string fileName;
+} TableIndex;
+
 // RM_ScanIterator is an iteratr to go through tuples
 class RM_ScanIterator {
 public:
   RM_ScanIterator() {};
   ~RM_ScanIterator() {};
 
-    RC initialize(RBFM_ScanIterator rbfmsi) {
+    // the iterator owns the handle RelationManager::scan() opened for it; copies of the iterator share it
+    RC initialize(RBFM_ScanIterator rbfmsi, shared_ptr<FileHandle> fileHandle) {
+        close();
         this->_rbfmsi = rbfmsi;
+        this->_fileHandle = fileHandle;
         return 0;
     };
 
@@ -45,13 +64,58 @@ public:
       }
       return 0;
   };
+  // up to batch.capacity tuples at once, column by column (see RecordBatch)
+  RC getNextBatch(RecordBatch &batch) {
+      if (_rbfmsi.getNextBatch(batch) == RBFM_EOF) {
+          return RM_EOF;
+      }
+      return 0;
+  };
+  // the file is closed once, by whichever copy closes first, so it can be swapped by a reorganization;
+  // an iterator that is never closed closes it when the last copy goes away
   RC close() {
       _rbfmsi.close();
-      return -1; };
+      if (_fileHandle && _fileHandle->store != nullptr) {
+          RecordBasedFileManager::instance()->closeFile(*_fileHandle);
+      }
+      _fileHandle.reset();
+      return 0; };
 
 private:
     RBFM_ScanIterator _rbfmsi;
-    
+    shared_ptr<FileHandle> _fileHandle;
+
+};
+
+
+// RM_Reorganizer rewrites a table into a new file a step at a time (see RBFM_Reorganizer);
+// the step that swaps the file in also moves the entries of the table's indexes to the new RIDs
+class RM_Reorganizer {
+public:
+  RM_Reorganizer() {};
+  ~RM_Reorganizer() {};
+
+  RC initialize(const string &fileName, const vector<Attribute> &attrs, const vector<TableIndex> &indexes);
+  RC step(const unsigned &pageCount = REORG_STEP_PAGES);
+  // the table is in its new file and its indexes point into it
+  bool done() const {
+      return _rbfmReorganizer.done() && _indexes.empty();
+  };
+  // where the tuple that was at rid is now, once done()
+  RC movedTo(const RID &rid, RID &newRid) const {
+      return _rbfmReorganizer.movedTo(rid, newRid);
+  };
+  RC close() {
+      return _rbfmReorganizer.close();
+  };
+
+private:
+    RBFM_Reorganizer _rbfmReorganizer;
+    string _fileName;
+    vector<Attribute> _attrs;
+    vector<TableIndex> _indexes;
+
+    RC _moveIndexEntries();
 };
 
 
@@ -73,6 +137,15 @@ public:
 
   RC insertTuple(const string &tableName, const void *data, RID &rid);
 
+  // Append every tuple of sourceFile to the table. The file is read in pieces that are parsed
+  // by several threads and inserted in file order a page-full at a time; a malformed tuple,
+  // or one too long for a page, stops the load with -1, the tuples in front of it stay in the table.
+  // The loaded tuples are added to the given indexes afterwards, an empty index is built bottom-up.
+  RC bulkLoad(const string &tableName,
+      const string &sourceFile,
+      const BulkLoadFormat format = CsvFormat,
+      const vector<TableIndex> &indexes = vector<TableIndex>());
+
   RC deleteTuple(const string &tableName, const RID &rid);
 
   RC updateTuple(const string &tableName, const void *data, const RID &rid);
@@ -94,6 +167,22 @@ public:
       const vector<string> &attributeNames, // a list of projected attributes
       RM_ScanIterator &rm_ScanIterator);
 
+  // Same, with a filter over any number of attributes (see ScanFilter), optionally on worker threads (see ScanMode)
+  RC scan(const string &tableName,
+      const ScanFilter &filter,
+      const vector<string> &attributeNames,
+      RM_ScanIterator &rm_ScanIterator,
+      const ScanMode mode = SerialScan);
+
+  // Summarize these attributes page by page, so scans skip the pages that can't qualify (see ZoneMap)
+  RC createZoneMap(const string &tableName, const vector<string> &attributeNames);
+
+  // Rewrite the table densely into a new file, a step of the reorganizer at a time (see RM_Reorganizer).
+  // Tuples get new RIDs; the entries of the given indexes are moved along with them.
+  RC reorganizeTable(const string &tableName,
+      const vector<TableIndex> &indexes,
+      RM_Reorganizer &rm_Reorganizer);
+
 // Extra credit work (10 points)
 public:
     RC addAttribute(const string &tableName, const Attribute &attr);
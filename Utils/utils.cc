@@ -26,13 +26,6 @@ bool UtilsManager::fileExists(const string &filename)
     return false;
 }
 
-string UtilsManager::statFileNameOf(const string & filename)
-{
-    string suffix = ".stat";
-    string prefix = ".";
-    return (prefix + filename + suffix);
-}
-
 void UtilsManager::print_char(const unsigned char oneChar) {
     unsigned char mask;
     cout << '[';
@@ -63,14 +56,11 @@ void UtilsManager::print_bytes(void *object, size_t size)
 // this function returns string content from the given data chunk and offset
 // NOTE that the first 4bytes make an int indicator of the strLen
 string UtilsManager::getStringFrom(const void * data,
-                                   const short & offset) {
+                                   const int & offset) {
     int strLen;
     memcpy(&strLen, (char*)data + offset, sizeof(int));
-    // no Varchar entry takes memory more than 1 page
-    char strVal[PAGE_SIZE];
-    memcpy(strVal, (char*)data + offset + sizeof(int), (size_t) strLen);
-    strVal[strLen] = '\0';
-    return string(strVal);
+    // all strLen chars, a '\0' among them included
+    return string((char*)data + offset + sizeof(int), (size_t) strLen);
 }
 
 void UtilsManager::printDecoded(const vector<Attribute> &recordDescriptor,
@@ -83,12 +73,12 @@ void UtilsManager::printDecoded(const vector<Attribute> &recordDescriptor,
     
     auto fieldNum = (short) recordDescriptor.size();
     
-    short thisFieldDataOfs = fieldNum * sizeof(short);
+    int thisFieldDataOfs = fieldNum * sizeof(int);
     for(int i = 0; i < recordDescriptor.size(); i++) {
         output += recordDescriptor[i].name;
         output += tab;
         
-        auto nextFieldDataOfs = *(short*)((char*)decodedRec + i * sizeof(short));
+        auto nextFieldDataOfs = *(int*)((char*)decodedRec + i * sizeof(int));
         if (nextFieldDataOfs == ATTR_NULL_FLAG) {
             /*
              * if this field is NULL (encoded by nextFieldDataOfs == ATTR_NULL_FLAG)
@@ -122,41 +112,6 @@ void UtilsManager::printDecoded(const vector<Attribute> &recordDescriptor,
     cout << output << endl;
 }
 
-RC UtilsManager::readFileStatsFrom(const string & fileName,
-                                   unsigned & readPageCounter,
-                                   unsigned & writePageCounter,
-                                   unsigned & appendPageCounter)
-{
-    FILE * fptr = fopen(statFileNameOf(fileName).c_str(), "rb+");
-    void * buffer = malloc(sizeof(unsigned) * STAT_NUM);
-    fread(buffer, sizeof(char), sizeof(unsigned) * STAT_NUM, fptr);
-    memcpy(&readPageCounter, (char*)buffer + READ_PAGE_COUNTER_OFFSET, sizeof(unsigned));
-    memcpy(&writePageCounter, (char*)buffer + WRITE_PAGE_COUNTER_OFFSET, sizeof(unsigned));
-    memcpy(&appendPageCounter, (char*)buffer + APPEND_PAGE_COUNTER_OFFSET, sizeof(unsigned));
-    free(buffer);
-    fclose(fptr);
-    
-    return 0;
-}
-
-RC UtilsManager::writeFileStatsTo(const string & fileName,
-                                  const unsigned & readPageCounter,
-                                  const unsigned & writePageCounter,
-                                  const unsigned & appendPageCounter)
-{
-    FILE * fptr = fopen(statFileNameOf(fileName).c_str(), "rb+");
-    void * buffer = malloc(sizeof(unsigned) * STAT_NUM);
-    memcpy((char*)buffer + READ_PAGE_COUNTER_OFFSET, & readPageCounter, sizeof(unsigned));
-    memcpy((char*)buffer + WRITE_PAGE_COUNTER_OFFSET, & writePageCounter, sizeof(unsigned));
-    memcpy((char*)buffer + APPEND_PAGE_COUNTER_OFFSET, & appendPageCounter, sizeof(unsigned));
-    fwrite((char*)buffer, sizeof(char), sizeof(unsigned) * STAT_NUM, fptr);
-    fflush(fptr);
-    free(buffer);
-    fclose(fptr);
-    
-    return 0;
-}
-
 RID UtilsManager::getRidAt(const void * data)
 {
     RID rid;
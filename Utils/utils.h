@@ -5,6 +5,8 @@
  * INCLUDE LIBRARIES
  */
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -16,18 +18,26 @@
 /*
  * DEFINE MACROS
  */
-// 4096
-#define FREE_SPACE_INFO_POS 4094
-// a 2bytes (short int) would be sufficient to repr free space in a 4KB page
-#define SLOT_NUM_INFO_POS 4092
-
-#define RIGHT_MOST_SLOT_OFFSET 4088
+// a record page starts with [page size][free space offset][number of live slots][slots in the directory][first free slot][dead bytes],
+// 4 bytes each, so offsets and lengths on pages of any size fit and the slot directory can find the end of its page
+#define RBFM_PAGE_SIZE_POS 0
+#define FREE_SPACE_INFO_POS 4
+#define SLOT_NUM_INFO_POS 8
+#define SLOT_DIR_SIZE_POS 12
+#define FREE_SLOT_HEAD_POS 16
+#define DEAD_SPACE_INFO_POS 20
+#define RBFM_PAGE_HEADER_SIZE 24
+// a slot is [record offset][record length], 4 bytes each, slot 0 is the right most one;
+// a free slot is [SLOT_OFFSET_CLEAN][next free slot], chained from FREE_SLOT_HEAD_POS
+#define SLOT_SIZE 8
 
 #define BITES_PER_BYTE 8
 
 #define BEACON_SIZE 5
 
+// default (and smallest) page size, a file can be created with larger pages up to MAX_PAGE_SIZE
 #define PAGE_SIZE 4096
+#define MAX_PAGE_SIZE 65536
 
 # define RBFM_EOF (-1)  // end of a scan operator
 
@@ -40,15 +50,65 @@ using namespace std;
  */
 
 // pfm
-const unsigned STAT_NUM = 3;
-const unsigned READ_PAGE_COUNTER_OFFSET = 0;
-const unsigned WRITE_PAGE_COUNTER_OFFSET = READ_PAGE_COUNTER_OFFSET + sizeof(unsigned);
-const unsigned APPEND_PAGE_COUNTER_OFFSET = WRITE_PAGE_COUNTER_OFFSET + sizeof(unsigned);
+const int FD_NOT_OPEN = -1;
+// page 0 of a paged file is its header, data pages follow it
+const unsigned HEADER_PAGES = 1;
+const unsigned FILE_MAGIC = 0x32324243;    // "CB22"
+const unsigned FILE_FORMAT_VERSION = 5;    // 2: per-file page size, 3: free-slot chain in record pages, 4: dead bytes,
+                                           // 5: 4-byte field ends in records
+const unsigned NULL_PAGE = 0xFFFFFFFF;
+// files grow in extents reserved ahead of the appends, up to 256 pages (1MB) at a time by default
+const unsigned FILE_EXTENT_PAGES = 256;
+// free-space map: a page of 1-byte buckets in front of every FSM_GROUP_PAGES data pages,
+// bucket b means at least b / 256 of that page is free
+const unsigned FSM_GROUP_PAGES = PAGE_SIZE;
+const unsigned FSM_MAX_BUCKET = 255;
+// the header keeps the largest bucket of each group, which caps the map at ~16M data pages
+const unsigned FSM_MAX_GROUPS = PAGE_SIZE - 64;
+
+// bpm
+// default number of frames in the shared buffer pool (1024 * 4KB = 4MB)
+const unsigned BUFFER_POOL_FRAMES = 1024;
+// largest run of pages a scan reads ahead at once (32 * 4KB = 128KB), the window starts smaller
+const unsigned SCAN_READ_AHEAD_PAGES = 32;
+const unsigned SCAN_READ_AHEAD_START = 4;
+
+// aio
+// requests the io_uring keeps in flight, and threads of the pread()/pwrite() fallback
+const unsigned AIO_QUEUE_DEPTH = 256;
+const unsigned AIO_WORKER_THREADS = 4;
 
 // rbfm
-const short ATTR_NULL_FLAG = -1;
+// a stored record starts with where each of its fields ends, 4 bytes each so a record may fill the largest page;
+// a NULL field ends at ATTR_NULL_FLAG
+const int ATTR_NULL_FLAG = -1;
 const short SLOT_OFFSET_CLEAN = -2;
 const short SLOT_RECLEN_CLEAN = -3;
+const int NO_FREE_SLOT = -1;    // end of the free-slot chain
+// deleted records are left in place as dead bytes, a page is compacted when an insert needs the room
+// or once 1 / RBFM_COMPACT_DEAD_RATIO of it is dead
+const int RBFM_COMPACT_DEAD_RATIO = 2;
+// new pages insertRecords() builds in memory before appending them in one go
+const unsigned RBFM_BATCH_PAGES = 256;
+// rows a RecordBatch holds unless asked for another capacity
+const unsigned SCAN_BATCH_ROWS = 1024;
+// parallel scans: worker threads, pages a worker takes at a time (a morsel),
+// and morsels that may wait for the consumer before the workers hold back
+const unsigned SCAN_WORKER_THREADS = 4;
+const unsigned SCAN_MORSEL_PAGES = 64;
+const unsigned SCAN_MORSELS_AHEAD = 16;
+// zone maps: kept in fileName + ZONE_MAP_SUFFIX, up to ZONE_MAX_COLUMNS attributes summarized per page,
+// a varchar by its first ZONE_KEY_SIZE chars
+const string ZONE_MAP_SUFFIX = ".zones";
+const unsigned ZONE_MAX_COLUMNS = 16;
+const unsigned ZONE_KEY_SIZE = 8;
+const unsigned short ZONE_UNKNOWN = 0;          // the page has no entry yet and is always read
+const unsigned short ZONE_KNOWN = 1;
+const unsigned short ZONE_UNBOUNDED = 0xFFFF;   // a column that can't be summarized on the page (a NaN real)
+// reorganization: the file is rewritten into fileName + REORG_FILE_SUFFIX, REORG_STEP_PAGES pages
+// of the old file per step unless asked for another number
+const string REORG_FILE_SUFFIX = ".reorg";
+const unsigned REORG_STEP_PAGES = 64;
 const int PAGENUM_UNAVAILABLE = -4;
 // memset() takes int but fill the block using unsigned char interpretation
 const int EMPTY_BYTE = -5;
@@ -60,6 +120,9 @@ const string INIT_COLUMN_NAME = "COLUMN";
 const string DAT_FILE_SUFFIX = ".dat";
 const int SYSTEM = -1;
 const int USER = 1;
+// bulkLoad() reads its source in pieces of this size, each parsed by one of at most BULK_LOAD_THREADS threads
+const unsigned BULK_LOAD_CHUNK_BYTES = 1 << 22;
+const unsigned BULK_LOAD_THREADS = 4;
 
 // ix
 const unsigned LEAF = 1;
@@ -120,23 +183,12 @@ class UtilsManager
 public:
     static UtilsManager * instance();
     bool fileExists(const string & filename);
-    string statFileNameOf(const string & filename);
     void print_char(const unsigned char oneChar);
     void print_bytes(void *object, size_t size);
     string getStringFrom(const void * data,
-                         const short & offset);
+                         const int & offset);
     void printDecoded(const vector<Attribute> &recordDescriptor,
                       const void *decodedRec);
-    RC readFileStatsFrom(const string & fileName,
-                         unsigned & readPageCounter,
-                         unsigned & writePageCounter,
-                         unsigned & appendPageCounter);
-
-    RC writeFileStatsTo(const string & fileName,
-                        const unsigned & readPageCounter,
-                        const unsigned & writePageCounter,
-                        const unsigned & appendPageCounter);
-    
     RID getRidAt(const void * data);
 
     
@@ -0,0 +1,2867 @@
+#include "../FileManager/test_util.h"
+#include <functional>
+#include <thread>
+#include <map>
+#include <set>
+
+using namespace std;
+
+// Tests of the record-based file features beyond the project spec. Each one checks its
+// feature against the plain path that is already tested: records inserted one at a time,
+// read back one at a time, or a serial scan without filter.
+
+// the i-th employee record of these tests; every 7th has a NULL name, every 11th a NULL salary
+void prepareEmployee(const int i, void *buffer, int *recordSize)
+{
+    unsigned char nullsIndicator = 0;
+    if (i % 7 == 0) {
+        nullsIndicator |= 0x80;
+    }
+    if (i % 11 == 0) {
+        nullsIndicator |= 0x10;
+    }
+    string name(i % 30, 'a' + i % 26);
+    prepareRecord(4, &nullsIndicator, name.size(), name, i % 90, (float) (i % 50) / 10, i * 7 % 10000, buffer, recordSize);
+}
+
+// the size of an employee record follows from its null bits and its name length
+int employeeSize(const char *data)
+{
+    unsigned char nullsIndicator = data[0];
+    int size = 1;
+    if (!(nullsIndicator & 0x80)) {
+        int nameLength;
+        memcpy(&nameLength, data + 1, sizeof(int));
+        size += sizeof(int) + nameLength;
+    }
+    for (unsigned char bit = 0x40; bit >= 0x10; bit >>= 1) {
+        if (!(nullsIndicator & bit)) {
+            size += 4;
+        }
+    }
+    return size;
+}
+
+// every employee record of the file, as a serial scan without filter returns them
+void scanAll(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+             multiset<string> &records)
+{
+    vector<string> attributeNames;
+    for (const Attribute &attr : recordDescriptor) {
+        attributeNames.push_back(attr.name);
+    }
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+    assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+
+    RID rid;
+    char data[PAGE_SIZE];
+    records.clear();
+    while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        records.insert(string(data, employeeSize(data)));
+    }
+    rbfmScanIterator.close();
+}
+
+int RBFTest_BatchInsert(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Insert Records **
+    // 2. Read Record
+    // 3. Scan
+    cout << endl << "***** In RBF Test Case BatchInsert *****" << endl;
+
+    RC rc;
+    string fileName = "test_batch";
+    string singleFileName = "test_batch_single";
+
+    rbfm->destroyFile(fileName);
+    rbfm->destroyFile(singleFileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->createFile(singleFileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    FileHandle singleFileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->openFile(singleFileName, singleFileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // a few records first, so the batch starts on a page that has some already
+    char record[PAGE_SIZE];
+    int recordSize;
+    RID rid;
+    for (int i = 0; i < 10; i++) {
+        prepareEmployee(i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rc = rbfm->insertRecord(singleFileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    // more records than RBFM_BATCH_PAGES pages hold, so new pages are appended in several runs
+    int numRecords = 30000;
+    vector<string> records;
+    vector<const void *> data;
+    for (int i = 10; i < 10 + numRecords; i++) {
+        prepareEmployee(i, record, &recordSize);
+        records.push_back(string(record, recordSize));
+    }
+    for (const string &r : records) {
+        data.push_back(r.data());
+    }
+    unsigned pagesBefore = fileHandle.getNumberOfPages();
+    unsigned readBefore, writeBefore, appendBefore;
+    fileHandle.collectCounterValues(readBefore, writeBefore, appendBefore);
+
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, rids);
+    assert(rc == success && "Inserting records should not fail.");
+    assert(rids.size() == records.size() && "Every record should get a RID.");
+
+    unsigned readAfter, writeAfter, appendAfter;
+    fileHandle.collectCounterValues(readAfter, writeAfter, appendAfter);
+    unsigned newPages = fileHandle.getNumberOfPages() - pagesBefore;
+    cout << "Pages appended: " << newPages << ", pages written: " << writeAfter - writeBefore
+         << ", pages appended by the batch: " << appendAfter - appendBefore << endl;
+    assert(newPages > RBFM_BATCH_PAGES && "The batch should span more than one run of appended pages.");
+    assert(appendAfter - appendBefore == newPages && "Every new page should be appended once.");
+    // the pages of an earlier run may take more records, they are written back once at the end
+    assert(writeAfter - writeBefore < pagesBefore + newPages && "No page should be written more than once.");
+
+    // the same records one at a time
+    for (const string &r : records) {
+        rc = rbfm->insertRecord(singleFileHandle, recordDescriptor, r.data(), rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    // every record reads back from its RID
+    char returnedData[PAGE_SIZE];
+    set<pair<PageNum, SlotNum> > distinct;
+    for (unsigned i = 0; i < rids.size(); i++) {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        assert(rc == success && "Reading a record should not fail.");
+        if (memcmp(returnedData, records[i].data(), records[i].size()) != 0) {
+            cout << "[FAIL] Record " << i << " of the batch does not read back." << endl;
+            return -1;
+        }
+        distinct.insert(make_pair(rids[i].pageNum, rids[i].slotNum));
+    }
+    assert(distinct.size() == rids.size() && "Records of a batch should not share a RID.");
+
+    // and a scan finds the same records as in the file filled one record at a time
+    multiset<string> batched, single;
+    scanAll(rbfm, fileHandle, recordDescriptor, batched);
+    scanAll(rbfm, singleFileHandle, recordDescriptor, single);
+    if (batched != single) {
+        cout << "[FAIL] The batch and the single inserts should leave the same records." << endl;
+        return -1;
+    }
+
+    // a record larger than a page fails the batch, and the records in front of it leave no trace
+    multiset<string> before, after;
+    scanAll(rbfm, fileHandle, recordDescriptor, before);
+    PageNum roomBefore, roomAfter;
+    rc = fileHandle.findPageWithSpace(200, roomBefore);
+    assert(rc == success && "Some page should have room for a small record.");
+    pagesBefore = fileHandle.getNumberOfPages();
+    string oversized(1 + sizeof(int) + 6000 + 3 * sizeof(int), 'x');
+    int oversizedLength = 6000;
+    oversized[0] = 0;
+    memcpy(&oversized[1], &oversizedLength, sizeof(int));
+    vector<const void *> failing(data.begin(), data.begin() + 3);
+    failing.push_back(oversized.data());
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, failing, rids);
+    assert(rc != success && "Inserting a record larger than a page should fail.");
+    scanAll(rbfm, fileHandle, recordDescriptor, after);
+    rc = fileHandle.findPageWithSpace(200, roomAfter);
+    if (after != before || fileHandle.getNumberOfPages() != pagesBefore || rc != success || roomAfter != roomBefore) {
+        cout << "[FAIL] A failed batch should leave the records, the pages and the free-space map as they were." << endl;
+        return -1;
+    }
+
+    // an empty batch inserts nothing
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, vector<const void *>(), rids);
+    assert(rc == success && rids.empty() && "An empty batch should insert nothing.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(singleFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->destroyFile(singleFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case BatchInsert Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// what a selection kernel should give for value i, the plain comparison
+template<typename T>
+bool compares(const T &attr, const CompOp compOp, const T &value)
+{
+    switch (compOp) {
+        case EQ_OP: return attr == value;
+        case LT_OP: return attr < value;
+        case LE_OP: return attr <= value;
+        case GT_OP: return attr > value;
+        case GE_OP: return attr >= value;
+        case NE_OP: return attr != value;
+        default: return true;
+    }
+}
+
+// the mask a kernel filled against the plain comparison, and the guard bytes behind it untouched
+template<typename T>
+bool maskMatches(const vector<unsigned char> &mask, const T *values, const unsigned count, const CompOp compOp, const T &value)
+{
+    unsigned maskBytes = (count + 7) / 8;
+    for (unsigned i = 0; i < maskBytes * 8; i++) {
+        bool selected = (mask[i / 8] & (0x80 >> (i % 8))) != 0;
+        if (selected != (i < count && compares(values[i], compOp, value))) {
+            return false;
+        }
+    }
+    for (unsigned i = maskBytes; i < mask.size(); i++) {
+        if (mask[i] != 0xAA) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int RBFTest_SelectKernels(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. selectInts / selectReals at every kernel level **
+    // 2. RecordBatch::select over NULL rows **
+    // 3. Scan, a batch at a time
+    cout << endl << "***** In RBF Test Case SelectKernels *****" << endl;
+
+    RC rc;
+    KernelLevel supported = kernelLevel();
+    CompOp compOps[] = {EQ_OP, LT_OP, LE_OP, GT_OP, GE_OP, NE_OP, NO_OP};
+
+    // a few values repeat, so every operator selects some and leaves some
+    vector<int> ints;
+    vector<float> reals;
+    for (unsigned i = 0; i < 1100; i++) {
+        ints.push_back((int) (i * 2654435761u % 41) - 20);
+        reals.push_back((float) ((int) (i * 40503u % 37) - 18) / 4);
+    }
+    ints[3] = INT_MIN;
+    ints[4] = INT_MAX;
+
+    // every count up to a few vectors, so each tail length count % 8 comes up, then a long run
+    vector<unsigned> counts;
+    for (unsigned count = 0; count <= 40; count++) {
+        counts.push_back(count);
+    }
+    counts.push_back(1000);
+    counts.push_back(1003);
+
+    KernelLevel levels[] = {ScalarKernels, SseKernels, Avx2Kernels};
+    for (KernelLevel level : levels) {
+        if (useKernelLevel(level) != success) {
+            cout << "Kernel level " << level << " isn't supported here, skipped." << endl;
+            continue;
+        }
+        unsigned checked = 0;
+        for (unsigned count : counts) {
+            for (CompOp compOp : compOps) {
+                // from an unaligned start too
+                for (unsigned start = 0; start < 2; start++) {
+                    vector<unsigned char> mask((count + 7) / 8 + 4, 0xAA);
+                    rc = selectInts(ints.data() + start, count, compOp, 0, mask.data());
+                    assert(rc == success && "selectInts() should not fail.");
+                    if (!maskMatches(mask, ints.data() + start, count, compOp, 0)) {
+                        cout << "[FAIL] selectInts() at level " << level << " of " << count << " values, operator " << compOp << endl;
+                        return -1;
+                    }
+                    mask.assign((count + 7) / 8 + 4, 0xAA);
+                    float value = 0.25;
+                    rc = selectReals(reals.data() + start, count, compOp, value, mask.data());
+                    assert(rc == success && "selectReals() should not fail.");
+                    if (!maskMatches(mask, reals.data() + start, count, compOp, value)) {
+                        cout << "[FAIL] selectReals() at level " << level << " of " << count << " values, operator " << compOp << endl;
+                        return -1;
+                    }
+                    checked += 2;
+                }
+            }
+        }
+        cout << "Kernel level " << level << ": " << checked << " selections match the plain comparisons." << endl;
+    }
+
+    // a batch of a scan, where NULL salaries never qualify
+    string fileName = "test_kernels";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    char record[PAGE_SIZE];
+    int recordSize;
+    RID rid;
+    for (int i = 0; i < 1003; i++) {
+        prepareEmployee(i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Height");
+    for (KernelLevel level : levels) {
+        if (useKernelLevel(level) != success) {
+            continue;
+        }
+        RBFM_ScanIterator rbfmScanIterator;
+        rc = rbfm->scan(fileHandle, recordDescriptor, ScanFilter(), attributeNames, rbfmScanIterator);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        RecordBatch batch(1003);
+        rc = rbfmScanIterator.getNextBatch(batch);
+        assert(rc == success && batch.rows == 1003 && "The batch should hold every record.");
+        int salary = 3000;
+        float height = 2.5;
+        vector<unsigned char> mask;
+        for (CompOp compOp : compOps) {
+            rc = batch.select(0, compOp, &salary, mask);
+            assert(rc == success && "Selecting on an int column should not fail.");
+            for (unsigned r = 0; r < batch.rows; r++) {
+                bool selected = (mask[r / 8] & (0x80 >> (r % 8))) != 0;
+                if (selected != (!batch.isNull(0, r) && compares(batch.intColumn(0)[r], compOp, salary))) {
+                    cout << "[FAIL] RecordBatch::select() on Salary at level " << level << ", row " << r << endl;
+                    return -1;
+                }
+            }
+            rc = batch.select(2, compOp, &height, mask);
+            assert(rc == success && "Selecting on a real column should not fail.");
+            for (unsigned r = 0; r < batch.rows; r++) {
+                bool selected = (mask[r / 8] & (0x80 >> (r % 8))) != 0;
+                if (selected != (!batch.isNull(2, r) && compares(batch.realColumn(2)[r], compOp, height))) {
+                    cout << "[FAIL] RecordBatch::select() on Height at level " << level << ", row " << r << endl;
+                    return -1;
+                }
+            }
+        }
+        rc = batch.select(1, EQ_OP, &salary, mask);
+        assert(rc != success && "Selecting on a varchar column should fail.");
+        rbfmScanIterator.close();
+    }
+    useKernelLevel(supported);
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case SelectKernels Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// every record a scan returns, each with its RID in front, in the order they came
+void scanRecords(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                 const ScanFilter &filter, const vector<string> &attributeNames, const ScanMode mode,
+                 vector<string> &records)
+{
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, filter, attributeNames, rbfmScanIterator, mode);
+    assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+
+    RID rid;
+    char data[PAGE_SIZE];
+    records.clear();
+    while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        // [nulls][name][age], the name may be NULL
+        int size = 1 + sizeof(int);
+        if (!(data[0] & 0x80)) {
+            int nameLength;
+            memcpy(&nameLength, data + 1, sizeof(int));
+            size += sizeof(int) + nameLength;
+        }
+        records.push_back(string((const char *) &rid.pageNum, sizeof(PageNum)) + string((const char *) &rid.slotNum, sizeof(SlotNum))
+                          + string(data, size));
+    }
+    rc = rbfmScanIterator.close();
+    assert(rc == success && "Closing the scan should not fail.");
+}
+
+int RBFTest_ParallelScan(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Scan on worker threads, ordered and unordered **
+    // 2. Scan, a batch at a time, on worker threads **
+    // 3. Close a scan halfway **
+    cout << endl << "***** In RBF Test Case ParallelScan *****" << endl;
+
+    RC rc;
+    string fileName = "test_parallel";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // many morsels, with holes left by deletes
+    char record[PAGE_SIZE];
+    int recordSize;
+    vector<RID> rids;
+    for (int i = 0; i < 40000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+    }
+    for (unsigned i = 0; i < rids.size(); i += 3) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    cout << "Pages: " << fileHandle.getNumberOfPages() << ", morsels of " << SCAN_MORSEL_PAGES << " pages" << endl;
+    assert(fileHandle.getNumberOfPages() > 4 * SCAN_MORSEL_PAGES && "The file should have several morsels.");
+
+    vector<string> attributeNames;
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Age");
+    int ageLow = 30, ageHigh = 70;
+    ScanFilter filters[] = {ScanFilter(), ScanFilter::between("Age", &ageLow, &ageHigh)};
+    for (const ScanFilter &filter : filters) {
+        vector<string> serial, ordered, unordered;
+        scanRecords(rbfm, fileHandle, recordDescriptor, filter, attributeNames, SerialScan, serial);
+        scanRecords(rbfm, fileHandle, recordDescriptor, filter, attributeNames, OrderedParallelScan, ordered);
+        scanRecords(rbfm, fileHandle, recordDescriptor, filter, attributeNames, UnorderedParallelScan, unordered);
+        cout << "Records: serial " << serial.size() << ", ordered " << ordered.size() << ", unordered " << unordered.size() << endl;
+        // an ordered scan gives the same sequence, an unordered one the same records
+        if (ordered != serial || multiset<string>(unordered.begin(), unordered.end()) != multiset<string>(serial.begin(), serial.end())) {
+            cout << "[FAIL] A parallel scan should return what the serial scan does." << endl;
+            return -1;
+        }
+
+        // batches on worker threads hold the same rows
+        RBFM_ScanIterator rbfmScanIterator;
+        rc = rbfm->scan(fileHandle, recordDescriptor, filter, attributeNames, rbfmScanIterator, OrderedParallelScan);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        RecordBatch batch(500);
+        unsigned row = 0;
+        while (rbfmScanIterator.getNextBatch(batch) != RBFM_EOF) {
+            for (unsigned r = 0; r < batch.rows; r++, row++) {
+                string rebuilt = string((const char *) &batch.rids[r].pageNum, sizeof(PageNum))
+                                 + string((const char *) &batch.rids[r].slotNum, sizeof(SlotNum)) + string(1, '\0');
+                if (batch.isNull(0, r)) {
+                    rebuilt[sizeof(PageNum) + sizeof(SlotNum)] = (char) 0x80;
+                }
+                else {
+                    unsigned length;
+                    const char *name = batch.varCharAt(0, r, length);
+                    int nameLength = length;
+                    rebuilt.append((const char *) &nameLength, sizeof(int));
+                    rebuilt.append(name, length);
+                }
+                rebuilt.append((const char *) &batch.intColumn(1)[r], sizeof(int));
+                if (row >= serial.size() || rebuilt != serial[row]) {
+                    cout << "[FAIL] Row " << row << " of a parallel batch differs from the serial scan." << endl;
+                    return -1;
+                }
+            }
+        }
+        rbfmScanIterator.close();
+        if (row != serial.size()) {
+            cout << "[FAIL] The parallel batches should hold " << serial.size() << " rows." << endl;
+            return -1;
+        }
+    }
+
+    // the workers' page reads all reach the file's read counter, as many as a serial scan counts
+    ScanMode modes[] = {SerialScan, OrderedParallelScan, UnorderedParallelScan};
+    unsigned serialReads = 0;
+    for (ScanMode mode : modes) {
+        unsigned readBefore, writeBefore, appendBefore, readAfter, writeAfter, appendAfter;
+        vector<string> scanned;
+        fileHandle.collectCounterValues(readBefore, writeBefore, appendBefore);
+        scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, mode, scanned);
+        fileHandle.collectCounterValues(readAfter, writeAfter, appendAfter);
+        if (mode == SerialScan) {
+            serialReads = readAfter - readBefore;
+        }
+        cout << "Pages read by scan mode " << mode << ": " << readAfter - readBefore << endl;
+        if (readAfter - readBefore != serialReads || serialReads < fileHandle.getNumberOfPages()) {
+            cout << "[FAIL] A parallel scan should count every page it reads, as the serial scan does." << endl;
+            return -1;
+        }
+    }
+
+    // a mapping opened before the file grew is mapped again, once, before the workers read through it
+    FileHandle mappedHandle;
+    rc = rbfm->openFile(fileName, mappedHandle, MmapReadOnly);
+    assert(rc == success && "Opening the file mapped should not fail.");
+    vector<string> serial, ordered, unordered;
+    scanRecords(rbfm, mappedHandle, recordDescriptor, ScanFilter(), attributeNames, UnorderedParallelScan, unordered);
+    for (int i = 40000; i < 60000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, serial);
+    scanRecords(rbfm, mappedHandle, recordDescriptor, ScanFilter(), attributeNames, OrderedParallelScan, ordered);
+    scanRecords(rbfm, mappedHandle, recordDescriptor, ScanFilter(), attributeNames, UnorderedParallelScan, unordered);
+    cout << "Records after the file grew: serial " << serial.size() << ", mapped ordered " << ordered.size()
+         << ", mapped unordered " << unordered.size() << endl;
+    if (ordered != serial || multiset<string>(unordered.begin(), unordered.end()) != multiset<string>(serial.begin(), serial.end())) {
+        cout << "[FAIL] A parallel scan of a mapped file should see the pages added since it was mapped." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(mappedHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // a scan closed halfway lets its workers go, and leaves the file open for whoever opened it
+    for (ScanMode mode : modes) {
+        RBFM_ScanIterator rbfmScanIterator;
+        rc = rbfm->scan(fileHandle, recordDescriptor, ScanFilter(), attributeNames, rbfmScanIterator, mode);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        RID rid;
+        for (int i = 0; i < 100; i++) {
+            rc = rbfmScanIterator.getNextRecord(rid, record);
+            assert(rc == success && "Scanning should not fail.");
+        }
+        rc = rbfmScanIterator.close();
+        assert(rc == success && "Closing a scan should not fail.");
+        rc = rbfmScanIterator.getNextRecord(rid, record);
+        assert(rc == RBFM_EOF && "A closed scan should return RBFM_EOF.");
+        rc = rbfmScanIterator.close();
+        assert(rc == success && "Closing a scan twice should not fail.");
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[1], record);
+        assert(rc == success && "The file should stay open after a scan is closed.");
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case ParallelScan Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// an id and a text of up to 6000 chars
+void createTextDescriptor(vector<Attribute> &recordDescriptor)
+{
+    Attribute attr;
+    attr.name = "id";
+    attr.type = TypeInt;
+    attr.length = (AttrLength)4;
+    recordDescriptor.push_back(attr);
+    attr.name = "text";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength)6000;
+    recordDescriptor.push_back(attr);
+}
+
+// [nulls][id][length][length times c], a record of the text descriptor
+int prepareText(const int id, const int length, const char c, char *buffer)
+{
+    buffer[0] = 0;
+    memcpy(buffer + 1, &id, sizeof(int));
+    memcpy(buffer + 1 + sizeof(int), &length, sizeof(int));
+    memset(buffer + 1 + 2 * sizeof(int), c, length);
+    return 1 + 2 * sizeof(int) + length;
+}
+
+// the record reads back as expected, and how many pages that took
+RC readText(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+            const RID &rid, const string &expected, unsigned &pagesRead)
+{
+    char data[PAGE_SIZE * 2];
+    unsigned readBefore, writeBefore, appendBefore, readAfter, writeAfter, appendAfter;
+    fileHandle.collectCounterValues(readBefore, writeBefore, appendBefore);
+    RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, data);
+    fileHandle.collectCounterValues(readAfter, writeAfter, appendAfter);
+    pagesRead = readAfter - readBefore;
+    if (rc != success || memcmp(data, expected.data(), expected.size()) != 0) {
+        return -1;
+    }
+    return success;
+}
+
+// every id a scan finds, with how often
+void scanIds(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, map<int, int> &ids,
+             const ScanFilter &filter = ScanFilter())
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("id");
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, filter, attributeNames, rbfmScanIterator);
+    assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+    RID rid;
+    char data[PAGE_SIZE];
+    ids.clear();
+    while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        int id;
+        memcpy(&id, data + 1, sizeof(int));
+        ids[id]++;
+    }
+    rbfmScanIterator.close();
+}
+
+int RBFTest_UpdateMoves(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Update a record that has to move, again and again, then back home **
+    // 2. Update a record that fits nowhere **
+    // 3. Read Record, Scan
+    cout << endl << "***** In RBF Test Case UpdateMoves *****" << endl;
+
+    RC rc;
+    string fileName = "test_update_moves";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+
+    // a few full pages
+    char record[PAGE_SIZE * 2];
+    int numRecords = 200;
+    vector<RID> rids;
+    map<int, string> expected;
+    for (int i = 0; i < numRecords; i++) {
+        int size = prepareText(i, 90, 'a' + i % 26, record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+        expected[i] = string(record, size);
+    }
+    RID home = rids[0];
+    unsigned pagesRead;
+
+    // the record outgrows its page, moves on, and its RID keeps leading to it in at most two page reads;
+    // it never leaves a chain of beacons behind, however often it moves
+    int lengths[] = {1500, 1900, 600, 1700, 2500, 800, 3000, 1200, 2000, 3500};
+    for (int length : lengths) {
+        int size = prepareText(0, length, 'A' + length % 26, record);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, home);
+        assert(rc == success && "Updating a record should not fail.");
+        expected[0] = string(record, size);
+        // other records fill the pages it left and went to
+        for (int i = 0; i < 5; i++) {
+            size = prepareText(numRecords, 300, 'z', record);
+            RID rid;
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+            assert(rc == success && "Inserting a record should not fail.");
+            rids.push_back(rid);
+            expected[numRecords++] = string(record, size);
+        }
+        rc = readText(rbfm, fileHandle, recordDescriptor, home, expected[0], pagesRead);
+        if (rc != success || pagesRead > 2) {
+            cout << "[FAIL] A record moved to " << length << " bytes should read back in two pages, it took " << pagesRead << endl;
+            return -1;
+        }
+    }
+    map<int, int> ids;
+    scanIds(rbfm, fileHandle, recordDescriptor, ids);
+    if (ids.size() != expected.size() || ids[0] != 1) {
+        cout << "[FAIL] Every record should be scanned once, the moved one too." << endl;
+        return -1;
+    }
+
+    // with room made on its home page, it moves back: one page read
+    for (int i = 1; i < 30; i++) {
+        if (rids[i].pageNum == home.pageNum) {
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+            assert(rc == success && "Deleting a record should not fail.");
+            expected.erase(i);
+        }
+    }
+    int size = prepareText(0, 50, 'h', record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, home);
+    assert(rc == success && "Updating a record should not fail.");
+    expected[0] = string(record, size);
+    rc = readText(rbfm, fileHandle, recordDescriptor, home, expected[0], pagesRead);
+    if (rc != success || pagesRead != 1) {
+        cout << "[FAIL] A record back home should read in one page, it took " << pagesRead << endl;
+        return -1;
+    }
+
+    // a record no page can hold is refused, and the one there stays as it was
+    size = prepareText(0, 1800, 'r', record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, home);
+    assert(rc == success && "Updating a record should not fail.");
+    expected[0] = string(record, size);
+    unsigned pages = fileHandle.getNumberOfPages();
+    prepareText(0, 5000, 'x', record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, home);
+    assert(rc != success && "Updating a record to more than a page should fail.");
+    rc = readText(rbfm, fileHandle, recordDescriptor, home, expected[0], pagesRead);
+    if (rc != success || fileHandle.getNumberOfPages() != pages) {
+        cout << "[FAIL] A refused update should leave the record and the file as they were." << endl;
+        return -1;
+    }
+
+    // many updates and some deletes at random: everything reads back in at most two pages and is scanned once
+    unsigned seed = 7;
+    int maxPagesRead = 0;
+    for (int round = 0; round < 20000; round++) {
+        seed = seed * 1103515245 + 12345;
+        int i = (seed >> 8) % numRecords;
+        if (expected.count(i) == 0) {
+            continue;
+        }
+        if ((seed >> 4) % 50 == 0) {
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+            assert(rc == success && "Deleting a record should not fail.");
+            expected.erase(i);
+            continue;
+        }
+        int length = (seed >> 12) % 4 == 0 ? (seed >> 16) % 1500 : (seed >> 16) % 100;
+        size = prepareText(i, length, 'A' + round % 26, record);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+        expected[i] = string(record, size);
+    }
+    for (auto &e : expected) {
+        rc = readText(rbfm, fileHandle, recordDescriptor, rids[e.first], e.second, pagesRead);
+        if (rc != success) {
+            cout << "[FAIL] Record " << e.first << " should read back after the updates." << endl;
+            return -1;
+        }
+        maxPagesRead = max(maxPagesRead, (int) pagesRead);
+    }
+    scanIds(rbfm, fileHandle, recordDescriptor, ids);
+    bool scannedOnce = ids.size() == expected.size();
+    for (auto &id : ids) {
+        scannedOnce = scannedOnce && id.second == 1 && expected.count(id.first) == 1;
+    }
+    cout << "Live records: " << expected.size() << ", most pages read for one: " << maxPagesRead << endl;
+    if (!scannedOnce || maxPagesRead > 2) {
+        cout << "[FAIL] After the updates every record should be scanned once and read in at most two pages." << endl;
+        return -1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case UpdateMoves Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// the pages a filtered scan reads, and the ids it finds against those of the plain scan filtered here
+RC checkZonedScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                  const ScanFilter &filter, const function<bool(int)> &qualifies, unsigned &pagesRead)
+{
+    map<int, int> all, filtered, expected;
+    scanIds(rbfm, fileHandle, recordDescriptor, all);
+    for (auto &id : all) {
+        if (qualifies(id.first)) {
+            expected.insert(id);
+        }
+    }
+    unsigned readBefore, writeBefore, appendBefore, readAfter, writeAfter, appendAfter;
+    fileHandle.collectCounterValues(readBefore, writeBefore, appendBefore);
+    scanIds(rbfm, fileHandle, recordDescriptor, filtered, filter);
+    fileHandle.collectCounterValues(readAfter, writeAfter, appendAfter);
+    pagesRead = readAfter - readBefore;
+    return filtered == expected && !expected.empty() ? success : -1;
+}
+
+int RBFTest_ZoneMap(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Create a zone map, keep it through inserts, updates and deletes **
+    // 2. Scan with a filter, skipping the pages the zone map rules out **
+    // 3. Close and open the file with its zone map **
+    cout << endl << "***** In RBF Test Case ZoneMap *****" << endl;
+
+    RC rc;
+    string fileName = "test_zonemap";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+
+    // ids grow with the pages, half of them are there before the zone map, half come after
+    char record[PAGE_SIZE * 2];
+    int numRecords = 20000;
+    vector<RID> rids;
+    vector<string> attributeNames;
+    attributeNames.push_back("id");
+    for (int i = 0; i < numRecords; i++) {
+        if (i == numRecords / 2) {
+            rc = rbfm->createZoneMap(fileHandle, recordDescriptor, attributeNames);
+            assert(rc == success && "Creating a zone map should not fail.");
+        }
+        prepareText(i, 40, 'a' + i % 26, record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+    }
+    rc = rbfm->createZoneMap(fileHandle, recordDescriptor, attributeNames);
+    assert(rc != success && "Creating a second zone map should fail.");
+    unsigned pages = fileHandle.getNumberOfPages();
+
+    // deletes, updates that move records to other pages, and updates that change the id
+    for (int i = 0; i < numRecords; i += 5) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    for (int i = 5001; i < 5100; i += 5) {
+        prepareText(i, 600, 'm', record);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+    }
+    for (int i = 1001; i < numRecords; i += 1000) {
+        prepareText(1000000 + i, 40, 'u', record);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+    }
+
+    int low = 5000, high = 5100, small = 500, large = 1000000;
+    for (int round = 0; round < 2; round++) {
+        // a narrow filter reads a few pages, and finds what the plain scan does
+        unsigned pagesRead;
+        rc = checkZonedScan(rbfm, fileHandle, recordDescriptor, ScanFilter::compare("id", LT_OP, &small),
+                            [&](int id) { return id < small; }, pagesRead);
+        cout << "Pages: " << pages << ", read for id < " << small << ": " << pagesRead << endl;
+        if (rc != success || pagesRead * 4 > pages) {
+            cout << "[FAIL] A scan for id < " << small << " should find the same records as the plain scan, and skip most pages." << endl;
+            return -1;
+        }
+        // records that moved are found on the pages they moved to
+        rc = checkZonedScan(rbfm, fileHandle, recordDescriptor, ScanFilter::between("id", &low, &high),
+                            [&](int id) { return id >= low && id <= high; }, pagesRead);
+        if (rc != success || pagesRead * 4 > pages) {
+            cout << "[FAIL] A scan between " << low << " and " << high << " should find the records that moved, and skip most pages." << endl;
+            return -1;
+        }
+        // ids changed by an update widen their page's zone
+        rc = checkZonedScan(rbfm, fileHandle, recordDescriptor, ScanFilter::compare("id", GE_OP, &large),
+                            [&](int id) { return id >= large; }, pagesRead);
+        if (rc != success) {
+            cout << "[FAIL] A scan for the updated ids should find them all." << endl;
+            return -1;
+        }
+
+        // the zone map is kept with the file
+        rc = rbfm->closeFile(fileHandle);
+        assert(rc == success && "Closing the file should not fail.");
+        rc = rbfm->openFile(fileName, fileHandle);
+        assert(rc == success && "Opening the file should not fail.");
+        assert(rbfm->zoneMapOf(fileHandle) && "The zone map should be there after the file is opened again.");
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case ZoneMap Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_WidePages(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Create a file with 16KB and 64KB pages **
+    // 2. Insert, read, update and scan records longer than 32KB **
+    // 3. Insert Records, Read Attribute
+    cout << endl << "***** In RBF Test Case WidePages *****" << endl;
+
+    RC rc;
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+    recordDescriptor[1].length = (AttrLength)MAX_PAGE_SIZE;
+    unsigned pageSizes[] = {4 * PAGE_SIZE, MAX_PAGE_SIZE};
+    for (unsigned pageSize : pageSizes) {
+        string fileName = "test_wide_" + to_string(pageSize);
+        rbfm->destroyFile(fileName);
+        rc = rbfm->createFile(fileName, PosixStorage, pageSize);
+        assert(rc == success && "Creating the file should not fail.");
+        FileHandle fileHandle;
+        rc = rbfm->openFile(fileName, fileHandle);
+        assert(rc == success && "Opening the file should not fail.");
+        assert(fileHandle.getPageSize() == pageSize && "The file should keep its page size.");
+
+        // the longest record a page takes, a few that fill most of one, and small ones around them
+        vector<char> record(2 * MAX_PAGE_SIZE), returned(2 * MAX_PAGE_SIZE);
+        int lengths[] = {(int) pageSize - 100, (int) pageSize * 5 / 8, 30, (int) pageSize / 2 + 1000, 7, (int) pageSize * 3 / 4};
+        map<int, string> expected;
+        vector<RID> rids;
+        for (int i = 0; i < 6; i++) {
+            int size = prepareText(i, lengths[i], 'a' + i, record.data());
+            RID rid;
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, record.data(), rid);
+            assert(rc == success && "Inserting a record should not fail.");
+            rids.push_back(rid);
+            expected[i] = string(record.data(), size);
+        }
+        // the same through a batch
+        vector<string> batch;
+        vector<const void *> data;
+        for (int i = 6; i < 12; i++) {
+            int size = prepareText(i, lengths[i - 6], 'A' + i, record.data());
+            batch.push_back(string(record.data(), size));
+            expected[i] = batch.back();
+        }
+        for (const string &r : batch) {
+            data.push_back(r.data());
+        }
+        vector<RID> batchRids;
+        rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, batchRids);
+        assert(rc == success && "Inserting records should not fail.");
+        rids.insert(rids.end(), batchRids.begin(), batchRids.end());
+
+        // a record longer than the page is refused either way
+        prepareText(99, pageSize, 'x', record.data());
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record.data(), rid);
+        assert(rc != success && "Inserting a record longer than a page should fail.");
+        data.assign(1, record.data());
+        rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, batchRids);
+        assert(rc != success && "Inserting a record longer than a page should fail.");
+
+        // the long ones grow, shrink and move
+        int updates[] = {(int) pageSize * 7 / 8, 40, (int) pageSize - 100};
+        for (int u = 0; u < 3; u++) {
+            int size = prepareText(1, updates[u], 'u' + u, record.data());
+            rc = rbfm->updateRecord(fileHandle, recordDescriptor, record.data(), rids[1]);
+            assert(rc == success && "Updating a record should not fail.");
+            expected[1] = string(record.data(), size);
+        }
+
+        for (auto &e : expected) {
+            rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[e.first], returned.data());
+            if (rc != success || memcmp(returned.data(), e.second.data(), e.second.size()) != 0) {
+                cout << "[FAIL] Record " << e.first << " on " << pageSize << "-byte pages does not read back." << endl;
+                return -1;
+            }
+            // the text comes out of the stored record on its own, its length as written
+            rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[e.first], "text", returned.data());
+            if (rc != success || memcmp(returned.data() + 1, e.second.data() + 1 + sizeof(int), e.second.size() - 1 - sizeof(int)) != 0) {
+                cout << "[FAIL] The text of record " << e.first << " on " << pageSize << "-byte pages does not read back." << endl;
+                return -1;
+            }
+        }
+        vector<string> attributeNames;
+        attributeNames.push_back("id");
+        attributeNames.push_back("text");
+        RBFM_ScanIterator rbfmScanIterator;
+        rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        unsigned scanned = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returned.data()) != RBFM_EOF) {
+            int id;
+            memcpy(&id, returned.data() + 1, sizeof(int));
+            if (expected.count(id) == 0 || memcmp(returned.data(), expected[id].data(), expected[id].size()) != 0) {
+                cout << "[FAIL] A scan of " << pageSize << "-byte pages returns a record that was not written." << endl;
+                return -1;
+            }
+            scanned++;
+        }
+        rbfmScanIterator.close();
+        cout << "Page size: " << pageSize << ", pages: " << fileHandle.getNumberOfPages() << ", records scanned: " << scanned << endl;
+        if (scanned != expected.size()) {
+            cout << "[FAIL] A scan of " << pageSize << "-byte pages should return every record once." << endl;
+            return -1;
+        }
+
+        rc = rbfm->closeFile(fileHandle);
+        assert(rc == success && "Closing the file should not fail.");
+        rc = rbfm->destroyFile(fileName);
+        assert(rc == success && "Destroying the file should not fail.");
+    }
+
+    cout << "RBF Test Case WidePages Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// byte j of page i in round r of the AsyncIO test
+char asyncByte(const unsigned i, const unsigned j, const unsigned r)
+{
+    return (char) (i * 7 + j % 13 + r);
+}
+
+// queue reads of the pages [first, first + count) of the file into buffers
+int queueBatchRead(FileHandle &fileHandle, PageBatch &batch, const unsigned first, const unsigned count, vector<char> &buffers)
+{
+    buffers.resize((size_t) PAGE_SIZE * count);
+    for (unsigned i = 0; i < count; i++) {
+        if (fileHandle.queueRead(batch, first + i, &buffers[(size_t) PAGE_SIZE * i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// wait for a batch queued by queueBatchRead() and check the pages against round r
+int checkBatchRead(PageBatch &batch, const unsigned first, const unsigned count, const vector<char> &buffers, const unsigned r)
+{
+    if (AsyncIOManager::instance()->submit(batch) != 0 || AsyncIOManager::instance()->wait(batch) != 0
+        || !AsyncIOManager::instance()->poll(batch)) {
+        return -1;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        for (unsigned j = 0; j < PAGE_SIZE; j++) {
+            if (buffers[(size_t) PAGE_SIZE * i + j] != asyncByte(first + i, j, r)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// writes every page of the file in one batch, more than the ring holds at once, then reads them back
+// with readPage(), in one batch, and in two batches waited for by two threads at the same time
+int checkPageBatches(FileHandle &fileHandle, const unsigned pages, const unsigned r)
+{
+    vector<char> buffers((size_t) PAGE_SIZE * pages);
+    PageBatch batch;
+    for (unsigned i = 0; i < pages; i++) {
+        for (unsigned j = 0; j < PAGE_SIZE; j++) {
+            buffers[(size_t) PAGE_SIZE * i + j] = asyncByte(i, j, r);
+        }
+        if (fileHandle.queueWrite(batch, i, &buffers[(size_t) PAGE_SIZE * i]) != 0) {
+            return -1;
+        }
+    }
+    if (AsyncIOManager::instance()->wait(batch) != 0 || batch.pending != 0) {
+        return -1;
+    }
+
+    char page[PAGE_SIZE];
+    for (unsigned i = 0; i < pages; i++) {
+        if (fileHandle.readPage(i, page) != 0) {
+            return -1;
+        }
+        for (unsigned j = 0; j < PAGE_SIZE; j++) {
+            if (page[j] != asyncByte(i, j, r)) {
+                return -1;
+            }
+        }
+    }
+    PageBatch all;
+    vector<char> allPages;
+    if (queueBatchRead(fileHandle, all, 0, pages, allPages) != 0 || checkBatchRead(all, 0, pages, allPages, r) != 0) {
+        return -1;
+    }
+
+    // a FileHandle isn't shared between threads, so both batches are queued here and only waited for apart
+    PageBatch firstHalf, secondHalf;
+    vector<char> firstPages, secondPages;
+    unsigned half = pages / 2;
+    if (queueBatchRead(fileHandle, firstHalf, 0, half, firstPages) != 0
+        || queueBatchRead(fileHandle, secondHalf, half, pages - half, secondPages) != 0) {
+        return -1;
+    }
+    int otherResult = -1;
+    thread other([&]() {
+        otherResult = checkBatchRead(secondHalf, half, pages - half, secondPages, r);
+    });
+    int result = checkBatchRead(firstHalf, 0, half, firstPages, r);
+    other.join();
+    if (result != 0 || otherResult != 0) {
+        return -1;
+    }
+
+    // a request that fails doesn't keep the others, or the batch, from completing
+    PageBatch failing;
+    char good[PAGE_SIZE];
+    char bad[PAGE_SIZE];
+    failing.addRead(FD_NOT_OPEN, 0, bad);
+    fileHandle.queueRead(failing, 1, good);
+    if (AsyncIOManager::instance()->wait(failing) == 0 || !AsyncIOManager::instance()->poll(failing)
+        || failing.requests[0].rc == 0 || failing.requests[1].rc != 0 || good[0] != asyncByte(1, 0, r)) {
+        return -1;
+    }
+    return 0;
+}
+
+int RBFTest_AsyncIO(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Queue Write / Queue Read **
+    // 2. AsyncIOManager submit / wait / poll **
+    // 3. AsyncIOManager useThreadPool **
+    // 4. Insert Records
+    cout << endl << "***** In RBF Test Case AsyncIO *****" << endl;
+
+    RC rc;
+    string fileName = "test_async";
+    const unsigned pages = AIO_QUEUE_DEPTH * 2 + 100;
+    AsyncIOManager *aio = AsyncIOManager::instance();
+
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    char page[PAGE_SIZE];
+    memset(page, 0, PAGE_SIZE);
+    for (unsigned i = 0; i < pages; i++) {
+        rc = fileHandle.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    // a small pool, so the batches really go to the disk
+    rc = PagedFileManager::instance()->setBufferPoolSize(16);
+    assert(rc == success && "Resizing the buffer pool should not fail.");
+
+    // the io_uring engine where the kernel has one, then the thread pool
+    cout << "Engine: " << (aio->usingIoUring() ? "io_uring" : "thread pool (no io_uring here)") << endl;
+    if (checkPageBatches(fileHandle, pages, 0) != 0) {
+        cout << "[FAIL] Pages written and read in batches should come back as they were written." << endl;
+        return -1;
+    }
+    rc = aio->useThreadPool();
+    assert(rc == success && "Switching to the thread pool while idle should not fail.");
+    cout << "Engine: " << (aio->usingIoUring() ? "io_uring" : "thread pool") << endl;
+    if (aio->usingIoUring() || checkPageBatches(fileHandle, pages, 1) != 0) {
+        cout << "[FAIL] Pages written and read in batches by the thread pool should come back as they were written." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // a batch of records lands on pages that have some already, those are written back through the thread pool
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    char record[PAGE_SIZE];
+    int recordSize;
+    vector<RID> rids(2000);
+    for (int i = 0; i < 2000; i += 2) {
+        prepareEmployee(i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    for (int i = 0; i < 2000; i += 4) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    unsigned pagesBefore = fileHandle.getNumberOfPages();
+    vector<vector<char> > records(1000, vector<char>(PAGE_SIZE));
+    vector<const void *> data;
+    for (int i = 0; i < 1000; i++) {
+        prepareEmployee(2 * i + 1, records[i].data(), &recordSize);
+        data.push_back(records[i].data());
+    }
+    vector<RID> batchRids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, batchRids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    unsigned onOldPages = 0;
+    char returned[PAGE_SIZE];
+    for (int i = 0; i < 1000; i++) {
+        if (batchRids[i].pageNum < pagesBefore) {
+            onOldPages++;
+        }
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, batchRids[i], returned);
+        prepareEmployee(2 * i + 1, record, &recordSize);
+        if (rc != success || memcmp(record, returned, recordSize) != 0) {
+            cout << "[FAIL] A record of the batch should read back as it was inserted." << endl;
+            return -1;
+        }
+    }
+    cout << "Pages before the batch: " << pagesBefore << ", records of the batch put on them: " << onOldPages << endl;
+    if (onOldPages == 0) {
+        cout << "[FAIL] The batch should have used the room the deletes left." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = PagedFileManager::instance()->setBufferPoolSize(BUFFER_POOL_FRAMES);
+    assert(rc == success && "Resizing the buffer pool should not fail.");
+
+    cout << "RBF Test Case AsyncIO Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// page i of round r of the page-level tests: every byte says which page and round it is
+void fillPage(char *page, const unsigned i, const unsigned r, const unsigned pageSize = PAGE_SIZE)
+{
+    for (unsigned j = 0; j < pageSize; j++) {
+        page[j] = (char) (i * 3 + j % 7 + r * 11);
+    }
+}
+
+bool pageIs(const char *page, const unsigned i, const unsigned r, const unsigned pageSize = PAGE_SIZE)
+{
+    for (unsigned j = 0; j < pageSize; j++) {
+        if (page[j] != (char) (i * 3 + j % 7 + r * 11)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// how many of the first pages of the file hold round r on disk, read past the buffer pool
+unsigned pagesOnDisk(const string &fileName, FileHandle &fileHandle, const unsigned pages, const unsigned r)
+{
+    ifstream file(fileName.c_str(), ios::binary);
+    char page[PAGE_SIZE];
+    unsigned count = 0;
+    for (unsigned i = 0; i < pages; i++) {
+        file.seekg((streamoff) fileHandle.physicalPageNum(i) * PAGE_SIZE);
+        file.read(page, PAGE_SIZE);
+        if (file && pageIs(page, i, r)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int RBFTest_BufferPool(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Write Page / Read Page through a pool smaller than the file **
+    // 2. Pin Page / Unpin Page **
+    // 3. Set Buffer Pool Size **
+    cout << endl << "***** In RBF Test Case BufferPool *****" << endl;
+
+    RC rc;
+    string fileName = "test_pool";
+    const unsigned frames = 8;
+    const unsigned pages = 40;
+    PagedFileManager *pfm = PagedFileManager::instance();
+    BufferPoolManager *bpm = BufferPoolManager::instance();
+
+    rbfm->destroyFile(fileName);
+    rc = pfm->setBufferPoolSize(frames);
+    assert(rc == success && "Resizing the buffer pool should not fail.");
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    char page[PAGE_SIZE];
+    for (unsigned i = 0; i < pages; i++) {
+        fillPage(page, i, 0);
+        rc = fileHandle.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    // rewriting every page dirties more frames than there are, the ones pushed out are written back
+    for (unsigned i = 0; i < pages; i++) {
+        fillPage(page, i, 1);
+        rc = fileHandle.writePage(i, page);
+        assert(rc == success && "Writing a page should not fail.");
+    }
+    unsigned onDisk = pagesOnDisk(fileName, fileHandle, pages, 1);
+    cout << "Pages: " << pages << ", frames: " << frames << ", rewritten pages on disk before closing: " << onDisk << endl;
+    if (onDisk < pages - frames || onDisk == pages) {
+        cout << "[FAIL] Evicted dirty frames should be written back, the frames still held should not be." << endl;
+        return -1;
+    }
+    for (unsigned i = 0; i < pages; i++) {
+        rc = fileHandle.readPage(i, page);
+        if (rc != success || !pageIs(page, i, 1)) {
+            cout << "[FAIL] A page should read back as last written, from a frame or from the disk." << endl;
+            return -1;
+        }
+    }
+
+    // with every frame pinned pages still read and write, straight from and to the disk
+    vector<PageNum> pinned;
+    for (unsigned i = 0; i < frames; i++) {
+        void *frameData;
+        rc = bpm->pinPage(fileHandle, fileHandle.physicalPageNum(i), frameData);
+        assert(rc == success && "Pinning a page should not fail.");
+        fillPage((char *) frameData, i, 2);
+        pinned.push_back(fileHandle.physicalPageNum(i));
+    }
+    rc = pfm->setBufferPoolSize(frames * 2);
+    assert(rc != success && "Resizing the buffer pool with pinned frames should fail.");
+    fillPage(page, pages - 1, 2);
+    rc = fileHandle.writePage(pages - 1, page);
+    assert(rc == success && "Writing a page with every frame pinned should not fail.");
+    rc = fileHandle.readPage(pages - 1, page);
+    if (rc != success || !pageIs(page, pages - 1, 2) || pagesOnDisk(fileName, fileHandle, pages, 2) != 1) {
+        cout << "[FAIL] With every frame pinned a page should go to the disk directly." << endl;
+        return -1;
+    }
+    for (unsigned i = 0; i < frames; i++) {
+        rc = bpm->unpinPage(fileHandle, pinned[i], true);
+        assert(rc == success && "Unpinning a page should not fail.");
+    }
+    rc = bpm->unpinPage(fileHandle, pinned[0], false);
+    assert(rc != success && "Unpinning a page that isn't pinned should fail.");
+
+    // closing writes back whatever is still dirty
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    onDisk = pagesOnDisk(fileName, fileHandle, pages, 2);
+    cout << "Pages written through pinned frames, on disk after closing: " << onDisk << endl;
+    if (onDisk != frames + 1 || pagesOnDisk(fileName, fileHandle, pages, 1) != pages - frames - 1) {
+        cout << "[FAIL] Closing the file should write back every dirty frame." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = pfm->setBufferPoolSize(BUFFER_POOL_FRAMES);
+    assert(rc == success && "Resizing the buffer pool should not fail.");
+
+    cout << "RBF Test Case BufferPool Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// the header of a file as it is on disk right now
+FileHeader headerOnDisk(const string &fileName)
+{
+    FileHeader header;
+    memset(&header, 0, sizeof(FileHeader));
+    ifstream file(fileName.c_str(), ios::binary);
+    file.read((char *) &header, sizeof(FileHeader));
+    return header;
+}
+
+int RBFTest_PositionalIO(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Read Page / Write Page through two handles of one file **
+    // 2. Sync **
+    cout << endl << "***** In RBF Test Case PositionalIO *****" << endl;
+
+    RC rc;
+    string fileName = "test_positional";
+    const unsigned pages = 20;
+
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle first, second;
+    rc = rbfm->openFile(fileName, first);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->openFile(fileName, second);
+    assert(rc == success && "Opening the file twice should not fail.");
+
+    char page[PAGE_SIZE];
+    for (unsigned i = 0; i < pages; i++) {
+        fillPage(page, i, 0);
+        rc = first.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    // each handle has a descriptor of its own, both write wherever they like
+    for (unsigned i = 0; i < pages; i++) {
+        fillPage(page, i, 1);
+        rc = (i % 2 == 0 ? first : second).writePage(i, page);
+        assert(rc == success && "Writing a page should not fail.");
+    }
+    for (unsigned i = 0; i < pages; i++) {
+        rc = (i % 2 == 0 ? second : first).readPage(i, page);
+        if (rc != success || !pageIs(page, i, 1)) {
+            cout << "[FAIL] A page written through one handle should read back through the other." << endl;
+            return -1;
+        }
+    }
+    rc = first.readPage(pages, page);
+    assert(rc != success && "Reading past the last page should fail.");
+    rc = second.writePage(pages, page);
+    assert(rc != success && "Writing past the last page should fail.");
+
+    // nothing is forced out page by page, sync() is where the pages a handle wrote and the header reach the file
+    unsigned beforeSync = pagesOnDisk(fileName, first, pages, 1);
+    rc = second.sync();
+    assert(rc == success && "Syncing the file should not fail.");
+    unsigned afterOneSync = pagesOnDisk(fileName, first, pages, 1);
+    rc = first.sync();
+    assert(rc == success && "Syncing the file should not fail.");
+    unsigned afterBothSyncs = pagesOnDisk(fileName, first, pages, 1);
+    cout << "Rewritten pages on disk before sync: " << beforeSync << ", after syncing one handle: " << afterOneSync
+         << ", after syncing both: " << afterBothSyncs << ", pages in the header on disk: " << headerOnDisk(fileName).pageCount << endl;
+    if (beforeSync == pages || afterOneSync != pages / 2 || afterBothSyncs != pages || headerOnDisk(fileName).pageCount != pages) {
+        cout << "[FAIL] Sync should put the pages written through the handle, and the header, into the file." << endl;
+        return -1;
+    }
+
+    // closing one handle leaves the other working
+    rc = rbfm->closeFile(second);
+    assert(rc == success && "Closing the file should not fail.");
+    fillPage(page, 0, 2);
+    rc = first.writePage(0, page);
+    assert(rc == success && "Writing a page should not fail.");
+    rc = rbfm->closeFile(first);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, first);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = first.readPage(0, page);
+    if (rc != success || !pageIs(page, 0, 2) || first.getNumberOfPages() != pages
+        || pagesOnDisk(fileName, first, pages, 1) != pages - 1) {
+        cout << "[FAIL] The pages should be in the file as last written after it is closed." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(first);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case PositionalIO Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_FileHeader(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Get Number Of Pages **
+    // 2. Collect Counter Values **
+    // 3. Set Index Root / Get Index Root **
+    // 4. Open File on a bad header **
+    cout << endl << "***** In RBF Test Case FileHeader *****" << endl;
+
+    RC rc;
+    string fileName = "test_header";
+
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHeader header = headerOnDisk(fileName);
+    if (header.magic != FILE_MAGIC || header.version != FILE_FORMAT_VERSION || header.pageSize != PAGE_SIZE
+        || header.pageCount != 0 || header.indexRoot != NULL_PAGE) {
+        cout << "[FAIL] A new file should start with a header describing an empty file." << endl;
+        return -1;
+    }
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    char page[PAGE_SIZE];
+    for (unsigned i = 0; i < 10; i++) {
+        fillPage(page, i, 0);
+        rc = fileHandle.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    for (unsigned i = 0; i < 5; i++) {
+        rc = fileHandle.readPage(i, page);
+        assert(rc == success && "Reading a page should not fail.");
+    }
+    for (unsigned i = 0; i < 3; i++) {
+        rc = fileHandle.writePage(i, page);
+        assert(rc == success && "Writing a page should not fail.");
+    }
+    // the page count comes from the header, asking for it reads nothing
+    unsigned readCount, writeCount, appendCount;
+    unsigned pageCount = 0;
+    for (unsigned i = 0; i < 100; i++) {
+        pageCount = fileHandle.getNumberOfPages();
+    }
+    fileHandle.collectCounterValues(readCount, writeCount, appendCount);
+    cout << "Pages: " << pageCount << ", reads: " << readCount << ", writes: " << writeCount << ", appends: " << appendCount << endl;
+    if (pageCount != 10 || readCount != 5 || writeCount != 3 || appendCount != 10) {
+        cout << "[FAIL] The header should count every page read, written and appended, and nothing else." << endl;
+        return -1;
+    }
+    rc = fileHandle.setIndexRoot(7);
+    assert(rc == success && "Setting the index root should not fail.");
+
+    // the counters, the page count and the root survive the file being closed
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    header = headerOnDisk(fileName);
+    if (header.pageCount != 10 || header.readPageCounter != 5 || header.writePageCounter != 3
+        || header.appendPageCounter != 10 || header.indexRoot != 7) {
+        cout << "[FAIL] Closing the file should write the header back." << endl;
+        return -1;
+    }
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    fileHandle.collectCounterValues(readCount, writeCount, appendCount);
+    if (fileHandle.getNumberOfPages() != 10 || readCount != 5 || writeCount != 3 || appendCount != 10
+        || fileHandle.getIndexRoot() != 7) {
+        cout << "[FAIL] A file opened again should pick up where its header left off." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // a file whose first page isn't a header of this format is refused
+    header.magic = 0;
+    fstream file(fileName.c_str(), ios::binary | ios::in | ios::out);
+    file.write((const char *) &header, sizeof(FileHeader));
+    file.close();
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc != success && "Opening a file without a valid header should fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case FileHeader Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_FreeSpaceMap(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Insert Record into room that deletes left **
+    // 2. Find Page With Space **
+    // 3. Delete Record
+    cout << endl << "***** In RBF Test Case FreeSpaceMap *****" << endl;
+
+    RC rc;
+    string fileName = "test_fsm";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+
+    // records of one size fill their pages so that none is left with room for another
+    char record[PAGE_SIZE];
+    int recordSize;
+    map<PageNum, vector<RID> > ridsOnPage;
+    int id = 0;
+    while (fileHandle.getNumberOfPages() < 21) {
+        recordSize = prepareText(id++, 200, 'f', record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        ridsOnPage[rid.pageNum].push_back(rid);
+    }
+    const unsigned pages = fileHandle.getNumberOfPages();
+    const unsigned perPage = ridsOnPage[0].size();
+    PageNum pageNum;
+    rc = fileHandle.findPageWithSpace(PAGE_SIZE, pageNum);
+    assert(rc != success && "No page should have room for a whole page.");
+
+    // emptied pages are found through the map and filled before the file grows
+    PageNum emptied[] = {3, 7, 12};
+    for (PageNum page : emptied) {
+        for (const RID &rid : ridsOnPage[page]) {
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+            assert(rc == success && "Deleting a record should not fail.");
+        }
+    }
+    unsigned readBefore, writeBefore, appendBefore, readAfter, writeAfter, appendAfter;
+    fileHandle.collectCounterValues(readBefore, writeBefore, appendBefore);
+    map<PageNum, unsigned> landedOn;
+    for (unsigned i = 0; i < 3 * perPage; i++) {
+        recordSize = prepareText(id++, 200, 'g', record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        landedOn[rid.pageNum]++;
+    }
+    fileHandle.collectCounterValues(readAfter, writeAfter, appendAfter);
+    cout << "Pages: " << pages << ", records per page: " << perPage << ", pages read for " << 3 * perPage
+         << " inserts: " << readAfter - readBefore << endl;
+    if (fileHandle.getNumberOfPages() != pages || landedOn.size() != 3 || landedOn[3] != perPage
+        || landedOn[7] != perPage || landedOn[12] != perPage || readAfter - readBefore > 3 * perPage) {
+        cout << "[FAIL] Inserts should fill the emptied pages, reading only the page each one goes to." << endl;
+        return -1;
+    }
+
+    // the map is kept in the file, a page emptied before closing is found after opening it again
+    for (const RID &rid : ridsOnPage[5]) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = fileHandle.findPageWithSpace(recordSize + SLOT_SIZE, pageNum);
+    if (rc != success || pageNum != 5) {
+        cout << "[FAIL] The page emptied before closing should be the first one with room." << endl;
+        return -1;
+    }
+    RID rid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    if (rid.pageNum != 5) {
+        cout << "[FAIL] An insert after opening the file again should go to the emptied page." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case FreeSpaceMap Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_MmapRead(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Open File MmapReadOnly **
+    // 2. Scan, Read Record through the mapping after the file grew **
+    // 3. Insert / Update / Delete Record through a read-only handle **
+    cout << endl << "***** In RBF Test Case MmapRead *****" << endl;
+
+    RC rc;
+    string fileName = "test_mmap";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle, mappedHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    vector<string> attributeNames;
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Age");
+
+    char record[PAGE_SIZE];
+    int recordSize;
+    vector<RID> rids;
+    for (int i = 0; i < 500; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+    }
+    rc = rbfm->openFile(fileName, mappedHandle, MmapReadOnly);
+    assert(rc == success && "Opening the file mapped should not fail.");
+    vector<string> serial, mapped;
+    scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, serial);
+    scanRecords(rbfm, mappedHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, mapped);
+    if (mapped != serial || mappedHandle.mappedPage(0) == nullptr) {
+        cout << "[FAIL] A scan through the mapping should return what the plain scan does." << endl;
+        return -1;
+    }
+
+    // a read-only handle changes nothing
+    RID rid;
+    char page[PAGE_SIZE];
+    rc = rbfm->insertRecord(mappedHandle, recordDescriptor, record, rid);
+    assert(rc != success && "Inserting through a read-only handle should fail.");
+    rc = rbfm->updateRecord(mappedHandle, recordDescriptor, record, rids[0]);
+    assert(rc != success && "Updating through a read-only handle should fail.");
+    rc = rbfm->deleteRecord(mappedHandle, recordDescriptor, rids[0]);
+    assert(rc != success && "Deleting through a read-only handle should fail.");
+    rc = mappedHandle.appendPage(page);
+    assert(rc != success && "Appending through a read-only handle should fail.");
+
+    // the file grows past the mapping and a page inside it changes, both only in the buffer pool so far
+    unsigned mappedPages = mappedHandle.getNumberOfPages();
+    for (int i = 500; i < 5000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+    }
+    prepareEmployee(29, record, &recordSize);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[1]);
+    assert(rc == success && "Updating a record should not fail.");
+    scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, serial);
+    scanRecords(rbfm, mappedHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, mapped);
+    cout << "Pages when mapped: " << mappedPages << ", pages now: " << mappedHandle.getNumberOfPages()
+         << ", records scanned: " << serial.size() << " plain, " << mapped.size() << " mapped" << endl;
+    if (mapped != serial || serial.size() != 5000 || mappedHandle.getNumberOfPages() <= mappedPages) {
+        cout << "[FAIL] A scan through the mapping should see the pages added and changed since it was made." << endl;
+        return -1;
+    }
+    char returned[PAGE_SIZE];
+    prepareEmployee(4999, record, &recordSize);
+    rc = rbfm->readRecord(mappedHandle, recordDescriptor, rids[4999], returned);
+    if (rc != success || memcmp(record, returned, recordSize) != 0) {
+        cout << "[FAIL] A record on a page added since the mapping was made should read through it." << endl;
+        return -1;
+    }
+
+    rc = rbfm->closeFile(mappedHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case MmapRead Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// what scanRecords() returns for an employee record projected on EmpName, Age
+string projectedEmployee(const RID &rid, const char *record)
+{
+    int size = sizeof(int);
+    if (!(record[0] & 0x80)) {
+        int nameLength;
+        memcpy(&nameLength, record + 1, sizeof(int));
+        size += sizeof(int) + nameLength;
+    }
+    return string((const char *) &rid.pageNum, sizeof(PageNum)) + string((const char *) &rid.slotNum, sizeof(SlotNum))
+           + string(1, (char) (record[0] & 0x80)) + string(record + 1, size);
+}
+
+int RBFTest_ReadAhead(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Scan with read-ahead windows from none to larger than the buffer pool **
+    // 2. Update Record, the pages stay dirty in the pool while scanned
+    cout << endl << "***** In RBF Test Case ReadAhead *****" << endl;
+
+    RC rc;
+    string fileName = "test_read_ahead";
+    rbfm->destroyFile(fileName);
+    rc = PagedFileManager::instance()->setBufferPoolSize(16);
+    assert(rc == success && "Resizing the buffer pool should not fail.");
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    vector<string> attributeNames;
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Age");
+
+    char record[PAGE_SIZE];
+    int recordSize;
+    map<pair<PageNum, SlotNum>, int> employees;
+    vector<RID> rids;
+    for (int i = 0; i < 6000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        employees[make_pair(rid.pageNum, rid.slotNum)] = i;
+        rids.push_back(rid);
+    }
+    // records of the same size and another age replace some on every page, last written only to the pool
+    for (int i = 0; i < 6000; i += 37) {
+        int replacement = i + 7 * 11 * 30 * 13;
+        prepareEmployee(replacement, record, &recordSize);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+        employees[make_pair(rids[i].pageNum, rids[i].slotNum)] = replacement;
+    }
+    vector<string> expected;
+    for (auto it = employees.begin(); it != employees.end(); it++) {
+        prepareEmployee(it->second, record, &recordSize);
+        RID rid;
+        rid.pageNum = it->first.first;
+        rid.slotNum = it->first.second;
+        expected.push_back(projectedEmployee(rid, record));
+    }
+
+    unsigned windows[] = {0, 1, SCAN_READ_AHEAD_START, SCAN_READ_AHEAD_PAGES, 64};
+    cout << "Pages: " << fileHandle.getNumberOfPages() << ", frames: 16" << endl;
+    for (unsigned window : windows) {
+        RBFM_ScanIterator rbfmScanIterator;
+        rc = rbfm->scan(fileHandle, recordDescriptor, ScanFilter(), attributeNames, rbfmScanIterator);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        rc = rbfmScanIterator.setReadAhead(window);
+        assert(rc == success && "Setting the read-ahead should not fail.");
+        RID rid;
+        char data[PAGE_SIZE];
+        vector<string> scanned;
+        while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+            int size = sizeof(int);
+            if (!(data[0] & 0x80)) {
+                int nameLength;
+                memcpy(&nameLength, data + 1, sizeof(int));
+                size += sizeof(int) + nameLength;
+            }
+            scanned.push_back(string((const char *) &rid.pageNum, sizeof(PageNum))
+                              + string((const char *) &rid.slotNum, sizeof(SlotNum)) + string(data, 1 + size));
+        }
+        rbfmScanIterator.close();
+        cout << "Read-ahead up to " << window << " pages: " << scanned.size() << " records" << endl;
+        if (scanned != expected) {
+            cout << "[FAIL] A scan should return the same records whatever it reads ahead." << endl;
+            return -1;
+        }
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = PagedFileManager::instance()->setBufferPoolSize(BUFFER_POOL_FRAMES);
+    assert(rc == success && "Resizing the buffer pool should not fail.");
+
+    cout << "RBF Test Case ReadAhead Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_Extents(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Append Page into preallocated extents **
+    // 2. Set Extent Size **
+    cout << endl << "***** In RBF Test Case Extents *****" << endl;
+
+    RC rc;
+    string fileName = "test_extents";
+    const unsigned extent = 16;
+    const unsigned pages = 200;
+    PagedFileManager *pfm = PagedFileManager::instance();
+    rc = pfm->setExtentSize(0);
+    assert(rc != success && "An empty extent should be refused.");
+    rc = pfm->setExtentSize(extent);
+    assert(rc == success && "Setting the extent size should not fail.");
+
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // the file grows in steps, never by less than it needs or by more than an extent past it
+    char page[PAGE_SIZE];
+    unsigned growths = 0;
+    long lastSize = getFileSize(fileName);
+    for (unsigned i = 0; i < pages; i++) {
+        fillPage(page, i, 0);
+        rc = fileHandle.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+        long size = getFileSize(fileName);
+        long used = (long) (fileHandle.physicalPageNum(i) + 1) * PAGE_SIZE;
+        if (size < used || size > used + (long) extent * PAGE_SIZE) {
+            cout << "[FAIL] The file should have room for its pages and at most an extent more, not " << size << " bytes." << endl;
+            return -1;
+        }
+        if (size != lastSize) {
+            growths++;
+            lastSize = size;
+        }
+    }
+    cout << "Pages appended: " << pages << ", times the file grew: " << growths << ", bytes: " << lastSize << endl;
+    if (growths > pages / extent + 8) {
+        cout << "[FAIL] The file should grow an extent at a time." << endl;
+        return -1;
+    }
+
+    // room reserved before closing is used after opening again, the pages are all there
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    long reserved = getFileSize(fileName);
+    unsigned reusedAppends = 0;
+    while (getFileSize(fileName) == reserved
+           && (long) (fileHandle.physicalPageNum(fileHandle.getNumberOfPages()) + 1) * PAGE_SIZE <= reserved) {
+        fillPage(page, fileHandle.getNumberOfPages(), 0);
+        rc = fileHandle.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+        reusedAppends++;
+    }
+    cout << "Pages appended into room reserved before closing: " << reusedAppends << endl;
+    if (getFileSize(fileName) != reserved) {
+        cout << "[FAIL] Appends should fill the room reserved before the file was closed." << endl;
+        return -1;
+    }
+    for (unsigned i = 0; i < fileHandle.getNumberOfPages(); i++) {
+        rc = fileHandle.readPage(i, page);
+        if (rc != success || !pageIs(page, i, 0)) {
+            cout << "[FAIL] Every appended page should read back." << endl;
+            return -1;
+        }
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = pfm->setExtentSize(FILE_EXTENT_PAGES);
+    assert(rc == success && "Setting the extent size should not fail.");
+
+    cout << "RBF Test Case Extents Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_MemoryStorage(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Create File on MemoryStorage, and as the default storage **
+    // 2. Insert / Update / Delete / Read Record, Scan on it
+    // 3. Close and open it again, Destroy File **
+    cout << endl << "***** In RBF Test Case MemoryStorage *****" << endl;
+
+    RC rc;
+    string fileName = "test_memory";
+    PagedFileManager *pfm = PagedFileManager::instance();
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName, MemoryStorage);
+    assert(rc == success && "Creating the file in memory should not fail.");
+    rc = rbfm->createFile(fileName, MemoryStorage);
+    assert(rc != success && "Creating a file that exists should fail.");
+    if (!pfm->fileExists(fileName) || ifstream(fileName.c_str()).good()) {
+        cout << "[FAIL] A file in memory should exist without anything on disk." << endl;
+        return -1;
+    }
+
+    FileHandle fileHandle, otherHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    vector<string> attributeNames;
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Age");
+    char record[PAGE_SIZE];
+    int recordSize;
+    map<pair<PageNum, SlotNum>, int> employees;
+    vector<RID> rids;
+    for (int i = 0; i < 3000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        employees[make_pair(rid.pageNum, rid.slotNum)] = i;
+        rids.push_back(rid);
+    }
+    for (int i = 0; i < 3000; i += 3) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        employees.erase(make_pair(rids[i].pageNum, rids[i].slotNum));
+    }
+    for (int i = 1; i < 3000; i += 30) {
+        int replacement = i + 7 * 11 * 30 * 13;
+        prepareEmployee(replacement, record, &recordSize);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+        employees[make_pair(rids[i].pageNum, rids[i].slotNum)] = replacement;
+    }
+    vector<string> expected;
+    for (auto it = employees.begin(); it != employees.end(); it++) {
+        prepareEmployee(it->second, record, &recordSize);
+        RID rid;
+        rid.pageNum = it->first.first;
+        rid.slotNum = it->first.second;
+        expected.push_back(projectedEmployee(rid, record));
+    }
+
+    // every handle of the file shares its pages, and they outlive the handles until the file is destroyed
+    rc = rbfm->openFile(fileName, otherHandle);
+    assert(rc == success && "Opening the file twice should not fail.");
+    vector<string> scanned, otherScanned;
+    scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, scanned);
+    scanRecords(rbfm, otherHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, otherScanned);
+    cout << "Records in memory: " << scanned.size() << ", through the other handle: " << otherScanned.size()
+         << ", pages: " << fileHandle.getNumberOfPages() << endl;
+    if (scanned != expected || otherScanned != expected || fileHandle.mappedPage(0) == nullptr) {
+        cout << "[FAIL] Both handles of a file in memory should scan what was inserted, updated and deleted." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(otherHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, scanned);
+    char returned[PAGE_SIZE];
+    prepareEmployee(2999, record, &recordSize);
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[2999], returned);
+    if (scanned != expected || rc != success || memcmp(record, returned, recordSize) != 0) {
+        cout << "[FAIL] A file in memory should keep its records while no handle has it open." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // destroying it drops the pages, a file created under the name again starts empty
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc != success && "Opening a destroyed file should fail.");
+    rc = pfm->setDefaultStorage(MemoryStorage);
+    assert(rc == success && "Setting the default storage should not fail.");
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = pfm->setDefaultStorage(PosixStorage);
+    assert(rc == success && "Setting the default storage should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    scanRecords(rbfm, fileHandle, recordDescriptor, ScanFilter(), attributeNames, SerialScan, scanned);
+    if (fileHandle.getNumberOfPages() != 0 || !scanned.empty() || ifstream(fileName.c_str()).good()) {
+        cout << "[FAIL] A file created in memory again should start empty and stay off the disk." << endl;
+        return -1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case MemoryStorage Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_FreeSlots(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Insert Record into the slots that deletes freed **
+    // 2. Delete Record, Read Record, Scan
+    cout << endl << "***** In RBF Test Case FreeSlots *****" << endl;
+
+    RC rc;
+    string fileName = "test_free_slots";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+
+    // records of one size, all on the first page with room to spare
+    const int slots = 20;
+    char record[PAGE_SIZE];
+    int recordSize;
+    map<SlotNum, string> onSlot;
+    for (int id = 0; id < slots; id++) {
+        recordSize = prepareText(id, 100, 'a', record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        if (rid.pageNum != 0 || rid.slotNum != (SlotNum) id) {
+            cout << "[FAIL] Records inserted into an empty file should take the slots of the first page in order." << endl;
+            return -1;
+        }
+        onSlot[rid.slotNum] = string(record, recordSize);
+    }
+
+    // every round frees five slots spread over the directory, and the next five inserts take exactly those
+    char page[PAGE_SIZE];
+    int id = slots;
+    for (int round = 0; round < 5; round++) {
+        set<SlotNum> freed, taken;
+        for (int k = 0; k < 5; k++) {
+            RID rid;
+            rid.pageNum = 0;
+            rid.slotNum = (SlotNum) ((round * 7 + k * 4) % slots);
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+            assert(rc == success && "Deleting a record should not fail.");
+            freed.insert(rid.slotNum);
+            onSlot.erase(rid.slotNum);
+        }
+        for (int k = 0; k < 5; k++) {
+            recordSize = prepareText(id++, 100, 'b' + round, record);
+            RID rid;
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+            assert(rc == success && "Inserting a record should not fail.");
+            if (rid.pageNum != 0) {
+                cout << "[FAIL] A record should go into a slot its page freed, not onto another page." << endl;
+                return -1;
+            }
+            taken.insert(rid.slotNum);
+            onSlot[rid.slotNum] = string(record, recordSize);
+        }
+        rc = fileHandle.readPage(0, page);
+        assert(rc == success && "Reading a page should not fail.");
+        if (taken != freed || rbfm->getTotalUsedSlotsNum(page) != slots || fileHandle.getNumberOfPages() != 1) {
+            cout << "[FAIL] Inserts should reuse the freed slots, leaving the slot directory at " << slots << " slots." << endl;
+            return -1;
+        }
+    }
+
+    // with no slot free, the directory grows by one
+    recordSize = prepareText(id++, 100, 'z', record);
+    RID rid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    onSlot[rid.slotNum] = string(record, recordSize);
+    rc = fileHandle.readPage(0, page);
+    assert(rc == success && "Reading a page should not fail.");
+    cout << "Slots after 25 deletes and 26 inserts: " << rbfm->getTotalUsedSlotsNum(page) << endl;
+    if (rid.pageNum != 0 || rid.slotNum != (SlotNum) slots || rbfm->getTotalUsedSlotsNum(page) != slots + 1) {
+        cout << "[FAIL] An insert with no free slot should add one to the end of the directory." << endl;
+        return -1;
+    }
+
+    // every record reads back from the slot it was given, and a scan sees each one once
+    for (auto it = onSlot.begin(); it != onSlot.end(); it++) {
+        rid.pageNum = 0;
+        rid.slotNum = it->first;
+        unsigned pagesRead;
+        if (readText(rbfm, fileHandle, recordDescriptor, rid, it->second, pagesRead) != success) {
+            cout << "[FAIL] Record on slot " << rid.slotNum << " should read back as inserted." << endl;
+            return -1;
+        }
+    }
+    map<int, int> ids;
+    scanIds(rbfm, fileHandle, recordDescriptor, ids);
+    int scannedOnce = 0;
+    for (auto it = onSlot.begin(); it != onSlot.end(); it++) {
+        int expectedId;
+        memcpy(&expectedId, it->second.data() + 1, sizeof(int));
+        scannedOnce += ids[expectedId] == 1 ? 1 : 0;
+    }
+    if (ids.size() != onSlot.size() || scannedOnce != (int) onSlot.size()) {
+        cout << "[FAIL] A scan should return every live record once." << endl;
+        return -1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case FreeSlots Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// the bytes between the page header and the slot directory, where the records are
+string recordArea(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const PageNum pageNum)
+{
+    char page[PAGE_SIZE];
+    RC rc = fileHandle.readPage(pageNum, page);
+    assert(rc == success && "Reading a page should not fail.");
+    const int headerSize = 24;
+    return string(page + headerSize, PAGE_SIZE - headerSize - rbfm->getTotalUsedSlotsNum(page) * 8);
+}
+
+int RBFTest_Compaction(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Delete Record, the records around it stay where they are until the room is needed **
+    // 2. Insert / Update Record into the room holes left, compacting the page **
+    // 3. Read Record, Scan after mixed deletes and inserts
+    cout << endl << "***** In RBF Test Case Compaction *****" << endl;
+
+    RC rc;
+    string fileName = "test_compaction";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+
+    // two full pages of records of one size
+    char record[PAGE_SIZE];
+    int recordSize;
+    map<pair<PageNum, SlotNum>, string> live;
+    map<PageNum, vector<RID> > ridsOnPage;
+    int id = 0;
+    while (fileHandle.getNumberOfPages() < 3) {
+        recordSize = prepareText(id++, 300, 'a', record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        ridsOnPage[rid.pageNum].push_back(rid);
+        live[make_pair(rid.pageNum, rid.slotNum)] = string(record, recordSize);
+    }
+    const unsigned perPage = ridsOnPage[0].size();
+
+    // a few deletes leave holes, none of the records around them moves
+    string before = recordArea(rbfm, fileHandle, 0);
+    for (unsigned i = 1; i < 7; i += 2) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, ridsOnPage[0][i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        live.erase(make_pair((PageNum) 0, ridsOnPage[0][i].slotNum));
+    }
+    if (recordArea(rbfm, fileHandle, 0) != before) {
+        cout << "[FAIL] Deleting a few records should leave the other records of the page where they are." << endl;
+        return -1;
+    }
+
+    // a record larger than any one hole still fits in all of them together
+    recordSize = prepareText(id++, 900, 'b', record);
+    RID rid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    live[make_pair(rid.pageNum, rid.slotNum)] = string(record, recordSize);
+    cout << "Records per page: " << perPage << ", a record three holes long went to page " << rid.pageNum << endl;
+    if (rid.pageNum != 0 || fileHandle.getNumberOfPages() != 3) {
+        cout << "[FAIL] A record that fits in the holes of a page together should go onto that page." << endl;
+        return -1;
+    }
+
+    // once half of a page is dead it is compacted right away, and then takes a record of all that room
+    for (unsigned i = 0; i < 7; i++) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, ridsOnPage[1][i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        live.erase(make_pair((PageNum) 1, ridsOnPage[1][i].slotNum));
+    }
+    string compacted = recordArea(rbfm, fileHandle, 1);
+    const unsigned storedSize = 4 * sizeof(int) + 300;
+    unsigned packed = 0;
+    for (unsigned i = 0; i < perPage - 7; i++) {
+        packed += compacted.compare(i * storedSize + 4 * sizeof(int), 300, string(300, 'a')) == 0 ? 1 : 0;
+    }
+    if (packed != perPage - 7 || compacted.find_first_not_of((char) EMPTY_BYTE, packed * storedSize) != string::npos) {
+        cout << "[FAIL] A page half of which was deleted should have its records packed at its start." << endl;
+        return -1;
+    }
+    recordSize = prepareText(id++, 2300, 'c', record);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    live[make_pair(rid.pageNum, rid.slotNum)] = string(record, recordSize);
+    if (rid.pageNum != 1 || fileHandle.getNumberOfPages() != 3) {
+        cout << "[FAIL] A compacted page should take a record of all the room it got back." << endl;
+        return -1;
+    }
+
+    // an update that grows a record uses the holes of its own page, the record keeps its RID
+    for (unsigned i = 7; i < 11; i += 2) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, ridsOnPage[0][i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        live.erase(make_pair((PageNum) 0, ridsOnPage[0][i].slotNum));
+    }
+    recordSize = prepareText(0, 900, 'd', record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, ridsOnPage[0][0]);
+    assert(rc == success && "Updating a record should not fail.");
+    live[make_pair((PageNum) 0, ridsOnPage[0][0].slotNum)] = string(record, recordSize);
+    if (recordArea(rbfm, fileHandle, 0).find(string(900, 'd')) == string::npos || fileHandle.getNumberOfPages() != 3) {
+        cout << "[FAIL] A record that grows should stay on its page when the holes there have the room." << endl;
+        return -1;
+    }
+
+    // many more deletes and inserts of all sizes, the file only grows for what is live
+    vector<pair<PageNum, SlotNum> > order;
+    for (auto it = live.begin(); it != live.end(); it++) {
+        order.push_back(it->first);
+    }
+    int liveBytes = 0;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 3 != 2 && !order.empty()) {
+            unsigned victim = (unsigned) (i * 7919) % order.size();
+            rid.pageNum = order[victim].first;
+            rid.slotNum = order[victim].second;
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+            assert(rc == success && "Deleting a record should not fail.");
+            live.erase(order[victim]);
+            order[victim] = order.back();
+            order.pop_back();
+        }
+        recordSize = prepareText(id++, 50 + i * 131 % 1500, 'e' + i % 20, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        order.push_back(make_pair(rid.pageNum, rid.slotNum));
+        live[order.back()] = string(record, recordSize);
+    }
+    for (auto it = live.begin(); it != live.end(); it++) {
+        // the null byte isn't stored, two field ends and a slot are
+        liveBytes += it->second.size() - 1 + 4 * sizeof(int);
+    }
+    cout << "Live records after the mixed deletes and inserts: " << live.size() << ", " << liveBytes
+         << " bytes on " << fileHandle.getNumberOfPages() << " pages" << endl;
+    if (fileHandle.getNumberOfPages() > (unsigned) liveBytes / (PAGE_SIZE / 2) + 1) {
+        cout << "[FAIL] The room deletes left should be filled before the file grows." << endl;
+        return -1;
+    }
+
+    // every live record reads back, and a scan sees each one once
+    for (auto it = live.begin(); it != live.end(); it++) {
+        rid.pageNum = it->first.first;
+        rid.slotNum = it->first.second;
+        unsigned pagesRead;
+        if (readText(rbfm, fileHandle, recordDescriptor, rid, it->second, pagesRead) != success) {
+            cout << "[FAIL] Record <" << rid.pageNum << ", " << rid.slotNum << "> should read back as inserted." << endl;
+            return -1;
+        }
+    }
+    map<int, int> ids;
+    scanIds(rbfm, fileHandle, recordDescriptor, ids);
+    int scannedOnce = 0;
+    for (auto it = live.begin(); it != live.end(); it++) {
+        int expectedId;
+        memcpy(&expectedId, it->second.data() + 1, sizeof(int));
+        scannedOnce += ids[expectedId] == 1 ? 1 : 0;
+    }
+    if (ids.size() != live.size() || scannedOnce != (int) live.size()) {
+        cout << "[FAIL] A scan should return every live record once." << endl;
+        return -1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Compaction Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// field i of a record in the API format, false when it is NULL
+bool fieldOf(const vector<Attribute> &recordDescriptor, const char *record, const unsigned i, string &field)
+{
+    const char *data = record + getActualByteForNullsIndicator(recordDescriptor.size());
+    for (unsigned j = 0; j <= i; j++) {
+        if (record[j / 8] & (0x80 >> (j % 8))) {
+            if (j == i) {
+                return false;
+            }
+            continue;
+        }
+        int size = sizeof(int);
+        if (recordDescriptor[j].type == TypeVarChar) {
+            int length;
+            memcpy(&length, data, sizeof(int));
+            size += length;
+        }
+        if (j == i) {
+            field.assign(data, size);
+            return true;
+        }
+        data += size;
+    }
+    return false;
+}
+
+// the size of a record in the API format
+int recordSizeOf(const vector<Attribute> &recordDescriptor, const char *record)
+{
+    int size = getActualByteForNullsIndicator(recordDescriptor.size());
+    string field;
+    for (unsigned i = 0; i < recordDescriptor.size(); i++) {
+        if (fieldOf(recordDescriptor, record, i, field)) {
+            size += field.size();
+        }
+    }
+    return size;
+}
+
+// the attributes of a record in the API format, projected in the order asked for
+string projectedFields(const vector<Attribute> &recordDescriptor, const string &record, const vector<unsigned> &projected)
+{
+    string nulls(getActualByteForNullsIndicator(projected.size()), '\0');
+    string fields;
+    for (unsigned k = 0; k < projected.size(); k++) {
+        string field;
+        if (fieldOf(recordDescriptor, record.data(), projected[k], field)) {
+            fields += field;
+        }
+        else {
+            nulls[k / 8] |= (char) (0x80 >> (k % 8));
+        }
+    }
+    return nulls + fields;
+}
+
+int RBFTest_ReadAttribute(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Read Attribute of every field, after NULL fields and through beacons **
+    // 2. Read Attribute of an unknown attribute or a deleted record **
+    // 3. Scan, projecting attributes out of order **
+    cout << endl << "***** In RBF Test Case ReadAttribute *****" << endl;
+
+    RC rc;
+    string fileName = "test_read_attribute";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // full pages of employees, NULL names and salaries among them, then every fourth one grows and some have to move
+    char record[PAGE_SIZE];
+    int recordSize;
+    vector<RID> rids;
+    vector<string> records;
+    for (int i = 0; i < 400; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+        records.push_back(string(record, recordSize));
+    }
+    const unsigned pages = fileHandle.getNumberOfPages();
+    for (int i = 0; i < 400; i += 4) {
+        prepareEmployee(i * 30 + 29, record, &recordSize);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+        records[i] = string(record, recordSize);
+    }
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[399]);
+    assert(rc == success && "Deleting a record should not fail.");
+    cout << "Pages before the updates: " << pages << ", after: " << fileHandle.getNumberOfPages() << endl;
+
+    char data[PAGE_SIZE];
+    for (int i = 0; i < 399; i++) {
+        for (unsigned k = 0; k < recordDescriptor.size(); k++) {
+            string field;
+            bool notNull = fieldOf(recordDescriptor, records[i].data(), k, field);
+            rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], recordDescriptor[k].name, data);
+            if (rc != success || (notNull ? data[0] != 0 || memcmp(data + 1, field.data(), field.size()) != 0
+                                          : (data[0] & 0x80) == 0)) {
+                cout << "[FAIL] " << recordDescriptor[k].name << " of record " << i << " should read back as inserted." << endl;
+                return -1;
+            }
+        }
+    }
+    rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[0], "Weight", data);
+    assert(rc != success && "Reading an unknown attribute should fail.");
+    rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[399], "Age", data);
+    assert(rc != success && "Reading an attribute of a deleted record should fail.");
+
+    // a scan projects the same fields straight from the stored records
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Age");
+    vector<unsigned> projected;
+    projected.push_back(3);
+    projected.push_back(0);
+    projected.push_back(1);
+    // a record that moved is returned where it lives now, so the rows are compared without their RIDs
+    vector<string> expected, scanned;
+    for (int i = 0; i < 399; i++) {
+        expected.push_back(projectedFields(recordDescriptor, records[i], projected));
+    }
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, ScanFilter(), attributeNames, rbfmScanIterator);
+    assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+    vector<Attribute> projectedDescriptor;
+    for (unsigned k = 0; k < projected.size(); k++) {
+        projectedDescriptor.push_back(recordDescriptor[projected[k]]);
+    }
+    RID rid;
+    while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        scanned.push_back(string(data, recordSizeOf(projectedDescriptor, data)));
+    }
+    rbfmScanIterator.close();
+    sort(expected.begin(), expected.end());
+    sort(scanned.begin(), scanned.end());
+    if (scanned != expected) {
+        cout << "[FAIL] A scan should return every live record once, projected as Salary, EmpName, Age." << endl;
+        return -1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case ReadAttribute Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// whether a field in the API format satisfies the comparison, the way string::compare orders varchars
+bool satisfies(const AttrType type, const string &field, const CompOp compOp, const string &value)
+{
+    int order;
+    if (type == TypeInt) {
+        int left, right;
+        memcpy(&left, field.data(), sizeof(int));
+        memcpy(&right, value.data(), sizeof(int));
+        order = left < right ? -1 : left > right ? 1 : 0;
+    }
+    else if (type == TypeReal) {
+        float left, right;
+        memcpy(&left, field.data(), sizeof(float));
+        memcpy(&right, value.data(), sizeof(float));
+        order = left < right ? -1 : left > right ? 1 : 0;
+    }
+    else {
+        order = field.substr(sizeof(int)).compare(value.substr(sizeof(int)));
+    }
+    switch (compOp) {
+        case EQ_OP: return order == 0;
+        case LT_OP: return order < 0;
+        case LE_OP: return order <= 0;
+        case GT_OP: return order > 0;
+        case GE_OP: return order >= 0;
+        case NE_OP: return order != 0;
+        default: return true;
+    }
+}
+
+int RBFTest_CompiledConditions(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Scan with every comparison on int, real and varchar attributes, over NULL fields **
+    // 2. Scan on an unknown condition attribute **
+    cout << endl << "***** In RBF Test Case CompiledConditions *****" << endl;
+
+    RC rc;
+    string fileName = "test_compiled_conditions";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    vector<string> attributeNames;
+    for (unsigned k = 0; k < recordDescriptor.size(); k++) {
+        attributeNames.push_back(recordDescriptor[k].name);
+    }
+
+    // names of one letter share prefixes, so varchars are ordered by their bytes and then by their lengths
+    char record[PAGE_SIZE];
+    int recordSize;
+    vector<string> records;
+    for (int i = 0; i < 1000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        records.push_back(string(record, recordSize));
+    }
+
+    // every comparison against the fields of two records, the scan returns what testing each record by hand does
+    const int valuesOf[] = {5, 123};
+    const CompOp compOps[] = {EQ_OP, LT_OP, LE_OP, GT_OP, GE_OP, NE_OP, NO_OP};
+    char data[PAGE_SIZE];
+    unsigned scans = 0;
+    for (int v : valuesOf) {
+        for (unsigned k = 0; k < recordDescriptor.size(); k++) {
+            string value;
+            bool notNull = fieldOf(recordDescriptor, records[v].data(), k, value);
+            assert(notNull && "The fields compared against should not be NULL.");
+            for (CompOp compOp : compOps) {
+                vector<string> expected, scanned;
+                for (const string &r : records) {
+                    string field;
+                    if (compOp == NO_OP || (fieldOf(recordDescriptor, r.data(), k, field)
+                                            && satisfies(recordDescriptor[k].type, field, compOp, value))) {
+                        expected.push_back(r);
+                    }
+                }
+                RBFM_ScanIterator rbfmScanIterator;
+                rc = rbfm->scan(fileHandle, recordDescriptor, recordDescriptor[k].name, compOp, value.data(), attributeNames,
+                                rbfmScanIterator);
+                assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+                RID rid;
+                while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+                    scanned.push_back(string(data, recordSizeOf(recordDescriptor, data)));
+                }
+                rbfmScanIterator.close();
+                // short records fill earlier pages, so RID order isn't insertion order
+                sort(expected.begin(), expected.end());
+                sort(scanned.begin(), scanned.end());
+                if (scanned != expected) {
+                    cout << "[FAIL] A scan on " << recordDescriptor[k].name << " with CompOp " << compOp << " should return "
+                         << expected.size() << " records, not " << scanned.size() << "." << endl;
+                    return -1;
+                }
+                scans++;
+            }
+        }
+    }
+    cout << "Scans that matched a filter by hand: " << scans << endl;
+
+    RBFM_ScanIterator rbfmScanIterator;
+    int age = 30;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Weight", EQ_OP, &age, attributeNames, rbfmScanIterator);
+    assert(rc != success && "A scan on an unknown attribute should fail.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case CompiledConditions Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+int RBFTest_ScanReuse(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Scan again and again with one iterator, over files of different page sizes **
+    // 2. Close a scan halfway and start the next one with the same iterator **
+    cout << endl << "***** In RBF Test Case ScanReuse *****" << endl;
+
+    RC rc;
+    string fileName = "test_scan_reuse";
+    string wideName = "test_scan_reuse_wide";
+    rbfm->destroyFile(fileName);
+    rbfm->destroyFile(wideName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->createFile(wideName, PosixStorage, 4 * PAGE_SIZE);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle, wideHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->openFile(wideName, wideHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // employees on 4KB pages, records longer than 4KB on 16KB pages
+    vector<Attribute> recordDescriptor, textDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    createTextDescriptor(textDescriptor);
+    char record[4 * PAGE_SIZE];
+    int recordSize;
+    int age = 30;
+    vector<string> expected, wideExpected;
+    for (int i = 0; i < 2000; i++) {
+        prepareEmployee(i, record, &recordSize);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        if (i % 90 >= age) {
+            expected.push_back(string(record, recordSize));
+        }
+    }
+    for (int i = 0; i < 50; i++) {
+        recordSize = prepareText(i, 5000 + i * 10, 'a' + i % 26, record);
+        RID rid;
+        rc = rbfm->insertRecord(wideHandle, textDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        wideExpected.push_back(string(record, recordSize));
+    }
+    sort(expected.begin(), expected.end());
+    sort(wideExpected.begin(), wideExpected.end());
+    vector<string> attributeNames, textNames;
+    for (unsigned k = 0; k < recordDescriptor.size(); k++) {
+        attributeNames.push_back(recordDescriptor[k].name);
+    }
+    textNames.push_back("id");
+    textNames.push_back("text");
+
+    // the iterator goes back and forth between the files, every other scan of the employees is closed halfway
+    RBFM_ScanIterator rbfmScanIterator;
+    RID rid;
+    char data[4 * PAGE_SIZE];
+    for (int round = 0; round < 20; round++) {
+        rc = rbfm->scan(fileHandle, recordDescriptor, ScanFilter::compare("Age", GE_OP, &age), attributeNames, rbfmScanIterator);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        vector<string> scanned;
+        while ((round % 2 == 0 || scanned.size() < expected.size() / 2)
+               && rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+            scanned.push_back(string(data, recordSizeOf(recordDescriptor, data)));
+        }
+        rbfmScanIterator.close();
+        sort(scanned.begin(), scanned.end());
+        if (round % 2 == 0 ? scanned != expected
+                           : !includes(expected.begin(), expected.end(), scanned.begin(), scanned.end())) {
+            cout << "[FAIL] Scan " << round << " over the employees should return the records older than " << age << "." << endl;
+            return -1;
+        }
+
+        rc = rbfm->scan(wideHandle, textDescriptor, ScanFilter(), textNames, rbfmScanIterator);
+        assert(rc == success && "RecordBasedFileManager::scan() should not fail.");
+        vector<string> wideScanned;
+        while (rbfmScanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+            wideScanned.push_back(string(data, recordSizeOf(textDescriptor, data)));
+        }
+        rbfmScanIterator.close();
+        sort(wideScanned.begin(), wideScanned.end());
+        if (wideScanned != wideExpected) {
+            cout << "[FAIL] Scan " << round << " over the 16KB pages should return every record whole." << endl;
+            return -1;
+        }
+    }
+    cout << "Scans with one iterator: 40, records per full scan: " << expected.size() << " and " << wideExpected.size() << endl;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(wideHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->destroyFile(wideName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case ScanReuse Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// [id][length][text] of a text record as stored, unique to the record
+string storedText(const string &record)
+{
+    return record.substr(1);
+}
+
+int RBFTest_UpdateInPlace(RecordBasedFileManager *rbfm)
+{
+    // Functions tested
+    // 1. Update Record to the same size, smaller, and larger, staying where it is on its page **
+    // 2. Collect Counter Values, one page read and one page write per update **
+    // 3. Read Record, Scan
+    cout << endl << "***** In RBF Test Case UpdateInPlace *****" << endl;
+
+    RC rc;
+    string fileName = "test_update_in_place";
+    rbfm->destroyFile(fileName);
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createTextDescriptor(recordDescriptor);
+
+    // three full pages, each with a little room after its last record; the record that started a fourth goes again
+    char record[PAGE_SIZE];
+    int recordSize;
+    vector<RID> rids;
+    vector<string> records;
+    while (fileHandle.getNumberOfPages() < 4) {
+        recordSize = prepareText((int) rids.size(), 300, 'a', record);
+        RID rid;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+        records.push_back(string(record, recordSize));
+    }
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids.back());
+    assert(rc == success && "Deleting a record should not fail.");
+    rids.pop_back();
+    records.pop_back();
+    const unsigned pages = fileHandle.getNumberOfPages();
+
+    // an update leaves its record at the same offset, or else after the last record of its page
+    unsigned readBefore, writeBefore, appendBefore, readAfter, writeAfter, appendAfter;
+    unsigned updates = 0;
+    auto update = [&](const unsigned i, const int length, const char c, const bool samePlace) -> RC {
+        string before = recordArea(rbfm, fileHandle, rids[i].pageNum);
+        size_t offset = before.find(storedText(records[i]));
+        recordSize = prepareText((int) i, length, c, record);
+        fileHandle.collectCounterValues(readBefore, writeBefore, appendBefore);
+        RC rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        fileHandle.collectCounterValues(readAfter, writeAfter, appendAfter);
+        records[i] = string(record, recordSize);
+        string after = recordArea(rbfm, fileHandle, rids[i].pageNum);
+        size_t landed = after.find(storedText(records[i]));
+        updates++;
+        if (rc != success || readAfter - readBefore != 1 || writeAfter - writeBefore != 1 || appendAfter != appendBefore
+            || landed == string::npos || (samePlace ? landed != offset : landed <= offset)) {
+            cout << "Update of record " << i << " to " << length << " bytes: " << readAfter - readBefore << " pages read, "
+                 << writeAfter - writeBefore << " written, at " << offset << " and then " << landed << endl;
+            return -1;
+        }
+        return success;
+    };
+    for (unsigned i = 0; i < rids.size(); i += 3) {
+        if (update(i, 300, 'b', true) != success) {
+            cout << "[FAIL] An update to the same size should overwrite the record where it is." << endl;
+            return -1;
+        }
+    }
+    for (unsigned i = 1; i < rids.size(); i += 3) {
+        if (update(i, 200, 'c', true) != success) {
+            cout << "[FAIL] An update that shrinks a record should overwrite it where it is." << endl;
+            return -1;
+        }
+    }
+    // the last record of a page grows into the room behind it
+    for (unsigned i = 1; i < rids.size(); i++) {
+        if (rids[i].pageNum != rids[i - 1].pageNum && update(i - 1, 350, 'd', true) != success) {
+            cout << "[FAIL] The last record of a page should grow into the room after it." << endl;
+            return -1;
+        }
+    }
+    // any other record that grows goes after the last one, the shrunk records left the room
+    for (unsigned i = 2; i + 1 < rids.size(); i += 3) {
+        if (rids[i].pageNum == rids[i + 1].pageNum && update(i, 340, 'e', false) != success) {
+            cout << "[FAIL] A record that grows should move to the room at the end of its page." << endl;
+            return -1;
+        }
+    }
+    cout << "Updates on " << rids.size() << " records: " << updates << ", pages before: " << pages
+         << ", after: " << fileHandle.getNumberOfPages() << endl;
+    if (fileHandle.getNumberOfPages() != pages) {
+        cout << "[FAIL] Updates that fit their pages should not grow the file." << endl;
+        return -1;
+    }
+
+    // every record reads back from its RID, and a scan sees each one once
+    for (unsigned i = 0; i < rids.size(); i++) {
+        unsigned pagesRead;
+        if (readText(rbfm, fileHandle, recordDescriptor, rids[i], records[i], pagesRead) != success || pagesRead != 1) {
+            cout << "[FAIL] Record " << i << " should read back from its own page as updated." << endl;
+            return -1;
+        }
+    }
+    map<int, int> ids;
+    scanIds(rbfm, fileHandle, recordDescriptor, ids);
+    unsigned scannedOnce = 0;
+    for (auto it = ids.begin(); it != ids.end(); it++) {
+        scannedOnce += it->second == 1 ? 1 : 0;
+    }
+    if (ids.size() != rids.size() || scannedOnce != rids.size()) {
+        cout << "[FAIL] A scan should return every record once." << endl;
+        return -1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case UpdateInPlace Finished! The result will be examined." << endl << endl;
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------
+
+int main() {
+
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    RBFTest_BatchInsert(rbfm);
+
+    RBFTest_SelectKernels(rbfm);
+
+    RBFTest_ParallelScan(rbfm);
+
+    RBFTest_UpdateMoves(rbfm);
+
+    RBFTest_ZoneMap(rbfm);
+
+    RBFTest_WidePages(rbfm);
+
+    RBFTest_BufferPool(rbfm);
+
+    RBFTest_PositionalIO(rbfm);
+
+    RBFTest_FileHeader(rbfm);
+
+    RBFTest_FreeSpaceMap(rbfm);
+
+    RBFTest_MmapRead(rbfm);
+
+    RBFTest_ReadAhead(rbfm);
+
+    RBFTest_Extents(rbfm);
+
+    RBFTest_MemoryStorage(rbfm);
+
+    RBFTest_FreeSlots(rbfm);
+
+    RBFTest_Compaction(rbfm);
+
+    RBFTest_ReadAttribute(rbfm);
+
+    RBFTest_CompiledConditions(rbfm);
+
+    RBFTest_ScanReuse(rbfm);
+
+    RBFTest_UpdateInPlace(rbfm);
+
+    // last, it leaves the AsyncIOManager on its thread pool
+    RBFTest_AsyncIO(rbfm);
+
+    return 0;
+}
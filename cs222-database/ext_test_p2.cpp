@@ -0,0 +1,1023 @@
+#include "../RelationManager/rm_test_util.h"
+#include "../IndexManager/ix.h"
+#include <functional>
+
+// Tests of the relation manager features beyond the project spec. Each one checks its
+// feature against the plain path that is already tested: tuples inserted one at a time,
+// or a scan without condition that is filtered here.
+
+// the name of the i-th employee; every 13th needs quoting in a CSV file
+string employeeName(const int i)
+{
+    string name(i % 20, 'a' + i % 26);
+    if (i % 13 == 0) {
+        name += ",\"q";
+    }
+    return name;
+}
+
+// the i-th employee tuple of these tests; every 7th has a NULL name, every 11th a NULL height.
+// The salary is i, so it is a unique key
+void prepareEmployeeTuple(const int i, void *buffer, int *tupleSize)
+{
+    unsigned char nullsIndicator = 0;
+    if (i % 7 == 0) {
+        nullsIndicator |= 0x80;
+    }
+    if (i % 11 == 0) {
+        nullsIndicator |= 0x20;
+    }
+    string name = employeeName(i);
+    prepareTuple(4, &nullsIndicator, name.size(), name, i % 90, (float) (i % 50) / 10, i, buffer, tupleSize);
+}
+
+// the same employee as a line of a CSV file
+string employeeCsvLine(const int i)
+{
+    string line;
+    if (i % 7 != 0) {
+        string name = employeeName(i);
+        line += "\"";
+        for (char c : name) {
+            line += c == '"' ? "\"\"" : string(1, c);
+        }
+        line += "\"";
+    }
+    line += "," + to_string(i % 90) + ",";
+    if (i % 11 != 0) {
+        line += to_string(i % 50 / 10) + "." + to_string(i % 10);
+    }
+    line += "," + to_string(i) + "\n";
+    return line;
+}
+
+// the size of an employee tuple follows from its null bits and its name length
+int employeeTupleSize(const char *data)
+{
+    unsigned char nullsIndicator = data[0];
+    int size = 1;
+    if (!(nullsIndicator & 0x80)) {
+        int nameLength;
+        memcpy(&nameLength, data + 1, sizeof(int));
+        size += sizeof(int) + nameLength;
+    }
+    for (unsigned char bit = 0x40; bit >= 0x10; bit >>= 1) {
+        if (!(nullsIndicator & bit)) {
+            size += 4;
+        }
+    }
+    return size;
+}
+
+// every employee tuple of the table, as a scan without condition returns them
+void scanEmployees(const string &tableName, multiset<string> &tuples)
+{
+    vector<string> attributes;
+    attributes.push_back("EmpName");
+    attributes.push_back("Age");
+    attributes.push_back("Height");
+    attributes.push_back("Salary");
+    RM_ScanIterator rmsi;
+    RC rc = rm->scan(tableName, "", NO_OP, NULL, attributes, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+
+    RID rid;
+    char data[PAGE_SIZE];
+    tuples.clear();
+    while (rmsi.getNextTuple(rid, data) != RM_EOF) {
+        tuples.insert(string(data, employeeTupleSize(data)));
+    }
+    rmsi.close();
+}
+
+// an employee tuple taken apart, NULL fields flagged
+typedef struct {
+    bool nameNull;
+    string name;
+    int age;
+    bool heightNull;
+    float height;
+    int salary;
+} Employee;
+
+void readEmployee(const char *data, Employee &employee)
+{
+    unsigned char nullsIndicator = data[0];
+    const char *field = data + 1;
+    employee.nameNull = (nullsIndicator & 0x80) != 0;
+    employee.name.clear();
+    if (!employee.nameNull) {
+        int nameLength;
+        memcpy(&nameLength, field, sizeof(int));
+        employee.name.assign(field + sizeof(int), nameLength);
+        field += sizeof(int) + nameLength;
+    }
+    memcpy(&employee.age, field, sizeof(int));
+    field += sizeof(int);
+    employee.heightNull = (nullsIndicator & 0x20) != 0;
+    if (!employee.heightNull) {
+        memcpy(&employee.height, field, sizeof(float));
+        field += sizeof(float);
+    }
+    memcpy(&employee.salary, field, sizeof(int));
+}
+
+// a varchar value as scan() takes it, [int length][chars]
+string varCharValue(const string &chars)
+{
+    int length = chars.size();
+    return string((const char *) &length, sizeof(int)) + chars;
+}
+
+// the tuples a filtered scan returns
+void scanEmployees(const string &tableName, const ScanFilter &filter, multiset<string> &tuples, const ScanMode mode = SerialScan)
+{
+    vector<string> attributes;
+    attributes.push_back("EmpName");
+    attributes.push_back("Age");
+    attributes.push_back("Height");
+    attributes.push_back("Salary");
+    RM_ScanIterator rmsi;
+    RC rc = rm->scan(tableName, filter, attributes, rmsi, mode);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+
+    RID rid;
+    char data[PAGE_SIZE];
+    tuples.clear();
+    while (rmsi.getNextTuple(rid, data) != RM_EOF) {
+        tuples.insert(string(data, employeeTupleSize(data)));
+    }
+    rmsi.close();
+}
+
+// every entry of an index on Salary, whose key must be the salary of the tuple it points at
+RC checkSalaryIndex(const string &tableName, const string &indexFileName, unsigned &entries)
+{
+    IndexManager *ix = IndexManager::instance();
+    vector<Attribute> attrs;
+    rm->getAttributes(tableName, attrs);
+    IXFileHandle ixFileHandle;
+    RC rc = ix->openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "Opening the index file should not fail.");
+    IX_ScanIterator ixsi;
+    rc = ix->scan(ixFileHandle, attrs[3], NULL, NULL, true, true, ixsi);
+    assert(rc == success && "Scanning the index should not fail.");
+
+    RID rid;
+    int keyBuffer;
+    void *key = &keyBuffer;
+    char data[PAGE_SIZE];
+    entries = 0;
+    RC result = success;
+    while (ixsi.getNextEntry(rid, key) != IX_EOF) {
+        entries++;
+        int salary;
+        // getNextEntry() points key at the entry it returns
+        memcpy(&salary, key, sizeof(int));
+        if (rm->readAttribute(tableName, rid, "Salary", data) != success || memcmp(data + 1, &salary, sizeof(int)) != 0) {
+            result = -1;
+        }
+    }
+    ixsi.close();
+    ix->closeFile(ixFileHandle);
+    return result;
+}
+
+RC TEST_RM_BulkLoad(const string &tableName)
+{
+    // Functions Tested
+    // 1. Bulk Load, CSV and binary **
+    // 2. Insert Tuple
+    // 3. Scan
+    cout << endl << "***** In RM Test Case BulkLoad *****" << endl;
+
+    string csvTable = tableName + "_csv";
+    string binaryTable = tableName + "_bin";
+    createTable(tableName);
+    createTable(csvTable);
+    createTable(binaryTable);
+
+    // the same tuples one at a time, as CSV lines and as binary tuples
+    int numTuples = 3000;
+    string csvFileName = tableName + ".csv";
+    string binaryFileName = tableName + ".bin";
+    ofstream csv(csvFileName.c_str());
+    ofstream binary(binaryFileName.c_str(), ios::binary);
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    RID rid;
+    RC rc;
+    for (int i = 0; i < numTuples; i++) {
+        prepareEmployeeTuple(i, tuple, &tupleSize);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+        csv << employeeCsvLine(i);
+        // a blank line is skipped, a CRLF line ending is fine
+        if (i == 100) {
+            csv << "\r\n";
+        }
+        binary.write((const char *) &tupleSize, sizeof(int));
+        binary.write(tuple, tupleSize);
+    }
+    csv.close();
+    binary.close();
+
+    rc = rm->bulkLoad(csvTable, csvFileName, CsvFormat);
+    assert(rc == success && "Bulk loading a CSV file should not fail.");
+    rc = rm->bulkLoad(binaryTable, binaryFileName, BinaryFormat);
+    assert(rc == success && "Bulk loading a binary file should not fail.");
+
+    multiset<string> inserted, csvLoaded, binaryLoaded;
+    scanEmployees(tableName, inserted);
+    scanEmployees(csvTable, csvLoaded);
+    scanEmployees(binaryTable, binaryLoaded);
+    cout << "Tuples inserted: " << inserted.size() << ", loaded from CSV: " << csvLoaded.size()
+         << ", loaded from binary: " << binaryLoaded.size() << endl;
+    if (inserted.size() != (unsigned) numTuples || csvLoaded != inserted || binaryLoaded != inserted) {
+        cout << "***** [FAIL] RM Test Case BulkLoad failed: the loaded tuples differ from the inserted ones *****" << endl << endl;
+        return -1;
+    }
+
+    rc = rm->bulkLoad(csvTable, "no_such_file.csv", CsvFormat);
+    assert(rc != success && "Bulk loading a file that doesn't exist should fail.");
+
+    rm->deleteTable(tableName);
+    rm->deleteTable(csvTable);
+    rm->deleteTable(binaryTable);
+    remove(csvFileName.c_str());
+    remove(binaryFileName.c_str());
+
+    cout << "***** RM Test Case BulkLoad finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+RC TEST_RM_BulkLoadMalformed(const string &tableName)
+{
+    // Functions Tested
+    // 1. Bulk Load, a source with a malformed tuple, with an index **
+    // 2. Scan
+    // 3. Index Scan
+    cout << endl << "***** In RM Test Case BulkLoadMalformed *****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    string binaryTable = tableName + "_bin";
+    createTable(tableName);
+    createTable(binaryTable);
+    string indexFileName = tableName + "_Salary.idx";
+    ix->destroyFile(indexFileName);
+    RC rc = ix->createFile(indexFileName);
+    assert(rc == success && "Creating the index file should not fail.");
+
+    // a source of several pieces, the malformed line is deep inside it
+    int numTuples = 300000;
+    int malformed = 250000;
+    string csvFileName = tableName + ".csv";
+    ofstream csv(csvFileName.c_str());
+    streamoff malformedAt = 0;
+    multiset<string> expected;
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    for (int i = 0; i < numTuples; i++) {
+        if (i == malformed) {
+            malformedAt = csv.tellp();
+            csv << "\"x\",abc,1.5," << i << "\n";
+            continue;
+        }
+        csv << employeeCsvLine(i);
+        if (i < malformed) {
+            prepareEmployeeTuple(i, tuple, &tupleSize);
+            expected.insert(string(tuple, tupleSize));
+        }
+    }
+    csv.close();
+    assert(malformedAt > (streamoff) BULK_LOAD_CHUNK_BYTES && "The malformed tuple should be past the first piece.");
+
+    TableIndex index;
+    index.attributeName = "Salary";
+    index.fileName = indexFileName;
+    vector<TableIndex> indexes;
+    indexes.push_back(index);
+    rc = rm->bulkLoad(tableName, csvFileName, CsvFormat, indexes);
+    assert(rc != success && "Bulk loading a malformed tuple should fail.");
+
+    // the tuples in front of it are in the table and in the index
+    multiset<string> loaded;
+    scanEmployees(tableName, loaded);
+    unsigned entries;
+    rc = checkSalaryIndex(tableName, indexFileName, entries);
+    cout << "Tuples loaded: " << loaded.size() << ", index entries: " << entries << endl;
+    if (loaded != expected || entries != expected.size() || rc != success) {
+        cout << "***** [FAIL] RM Test Case BulkLoadMalformed failed: the tuples in front of the malformed one should be loaded *****" << endl << endl;
+        return -1;
+    }
+
+    // a binary source cut off in the middle of its last tuple
+    string binaryFileName = tableName + ".bin";
+    ofstream binary(binaryFileName.c_str(), ios::binary);
+    for (int i = 0; i < 10; i++) {
+        prepareEmployeeTuple(i, tuple, &tupleSize);
+        binary.write((const char *) &tupleSize, sizeof(int));
+        binary.write(tuple, i == 9 ? tupleSize / 2 : tupleSize);
+    }
+    binary.close();
+    rc = rm->bulkLoad(binaryTable, binaryFileName, BinaryFormat);
+    assert(rc != success && "Bulk loading a truncated tuple should fail.");
+    scanEmployees(binaryTable, loaded);
+    if (loaded.size() != 9) {
+        cout << "***** [FAIL] RM Test Case BulkLoadMalformed failed: the whole binary tuples should be loaded *****" << endl << endl;
+        return -1;
+    }
+
+    rm->deleteTable(tableName);
+    rm->deleteTable(binaryTable);
+    ix->destroyFile(indexFileName);
+    remove(csvFileName.c_str());
+    remove(binaryFileName.c_str());
+
+    cout << "***** RM Test Case BulkLoadMalformed finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+// a CSV field in quotes, "" for a quote inside
+string csvQuoted(const string &chars)
+{
+    string field = "\"";
+    for (char c : chars) {
+        field += c == '"' ? "\"\"" : string(1, c);
+    }
+    return field + "\"";
+}
+
+RC TEST_RM_BulkLoadQuoted(const string &tableName)
+{
+    // Functions Tested
+    // 1. Bulk Load, CSV with line breaks in quoted fields **
+    // 2. Scan
+    cout << endl << "***** In RM Test Case BulkLoadQuoted *****" << endl;
+
+    createTable(tableName);
+    string csvFileName = tableName + ".csv";
+    ofstream csv(csvFileName.c_str(), ios::binary);
+    multiset<string> expected;
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    auto addRow = [&](const int i, const bool nameNull, const string &name) {
+        unsigned char nullsIndicator = nameNull ? 0x80 : 0;
+        prepareTuple(4, &nullsIndicator, name.size(), name, i % 90, 1.5f, i, tuple, &tupleSize);
+        expected.insert(string(tuple, tupleSize));
+        csv << (nameNull ? "" : csvQuoted(name)) << "," << i % 90 << ",1.5," << i << "\n";
+    };
+
+    // the first piece ends two bytes short of the end of a tuple, right behind a line break inside its name
+    const streamoff pieceEnd = BULK_LOAD_CHUNK_BYTES;
+    bool straddles = false;
+    for (int i = 0; csv.tellp() < pieceEnd + 100000; i++) {
+        streamoff pos = csv.tellp();
+        if (!straddles && pos >= pieceEnd - 28 && pos <= pieceEnd - 6) {
+            addRow(i, false, string(pieceEnd - 3 - pos, 's') + "\nx");
+            straddles = true;
+        }
+        else if (!straddles && pos > pieceEnd - 200) {
+            // short tuples up to the spot
+            addRow(i, true, "");
+        }
+        else if (i % 4 == 0) {
+            addRow(i, false, "line\nbreak");
+        }
+        else if (i % 4 == 1) {
+            addRow(i, false, "crlf\r\nbreak");
+        }
+        else if (i % 4 == 2) {
+            addRow(i, false, "\"q\"\n,\n");
+        }
+        else {
+            addRow(i, false, "n" + to_string(i % 100));
+        }
+    }
+    csv.close();
+    assert(straddles && "A tuple should straddle the end of the first piece.");
+
+    RC rc = rm->bulkLoad(tableName, csvFileName, CsvFormat);
+    assert(rc == success && "Bulk loading quoted line breaks should not fail.");
+    multiset<string> loaded;
+    scanEmployees(tableName, loaded);
+    cout << "Tuples written: " << expected.size() << ", loaded: " << loaded.size() << endl;
+    if (loaded != expected) {
+        cout << "***** [FAIL] RM Test Case BulkLoadQuoted failed: a line break inside quotes should stay in its field *****" << endl << endl;
+        return -1;
+    }
+
+    // a quote that is never closed runs to the end of the source, the tuples in front of it still load
+    rm->deleteTable(tableName);
+    createTable(tableName);
+    csv.open(csvFileName.c_str(), ios::binary);
+    csv << "\"n1\",1,1.5,1\n\"open,2,1.5,2\n3,3,1.5,3\n";
+    csv.close();
+    rc = rm->bulkLoad(tableName, csvFileName, CsvFormat);
+    assert(rc != success && "Bulk loading an unclosed quote should fail.");
+    scanEmployees(tableName, loaded);
+    if (loaded.size() != 1) {
+        cout << "***** [FAIL] RM Test Case BulkLoadQuoted failed: the tuple in front of the unclosed quote should be loaded *****" << endl << endl;
+        return -1;
+    }
+
+    rm->deleteTable(tableName);
+    remove(csvFileName.c_str());
+
+    cout << "***** RM Test Case BulkLoadQuoted finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+RC TEST_RM_BulkLoadLongTuples(const string &tableName)
+{
+    // Functions Tested
+    // 1. Bulk Load, a tuple too long for a page, with an index **
+    // 2. Scan
+    // 3. Index Scan
+    cout << endl << "***** In RM Test Case BulkLoadLongTuples *****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "Id";
+    attr.type = TypeInt;
+    attr.length = (AttrLength) 4;
+    attrs.push_back(attr);
+    attr.name = "Text";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength) 5000;
+    attrs.push_back(attr);
+    rm->deleteTable(tableName);
+    RC rc = rm->createTable(tableName, attrs);
+    assert(rc == success && "Creating the table should not fail.");
+    string indexFileName = tableName + "_Id.idx";
+    ix->destroyFile(indexFileName);
+    rc = ix->createFile(indexFileName);
+    assert(rc == success && "Creating the index file should not fail.");
+
+    // more pages of tuples than insertRecords() appends at once in front of the long one, all in one piece
+    int numTuples = 2000;
+    int tooLong = 1500;
+    string csvFileName = tableName + ".csv";
+    ofstream csv(csvFileName.c_str(), ios::binary);
+    for (int i = 0; i < numTuples; i++) {
+        csv << i << "," << csvQuoted(string(i == tooLong ? PAGE_SIZE : 1000, 'a' + i % 26)) << "\n";
+    }
+    csv.close();
+    assert(tooLong * 1000 > (int) (RBFM_BATCH_PAGES * PAGE_SIZE) && "The tuples in front should take more than one run of pages.");
+
+    TableIndex index;
+    index.attributeName = "Id";
+    index.fileName = indexFileName;
+    vector<TableIndex> indexes;
+    indexes.push_back(index);
+    rc = rm->bulkLoad(tableName, csvFileName, CsvFormat, indexes);
+    assert(rc != success && "Bulk loading a tuple too long for a page should fail.");
+
+    // the tuples in front of it are in the table and every one of them is in the index
+    vector<string> attributes(1, "Id");
+    RM_ScanIterator rmsi;
+    rc = rm->scan(tableName, "", NO_OP, NULL, attributes, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    RID rid;
+    char data[PAGE_SIZE];
+    set<int> ids;
+    while (rmsi.getNextTuple(rid, data) != RM_EOF) {
+        int id;
+        memcpy(&id, data + 1, sizeof(int));
+        ids.insert(id);
+    }
+    rmsi.close();
+
+    IXFileHandle ixFileHandle;
+    rc = ix->openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "Opening the index file should not fail.");
+    IX_ScanIterator ixsi;
+    rc = ix->scan(ixFileHandle, attrs[0], NULL, NULL, true, true, ixsi);
+    assert(rc == success && "Scanning the index should not fail.");
+    int keyBuffer;
+    void *key = &keyBuffer;
+    unsigned entries = 0;
+    bool entriesRight = true;
+    while (ixsi.getNextEntry(rid, key) != IX_EOF) {
+        entries++;
+        int id;
+        // getNextEntry() points key at the entry it returns
+        memcpy(&id, key, sizeof(int));
+        if (rm->readAttribute(tableName, rid, "Id", data) != success || memcmp(data + 1, &id, sizeof(int)) != 0) {
+            entriesRight = false;
+        }
+    }
+    ixsi.close();
+    ix->closeFile(ixFileHandle);
+    cout << "Tuples loaded: " << ids.size() << ", index entries: " << entries << endl;
+    if (ids.size() != (unsigned) tooLong || *ids.rbegin() != tooLong - 1 || entries != ids.size() || !entriesRight) {
+        cout << "***** [FAIL] RM Test Case BulkLoadLongTuples failed: the tuples in front of the long one should be loaded and indexed *****" << endl << endl;
+        return -1;
+    }
+
+    // the same for a binary source
+    rm->deleteTable(tableName);
+    rc = rm->createTable(tableName, attrs);
+    assert(rc == success && "Creating the table should not fail.");
+    string binaryFileName = tableName + ".bin";
+    ofstream binary(binaryFileName.c_str(), ios::binary);
+    for (int i = 0; i < 3; i++) {
+        string text(i == 2 ? PAGE_SIZE : 100, 'b');
+        int textLength = text.size();
+        int tupleLength = 1 + 2 * sizeof(int) + textLength;
+        binary.write((const char *) &tupleLength, sizeof(int));
+        binary.put('\0');
+        binary.write((const char *) &i, sizeof(int));
+        binary.write((const char *) &textLength, sizeof(int));
+        binary.write(text.data(), textLength);
+    }
+    binary.close();
+    rc = rm->bulkLoad(tableName, binaryFileName, BinaryFormat);
+    assert(rc != success && "Bulk loading a tuple too long for a page should fail.");
+    rc = rm->scan(tableName, "", NO_OP, NULL, attributes, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    unsigned binaryLoaded = 0;
+    while (rmsi.getNextTuple(rid, data) != RM_EOF) {
+        binaryLoaded++;
+    }
+    rmsi.close();
+    if (binaryLoaded != 2) {
+        cout << "***** [FAIL] RM Test Case BulkLoadLongTuples failed: the binary tuples in front of the long one should be loaded *****" << endl << endl;
+        return -1;
+    }
+
+    rm->deleteTable(tableName);
+    ix->destroyFile(indexFileName);
+    remove(csvFileName.c_str());
+    remove(binaryFileName.c_str());
+
+    cout << "***** RM Test Case BulkLoadLongTuples finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+RC TEST_RM_ScanFilters(const string &tableName)
+{
+    // Functions Tested
+    // 1. Scan with AND / OR / NOT, IN and BETWEEN filters over NULL fields **
+    // 2. Scan without condition
+    cout << endl << "***** In RM Test Case ScanFilters *****" << endl;
+
+    createTable(tableName);
+    int numTuples = 5000;
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    RID rid;
+    RC rc;
+    for (int i = 0; i < numTuples; i++) {
+        prepareEmployeeTuple(i, tuple, &tupleSize);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+    multiset<string> all;
+    scanEmployees(tableName, all);
+
+    int ageLow = 20, ageHigh = 40, age5 = 5, age50 = 50;
+    int salaryLow = 1000, salaryHigh = 3000;
+    int ages[] = {1, 2, 3};
+    float heightTwo = 2.0, heightHalf = 0.5, heightOne = 1.0;
+    string nameM = varCharValue("m");
+    string nameB = varCharValue("b");
+    vector<string> names;
+    names.push_back(varCharValue(employeeName(15)));
+    names.push_back(varCharValue(employeeName(27)));
+    names.push_back(varCharValue(employeeName(14)));    // employee 14 has a NULL name, the others named so are found
+    names.push_back(varCharValue("nobody"));
+    vector<const void *> nameValues;
+    for (const string &name : names) {
+        nameValues.push_back(name.data());
+    }
+    vector<const void *> ageValues;
+    for (int &age : ages) {
+        ageValues.push_back(&age);
+    }
+
+    // each filter with what it should select; a comparison on a NULL is unknown, and so is its negation
+    vector<ScanFilter> filters;
+    vector<function<bool(const Employee &)> > expected;
+
+    filters.push_back(ScanFilter::between("Age", &ageLow, &ageHigh));
+    expected.push_back([&](const Employee &e) { return e.age >= ageLow && e.age <= ageHigh; });
+
+    filters.push_back(ScanFilter::in("EmpName", nameValues));
+    expected.push_back([&](const Employee &e) {
+        return !e.nameNull && (e.name == employeeName(15) || e.name == employeeName(27) || e.name == employeeName(14)); });
+
+    filters.push_back(ScanFilter::negate(ScanFilter::compare("Height", LT_OP, &heightTwo)));
+    expected.push_back([&](const Employee &e) { return !e.heightNull && !(e.height < heightTwo); });
+
+    filters.push_back(ScanFilter::between("Height", &heightHalf, &heightTwo));
+    expected.push_back([&](const Employee &e) { return !e.heightNull && e.height >= heightHalf && e.height <= heightTwo; });
+
+    vector<ScanFilter> either;
+    either.push_back(ScanFilter::compare("Age", EQ_OP, &age5));
+    either.push_back(ScanFilter::negate(ScanFilter::in("Age", ageValues)));
+    vector<ScanFilter> both;
+    both.push_back(ScanFilter::between("Salary", &salaryLow, &salaryHigh));
+    both.push_back(ScanFilter::anyOf(either));
+    filters.push_back(ScanFilter::allOf(both));
+    expected.push_back([&](const Employee &e) {
+        return e.salary >= salaryLow && e.salary <= salaryHigh && (e.age == age5 || !(e.age >= 1 && e.age <= 3)); });
+
+    // true OR unknown is true, false OR unknown is unknown
+    vector<ScanFilter> namesOrHeights;
+    namesOrHeights.push_back(ScanFilter::compare("EmpName", GE_OP, nameM.data()));
+    namesOrHeights.push_back(ScanFilter::compare("Height", EQ_OP, &heightHalf));
+    filters.push_back(ScanFilter::anyOf(namesOrHeights));
+    expected.push_back([&](const Employee &e) {
+        return (!e.nameNull && e.name >= "m") || (!e.heightNull && e.height == heightHalf); });
+
+    // NOT (unknown OR false) is unknown
+    vector<ScanFilter> shortOrOld;
+    shortOrOld.push_back(ScanFilter::compare("Height", LT_OP, &heightOne));
+    shortOrOld.push_back(ScanFilter::compare("Age", GT_OP, &age50));
+    filters.push_back(ScanFilter::negate(ScanFilter::anyOf(shortOrOld)));
+    expected.push_back([&](const Employee &e) { return !e.heightNull && !(e.height < heightOne) && !(e.age > age50); });
+
+    // false AND unknown is false, so its negation is true
+    vector<ScanFilter> namedAndYoung;
+    namedAndYoung.push_back(ScanFilter::compare("EmpName", LT_OP, nameB.data()));
+    namedAndYoung.push_back(ScanFilter::compare("Age", LT_OP, &age5));
+    filters.push_back(ScanFilter::negate(ScanFilter::allOf(namedAndYoung)));
+    expected.push_back([&](const Employee &e) {
+        bool young = e.age < age5;
+        if (e.nameNull) {
+            return !young;
+        }
+        return !(e.name < "b" && young); });
+
+    for (unsigned f = 0; f < filters.size(); f++) {
+        multiset<string> selected, wanted;
+        scanEmployees(tableName, filters[f], selected);
+        Employee employee;
+        for (const string &t : all) {
+            readEmployee(t.data(), employee);
+            if (expected[f](employee)) {
+                wanted.insert(t);
+            }
+        }
+        cout << "Filter " << f << ": " << selected.size() << " of " << all.size() << " tuples" << endl;
+        if (selected != wanted || wanted.empty()) {
+            cout << "***** [FAIL] RM Test Case ScanFilters failed: filter " << f << " should select " << wanted.size() << " tuples *****" << endl << endl;
+            return -1;
+        }
+    }
+
+    // a filter on an attribute the table doesn't have
+    vector<string> attributes;
+    attributes.push_back("Age");
+    RM_ScanIterator rmsi;
+    rc = rm->scan(tableName, ScanFilter::compare("Nothing", EQ_OP, &age5), attributes, rmsi);
+    assert(rc != success && "Scanning with a filter on an unknown attribute should fail.");
+
+    rm->deleteTable(tableName);
+
+    cout << "***** RM Test Case ScanFilters finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+RC TEST_RM_ScanBatches(const string &tableName)
+{
+    // Functions Tested
+    // 1. Scan, a batch of tuples at a time **
+    // 2. Scan, a tuple at a time
+    cout << endl << "***** In RM Test Case ScanBatches *****" << endl;
+
+    createTable(tableName);
+    int numTuples = 5000;
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    RID rid;
+    RC rc;
+    for (int i = 0; i < numTuples; i++) {
+        prepareEmployeeTuple(i, tuple, &tupleSize);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+
+    // the projection puts the columns out of table order
+    vector<string> attributes;
+    attributes.push_back("Salary");
+    attributes.push_back("EmpName");
+    attributes.push_back("Height");
+    int ageLow = 10, ageHigh = 60;
+    ScanFilter filter = ScanFilter::between("Age", &ageLow, &ageHigh);
+
+    // what a tuple at a time gives, in the same order
+    vector<RID> rids;
+    vector<string> tuples;
+    RM_ScanIterator rmsi;
+    rc = rm->scan(tableName, filter, attributes, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    while (rmsi.getNextTuple(rid, tuple) != RM_EOF) {
+        // [nulls][salary][name][height], the name and the height may be NULL
+        unsigned char nullsIndicator = tuple[0];
+        int size = 1 + sizeof(int);
+        if (!(nullsIndicator & 0x40)) {
+            int nameLength;
+            memcpy(&nameLength, tuple + size, sizeof(int));
+            size += sizeof(int) + nameLength;
+        }
+        if (!(nullsIndicator & 0x20)) {
+            size += sizeof(float);
+        }
+        rids.push_back(rid);
+        tuples.push_back(string(tuple, size));
+    }
+    rmsi.close();
+
+    // batches of one row, a few rows and the default size; the last one of each is partly filled
+    unsigned capacities[] = {1, 7, SCAN_BATCH_ROWS};
+    for (unsigned capacity : capacities) {
+        rc = rm->scan(tableName, filter, attributes, rmsi);
+        assert(rc == success && "RelationManager::scan() should not fail.");
+        RecordBatch batch(capacity);
+        unsigned row = 0;
+        unsigned batches = 0;
+        while (rmsi.getNextBatch(batch) != RM_EOF) {
+            batches++;
+            assert(batch.rows > 0 && batch.rows <= capacity && "A batch should hold between 1 and capacity rows.");
+            for (unsigned r = 0; r < batch.rows; r++, row++) {
+                if (row >= tuples.size() || batch.rids[r].pageNum != rids[row].pageNum || batch.rids[r].slotNum != rids[row].slotNum) {
+                    cout << "***** [FAIL] RM Test Case ScanBatches failed: row " << row << " has the wrong RID *****" << endl << endl;
+                    return -1;
+                }
+                // the row put back together in the format of getNextTuple()
+                string rebuilt(1, '\0');
+                rebuilt.append((const char *) &batch.intColumn(0)[r], sizeof(int));
+                if (batch.isNull(1, r)) {
+                    rebuilt[0] |= 0x40;
+                }
+                else {
+                    unsigned length;
+                    const char *name = batch.varCharAt(1, r, length);
+                    int nameLength = length;
+                    rebuilt.append((const char *) &nameLength, sizeof(int));
+                    rebuilt.append(name, length);
+                }
+                if (batch.isNull(2, r)) {
+                    rebuilt[0] |= 0x20;
+                }
+                else {
+                    rebuilt.append((const char *) &batch.realColumn(2)[r], sizeof(float));
+                }
+                if (rebuilt != tuples[row]) {
+                    cout << "***** [FAIL] RM Test Case ScanBatches failed: row " << row << " differs from getNextTuple() *****" << endl << endl;
+                    return -1;
+                }
+            }
+        }
+        // and it stays at the end
+        assert(rmsi.getNextBatch(batch) == RM_EOF && "A scan at its end should stay there.");
+        rmsi.close();
+        cout << "Batches of " << capacity << ": " << batches << " batches, " << row << " rows" << endl;
+        if (row != tuples.size() || batches != (tuples.size() + capacity - 1) / capacity) {
+            cout << "***** [FAIL] RM Test Case ScanBatches failed: " << tuples.size() << " rows should come in full batches *****" << endl << endl;
+            return -1;
+        }
+    }
+
+    rm->deleteTable(tableName);
+
+    cout << "***** RM Test Case ScanBatches finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+// the tuples the test expects, by salary: where each one is and what it holds
+typedef map<int, pair<RID, string> > TupleShadow;
+
+// every tuple of the shadow reads back from where it says, and a scan finds them and nothing else
+RC checkShadow(const string &tableName, const TupleShadow &shadow)
+{
+    char data[PAGE_SIZE];
+    multiset<string> expected, scanned;
+    for (const auto &tuple : shadow) {
+        if (rm->readTuple(tableName, tuple.second.first, data) != success
+            || string(data, tuple.second.second.size()) != tuple.second.second) {
+            return -1;
+        }
+        expected.insert(tuple.second.second);
+    }
+    scanEmployees(tableName, scanned);
+    return scanned == expected ? success : -1;
+}
+
+// reorganize the table a few pages a step, with tuples inserted, updated, deleted and read in between;
+// a scan left open holds the swap back while openScanAt <= step < closeScanAt
+RC reorganizeWithTraffic(const string &tableName, const TableIndex &index, TupleShadow &shadow, int &nextSalary,
+                         const int openScanAt, const int closeScanAt, int &steps)
+{
+    IndexManager *ix = IndexManager::instance();
+    vector<Attribute> attrs;
+    rm->getAttributes(tableName, attrs);
+    vector<TableIndex> indexes;
+    indexes.push_back(index);
+    RM_Reorganizer reorganizer;
+    RC rc = rm->reorganizeTable(tableName, indexes, reorganizer);
+    assert(rc == success && "RelationManager::reorganizeTable() should not fail.");
+    RM_Reorganizer second;
+    rc = rm->reorganizeTable(tableName, vector<TableIndex>(), second);
+    assert(rc != success && "Reorganizing a table twice at once should fail.");
+
+    unsigned seed = 3;
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    RID rid;
+    RM_ScanIterator rmsi;
+    vector<string> attributes;
+    attributes.push_back("Salary");
+    for (steps = 0; !reorganizer.done(); steps++) {
+        if (steps > 10000 || reorganizer.step(8) != success) {
+            return -1;
+        }
+        if (steps == openScanAt) {
+            rc = rm->scan(tableName, "", NO_OP, NULL, attributes, rmsi);
+            assert(rc == success && "RelationManager::scan() should not fail.");
+        }
+        if (steps >= openScanAt && steps < closeScanAt && reorganizer.done()) {
+            cout << "[FAIL] The table should not be swapped while a scan has it open." << endl;
+            return -1;
+        }
+        if (steps == closeScanAt) {
+            rmsi.close();
+        }
+        if (reorganizer.done()) {
+            break;
+        }
+        // readers see what the writers left, writers go to the old file until the swap
+        IXFileHandle ixFileHandle;
+        rc = ix->openFile(index.fileName, ixFileHandle);
+        assert(rc == success && "Opening the index file should not fail.");
+        for (int i = 0; i < 10; i++) {
+            seed = seed * 1103515245 + 12345;
+            TupleShadow::iterator it = shadow.begin();
+            advance(it, (seed >> 8) % shadow.size());
+            int salary = it->first;
+            switch ((seed >> 4) % 4) {
+                case 0:
+                    prepareEmployeeTuple(nextSalary, tuple, &tupleSize);
+                    rc = rm->insertTuple(tableName, tuple, rid);
+                    assert(rc == success && "RelationManager::insertTuple() should not fail.");
+                    rc = ix->insertEntry(ixFileHandle, attrs[3], &nextSalary, rid);
+                    assert(rc == success && "Inserting an index entry should not fail.");
+                    shadow[nextSalary++] = make_pair(rid, string(tuple, tupleSize));
+                    break;
+                case 1:
+                    rc = rm->deleteTuple(tableName, it->second.first);
+                    assert(rc == success && "RelationManager::deleteTuple() should not fail.");
+                    ix->deleteEntry(ixFileHandle, attrs[3], &salary, it->second.first);
+                    shadow.erase(it);
+                    break;
+                case 2:
+                    prepareEmployeeTuple(salary + 20 * (seed % 7), tuple, &tupleSize);
+                    memcpy(tuple + tupleSize - sizeof(int), &salary, sizeof(int));
+                    rc = rm->updateTuple(tableName, tuple, it->second.first);
+                    assert(rc == success && "RelationManager::updateTuple() should not fail.");
+                    it->second.second = string(tuple, tupleSize);
+                    break;
+                default:
+                    if (rm->readTuple(tableName, it->second.first, tuple) != success
+                        || string(tuple, it->second.second.size()) != it->second.second) {
+                        cout << "[FAIL] A tuple read during the reorganization differs." << endl;
+                        return -1;
+                    }
+            }
+        }
+        ix->closeFile(ixFileHandle);
+    }
+
+    // the tuples are where movedTo() says
+    for (auto &tuple : shadow) {
+        if (reorganizer.movedTo(tuple.second.first, rid) != success) {
+            return -1;
+        }
+        tuple.second.first = rid;
+    }
+    return success;
+}
+
+RC TEST_RM_Reorganize(const string &tableName)
+{
+    // Functions Tested
+    // 1. Reorganize Table, with an index, tuples written and read between the steps **
+    // 2. Reorganize Table while a scan is open, and after a scan is closed **
+    // 3. Insert, Update, Delete, Read Tuple, Scan
+    // 4. Index Scan
+    cout << endl << "***** In RM Test Case Reorganize *****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    createTable(tableName);
+    vector<Attribute> attrs;
+    rm->getAttributes(tableName, attrs);
+    TableIndex index;
+    index.attributeName = "Salary";
+    index.fileName = tableName + "_Salary.idx";
+    ix->destroyFile(index.fileName);
+    RC rc = ix->createFile(index.fileName);
+    assert(rc == success && "Creating the index file should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = ix->openFile(index.fileName, ixFileHandle);
+    assert(rc == success && "Opening the index file should not fail.");
+
+    // holes, and tuples that grew off their page
+    int numTuples = 6000;
+    TupleShadow shadow;
+    char tuple[PAGE_SIZE];
+    int tupleSize;
+    RID rid;
+    for (int i = 0; i < numTuples; i++) {
+        prepareEmployeeTuple(i, tuple, &tupleSize);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+        rc = ix->insertEntry(ixFileHandle, attrs[3], &i, rid);
+        assert(rc == success && "Inserting an index entry should not fail.");
+        shadow[i] = make_pair(rid, string(tuple, tupleSize));
+    }
+    for (int i = 1; i < numTuples; i += 4) {
+        unsigned char nullsIndicator = 0;
+        prepareTuple(4, &nullsIndicator, 30, string(30, 'R'), i % 90, 1.5, i, tuple, &tupleSize);
+        rc = rm->updateTuple(tableName, tuple, shadow[i].first);
+        assert(rc == success && "RelationManager::updateTuple() should not fail.");
+        shadow[i].second = string(tuple, tupleSize);
+    }
+    for (int i = 0; i < numTuples; i += 3) {
+        rc = rm->deleteTuple(tableName, shadow[i].first);
+        assert(rc == success && "RelationManager::deleteTuple() should not fail.");
+        ix->deleteEntry(ixFileHandle, attrs[3], &i, shadow[i].first);
+        shadow.erase(i);
+    }
+    ix->closeFile(ixFileHandle);
+
+    vector<TableIndex> badIndexes(1, index);
+    badIndexes[0].attributeName = "NoSuchAttribute";
+    RM_Reorganizer reorganizer;
+    rc = rm->reorganizeTable(tableName, badIndexes, reorganizer);
+    assert(rc != success && "Reorganizing with an index on no attribute should fail.");
+
+    // a scan open from the third step to the fortieth holds the swap back until it is closed
+    int nextSalary = numTuples;
+    int steps;
+    rc = reorganizeWithTraffic(tableName, index, shadow, nextSalary, 3, 40, steps);
+    unsigned entries = 0;
+    RC indexRc = rc == success ? checkSalaryIndex(tableName, index.fileName, entries) : -1;
+    cout << "Steps: " << steps << ", tuples: " << shadow.size() << ", index entries: " << entries << endl;
+    if (rc != success || steps < 40 || checkShadow(tableName, shadow) != success
+        || indexRc != success || entries != shadow.size()) {
+        cout << "***** [FAIL] RM Test Case Reorganize failed: the tuples and the index should follow the table into its new file *****" << endl << endl;
+        return -1;
+    }
+
+    // a scan that read a little and was closed doesn't keep the table from being swapped again
+    RM_ScanIterator rmsi;
+    vector<string> attributes;
+    attributes.push_back("EmpName");
+    rc = rm->scan(tableName, "", NO_OP, NULL, attributes, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    for (int i = 0; i < 10; i++) {
+        rc = rmsi.getNextTuple(rid, tuple);
+        assert(rc == success && "RelationManager::getNextTuple() should not fail.");
+    }
+    rc = rmsi.close();
+    assert(rc == success && "Closing a scan should not fail.");
+    rc = reorganizeWithTraffic(tableName, index, shadow, nextSalary, -1, -1, steps);
+    rc = rc == success ? checkSalaryIndex(tableName, index.fileName, entries) : -1;
+    if (rc != success || checkShadow(tableName, shadow) != success || entries != shadow.size()) {
+        cout << "***** [FAIL] RM Test Case Reorganize failed: a table scanned before should be reorganized too *****" << endl << endl;
+        return -1;
+    }
+
+    rm->deleteTable(tableName);
+    ix->destroyFile(index.fileName);
+
+    cout << "***** RM Test Case Reorganize finished. The result will be examined. *****" << endl << endl;
+    return success;
+}
+
+int main()
+{
+    // If this is the first time, deleting the catalog generates an error. It's OK and we will ignore that.
+    rm->deleteCatalog();
+    RC rc = rm->createCatalog();
+    assert(rc == success && "Creating the Catalog should not fail.");
+
+    TEST_RM_BulkLoad("tbl_bulk");
+
+    TEST_RM_BulkLoadMalformed("tbl_bulk_bad");
+
+    TEST_RM_BulkLoadQuoted("tbl_bulk_quoted");
+
+    TEST_RM_BulkLoadLongTuples("tbl_bulk_long");
+
+    TEST_RM_ScanFilters("tbl_filter");
+
+    TEST_RM_ScanBatches("tbl_batch");
+
+    TEST_RM_Reorganize("tbl_reorg");
+
+    return 0;
+}
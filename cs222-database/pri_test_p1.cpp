@@ -518,7 +518,7 @@ int RBFtest_private_2b(RecordBasedFileManager *rbfm) {
     // 1. Create File - RBFM
     // 2. Open File
     // 3. insertRecord() - checks if we can't find an enough space in the last page,
-    //                     the system checks from the beginning of the file.
+    //                     the system checks the free space of every page from the beginning of the file.
     // 4. Close File
     // 5. Destroy File
     cout << "***** In RBF Test Case Private 2b *****" << endl;
@@ -635,9 +635,9 @@ int RBFtest_private_2b(RecordBasedFileManager *rbfm) {
             return -1;
         }
     } else {
-        // Each page can only contain one record. So, readPageCountDiff should be greater than 50
-        // since the system needs to go through all pages from the beginning.
-        if (readPageCountDiff < numRecords) {
+        // Each page can only contain one record. The free-space map tells that none of the 50 pages
+        // has room without reading them, so a new page has to be appended.
+        if (appendPageCountDiff < 1 || readPageCountDiff >= numRecords) {
             cout << "The implementation regarding insertRecord() is not correct." << endl;
             cout << "***** [FAIL] Test Case Private 2b Failed! *****" << endl;
             rc = rbfm->closeFile(fileHandle);